@@ -0,0 +1,113 @@
+#include "cpp-serializer/txt.hpp"
+#include <fmt/format.h>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+using namespace CPP_SERIALIZER_NAMESPACE;
+
+using Clock = std::chrono::steady_clock;
+
+/// Build and teardown durations in milliseconds
+struct Timing {
+    double build;
+    double teardown;
+};
+
+static double Since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Creates an object in the given resource. If wink is set, the object is never destroyed,
+ * its memory is reclaimed by releasing the arena. This is only valid if the destructors
+ * have no side effects other than releasing memory from the same arena.
+ */
+template<class T_>
+static auto Make(std::pmr::memory_resource *resource, bool wink) {
+    auto alloc = std::pmr::polymorphic_allocator<std::byte>(resource);
+    auto ptr   = alloc.new_object<T_>();
+
+    return std::unique_ptr<T_, std::function<void(T_*)>>(ptr, [alloc, wink](T_ *obj) mutable {
+        if(!wink)
+            alloc.delete_object(obj);
+    });
+}
+
+//builds a deep path where every node has attributes, then tears it down
+static Timing DeepTree(std::pmr::memory_resource *resource, bool wink, const std::function<void()> &release, size_t depth) {
+    auto start = Clock::now();
+    auto path  = Make<Path>(resource, wink);
+
+    for(size_t i = 0; i < depth; i++) {
+        auto &entry = path->entries.emplace_back(Path::Map, static_cast<int>(i));
+        entry.attributes.emplace("identifier", "node attribute that does not fit in small buffer");
+        entry.attributes.emplace("index", std::to_string(i));
+    }
+
+    auto build = Since(start);
+    
+    start = Clock::now();
+    path.reset();
+    release();
+
+    return {build, Since(start)};
+}
+
+//parses many documents with skip lists, then discards all of them
+static Timing ParseDiscard(std::pmr::memory_resource *resource, bool wink, const std::function<void()> &release, const std::string &source, size_t count) {
+    using Transport = pmr::RuntimeTextTransportSkipList;
+
+    Transport transport;
+    Transport::ScratchType scratch;
+
+    auto start     = Clock::now();
+    auto documents = Make<std::pmr::vector<Transport::DataType>>(resource, wink);
+    documents->reserve(count);
+
+    for(size_t i = 0; i < count; i++)
+        transport.Parse(source, documents->emplace_back(), scratch);
+
+    auto build = Since(start);
+
+    start = Clock::now();
+    documents.reset();
+    release();
+
+    return {build, Since(start)};
+}
+
+//measures the given function using the global allocator and a monotonic arena with and
+//without destroying the objects
+template<class F_>
+static void Measure(const char *name, F_ &&func) {
+    fmt::print("{}\n", name);
+
+    auto print = [](const char *mode, Timing timing) {
+        fmt::print("    {:<8} build: {:8.2f} ms  teardown: {:8.2f} ms\n", mode, timing.build, timing.teardown);
+    };
+
+    print("malloc", func(std::pmr::new_delete_resource(), false, []{}));
+
+    std::pmr::monotonic_buffer_resource arena;
+    print("arena", func(&arena, false, [&]{ arena.release(); }));
+    print("wink", func(&arena, true, [&]{ arena.release(); }));
+}
+
+int main() {
+    auto source = std::string{};
+    for(int i = 0; i < 50; i++)
+        source += "a  line\twith   folded white space\n";
+
+    Measure("deep tree", [](auto resource, bool wink, auto release) { 
+        return DeepTree(resource, wink, release, 100000); 
+    });
+    Measure("parse-discard", [&](auto resource, bool wink, auto release) { 
+        return ParseDiscard(resource, wink, release, source, 2000); 
+    });
+
+    return 0;
+}
@@ -46,10 +46,10 @@ int main(int argc, char *argv[]) {
     ser::RuntimeTextTransport transport;
     transport.SetWrapWidth(wrapwidth);
     transport.SetFolding(false);
+    transport.SetReflowThreaded(true);
 
-    //parse and emit with new settings
-    auto parsed = transport.Parse(*input);
-    transport.Emit(parsed, *output);
+    //parse and emit with new settings without storing the whole text
+    transport.Reflow(*input, *output);
 
 
     if(argc > 2) static_cast<std::ifstream*>(input)->close();
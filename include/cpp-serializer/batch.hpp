@@ -0,0 +1,225 @@
+#pragma once
+
+#include "config.hpp"
+
+#include "cpp-serializer/concepts.hpp"
+#include "cpp-serializer/tmp.hpp"
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /// Transports that can parse a source into their data type.
+    template<class T_>
+    concept ParsingTransportConcept = requires(T_ t, std::string_view s, typename T_::DataType d) {
+        requires DataConcept<typename T_::DataType>;
+        t.Parse(s, d);
+    };
+
+    /// Result of a single item in a batch parse.
+    template<DataConcept DataType_>
+    struct BatchResult {
+        using DataType = DataType_;
+
+        DataType data;
+
+        /// Exception that is thrown while parsing this item, if any.
+        std::exception_ptr error;
+
+        bool Succeeded() const { return !error; }
+    };
+
+    namespace internal {
+        /**
+         * @brief Distributes a range of indices among workers.
+         * Each worker starts with an equal contiguous range and consumes it from the front.
+         * When its range is exhausted, the worker steals the back half of the range of
+         * another worker. Next returns nullopt once all ranges are exhausted.
+         */
+        class WorkStealingScheduler {
+        public:
+            WorkStealingScheduler(size_t count, size_t workers_) :
+                workers(workers_), ranges(std::make_unique<Range[]>(workers_))
+            {
+                for(size_t i = 0; i < workers; i++) {
+                    ranges[i].begin = count * i / workers;
+                    ranges[i].end   = count * (i + 1) / workers;
+                }
+            }
+
+            /// Returns the next index to be processed by the given worker.
+            std::optional<size_t> Next(size_t worker) {
+                auto &own = ranges[worker];
+
+                {
+                    std::lock_guard lock(own.mutex);
+                    if(own.begin < own.end)
+                        return own.begin++;
+                }
+
+                for(size_t i = 1; i < workers; i++) {
+                    auto &victim = ranges[(worker + i) % workers];
+                    size_t begin, end;
+
+                    {
+                        std::lock_guard lock(victim.mutex);
+                        if(victim.begin >= victim.end)
+                            continue;
+
+                        end   = victim.end;
+                        begin = end - (end - victim.begin + 1) / 2;
+                        victim.end = begin;
+                    }
+
+                    //first stolen index is returned, rest becomes the own range
+                    std::lock_guard lock(own.mutex);
+                    own.begin = begin + 1;
+                    own.end   = end;
+
+                    return begin;
+                }
+
+                return std::nullopt;
+            }
+
+        private:
+            struct alignas(64) Range {
+                std::mutex mutex;
+                size_t begin = 0;
+                size_t end   = 0;
+            };
+
+            size_t workers;
+            std::unique_ptr<Range[]> ranges;
+        };
+
+        /**
+         * @brief Runs the worker on the given number of threads to process indices up to count.
+         * Worker is called with its id and the scheduler to obtain indices from. Number of
+         * threads is limited by count, 0 uses hardware concurrency. Worker 0 runs on the
+         * calling thread. If a worker throws, the first exception is rethrown on the calling
+         * thread after all threads are joined.
+         */
+        template<class F_>
+        void RunWorkers(size_t count, size_t threads, F_ &&worker) {
+            if(threads == 0)
+                threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+            threads = std::max(std::min(threads, count), size_t{1});
+
+            WorkStealingScheduler scheduler(count, threads);
+
+            //an exception leaving a thread would terminate, thus it is stored instead
+            auto error = std::exception_ptr{};
+            auto errormutex = std::mutex{};
+
+            auto run = [&](size_t id) {
+                try {
+                    worker(id, scheduler);
+                }
+                catch(...) {
+                    std::lock_guard lock(errormutex);
+                    if(!error)
+                        error = std::current_exception();
+                }
+            };
+
+            {
+                //threads join on destruction, thus started threads are joined even if
+                //starting a later thread throws
+                auto pool = std::vector<std::jthread>{};
+                pool.reserve(threads - 1);
+
+                for(size_t i = 1; i < threads; i++)
+                    pool.emplace_back(run, i);
+
+                run(0);
+            }
+
+            if(error)
+                std::rethrow_exception(error);
+        }
+
+        /// Parses a single batch item, paths are opened as files, stream pointers are
+        /// dereferenced and variants are visited.
+        template<class Transport_, class Item_, class Scratch_>
+        void ParseBatchItem(Transport_ &transport, Item_ &item, typename Transport_::DataType &data, Scratch_ *scratch) {
+            if constexpr(IsInstantiationV<std::remove_cv_t<Item_>, std::variant>) {
+                std::visit([&](auto &alternative) { ParseBatchItem(transport, alternative, data, scratch); }, item);
+            }
+            else if constexpr(std::is_same_v<std::remove_cv_t<Item_>, std::filesystem::path>) {
+                std::ifstream file(item, std::ios::binary);
+                if(!file.is_open())
+                    throw std::runtime_error("Cannot open file: " + item.string());
+
+                ParseBatchItem(transport, file, data, scratch);
+            }
+            else if constexpr(std::is_pointer_v<Item_>) {
+                ParseBatchItem(transport, *item, data, scratch);
+            }
+            else if constexpr(!std::is_same_v<Scratch_, void>) {
+                transport.Parse(item, data, *scratch);
+            }
+            else {
+                transport.Parse(item, data);
+            }
+        }
+    }
+
+    /**
+     * @brief Parses the given sources concurrently.
+     * Sources are distributed among the worker threads using work stealing. Every worker
+     * uses its own copy of the transport and, if the transport has a ScratchType, its own
+     * parse buffers. Exceptions are caught and stored in the result of the item.
+     * @param transport Transport to be used, its settings are copied to the workers.
+     * @param sources Sources to parse. Items can be anything the transport can parse,
+     *        std::filesystem::path which is opened as a file, a pointer to these or a
+     *        std::variant of these. Items should not be shared between the sources.
+     * @param threads Number of worker threads, 0 uses hardware concurrency. 1 parses on
+     *        the calling thread.
+     * @return Results in the order of the sources.
+     */
+    template<ParsingTransportConcept Transport_, class Sources_>
+    auto ParseBatch(const Transport_ &transport, Sources_ &sources, size_t threads = 0) {
+        using ResultType  = BatchResult<typename Transport_::DataType>;
+
+        auto count   = static_cast<size_t>(std::size(sources));
+        auto results = std::vector<ResultType>(count);
+
+        internal::RunWorkers(count, threads, [&](size_t id, internal::WorkStealingScheduler &scheduler) {
+            auto local = transport;
+
+            auto run = [&](auto *scratch) {
+                while(auto index = scheduler.Next(id)) {
+                    try {
+                        internal::ParseBatchItem(local, sources[*index], results[*index].data, scratch);
+                    }
+                    catch(...) {
+                        results[*index].error = std::current_exception();
+                    }
+                }
+            };
+
+            if constexpr(requires { typename Transport_::ScratchType; }) {
+                typename Transport_::ScratchType scratch;
+                run(&scratch);
+            }
+            else {
+                run(static_cast<void*>(nullptr));
+            }
+        });
+
+        return results;
+    }
+
+}
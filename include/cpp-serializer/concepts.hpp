@@ -39,6 +39,16 @@ namespace CPP_SERIALIZER_NAMESPACE {
         {t(c, s)} -> std::same_as<std::pair<LocationType, StorageType>>;
     };
     
+    /**
+     * In place data parsers write the converted value and the location directly to the 
+     * target data, allowing the memory of the target to be reused. Parsers are not required
+     * to support this, DataParserConcept is used otherwise.
+     */
+    template <class T_, class LocationType, class DataType>
+    concept InPlaceDataParserConcept = requires(T_ t, const Context<LocationType> c, std::string_view s, DataType &d) {
+        t(c, s, d);
+    };
+    
     /**
      * Type emitter concepts will take a context and storage type and should convert it to a
      * type compatible with string_view
@@ -51,27 +61,30 @@ namespace CPP_SERIALIZER_NAMESPACE {
     /**
      * This concept defines an std::map like Map type. The map type should at least have
      * begin/end iterator, insert, erase, at and find functions as well as member access 
-     * operator.
+     * operator. OrderedHashMap is the recommended map type, LocatedHashMap also stores key
+     * locations next to the entries.
      */
     template<class T_, class Key, class Data>
     concept MapConcept = requires (T_ t, Key k, Data d) {
         requires std::forward_iterator<decltype(begin(t))>;
         requires std::forward_iterator<decltype(end(t))>;
-        requires std::forward_iterator<decltype(t.find())>;
+        requires std::forward_iterator<decltype(t.find(k))>;
         
         {t[k]}            -> std::convertible_to<Data>;
-        {t.at[k]}         -> std::convertible_to<Data>;
+        {t.at(k)}         -> std::convertible_to<Data>;
         
         {std::get<0>(*begin(t))} -> std::convertible_to<Key>;
         {std::get<1>(*begin(t))} -> std::convertible_to<Data>;
         
-        t.insert(k, d);
+        t.insert({k, d});
+        t.erase(k);
     };
     
     /**
      * This concept defines an std::vector like sequence that at least support begin/end
      * iterator, size, push_back, insert, erase and clear functions as well as member
-     * access operator
+     * access operator. Data stores its sequence by value, thus the sequence type should
+     * support incomplete element types like std::vector does.
      */
     template<class T_, class Key, class Data>
     concept SequenceConcept = requires (T_ t, Key k, Data d) {
@@ -85,8 +98,8 @@ namespace CPP_SERIALIZER_NAMESPACE {
         {t.size()}        -> std::same_as<Key>;
         
         t.push_back(d);
-        t.insert(*begin(t), d);
-        t.erase(*begin(t));
+        t.insert(begin(t), d);
+        t.erase(begin(t));
         t.clear();
     };
     
@@ -227,14 +240,22 @@ namespace CPP_SERIALIZER_NAMESPACE {
     template<class T_>
     concept TargetConcept = requires (T_ t, std::string_view sv, char c, const T_ ct) {
         t.Put(sv);
+        t.Put(sv, size_t{}, size_t{});
         t.Put(c);
     };
 
+    /// Escape is optional in text settings, settings without it do not escape.
+    template<class T_>
+    concept OptionalEscapeSetting = !requires { T_::Escape; } || requires {
+        {T_::Escape} -> std::convertible_to<YesNoRuntime>;
+    };
+
     template<class T_>
     concept TextParserTraits = requires {
         {T_::SkipList} -> std::convertible_to<YesNoRuntime>;
         {T_::Folding} -> std::convertible_to<YesNoRuntime>;
         {T_::Glue} -> std::convertible_to<YesNoRuntime>;
+        requires OptionalEscapeSetting<T_>;
     };
 
     template<class T_>
@@ -243,10 +264,33 @@ namespace CPP_SERIALIZER_NAMESPACE {
         {T_::Folding} -> std::convertible_to<YesNoRuntime>;
         {T_::Glue} -> std::convertible_to<YesNoRuntime>;
         {T_::WordWrap} -> std::convertible_to<YesNoRuntime>;
+        requires OptionalEscapeSetting<T_>;
+
 
+        requires DataTraitConcept<typename T_::DataTraits>;
+        requires DataConcept<typename T_::DataType>;
+    };
+
+    /// INI transport settings, data traits should have a map type.
+    template<class T_>
+    concept IniSettingsConcept = requires {
+        {T_::InlineComments} -> std::convertible_to<YesNoRuntime>;
+        {T_::Quotes} -> std::convertible_to<YesNoRuntime>;
+
+        requires DataTraitConcept<typename T_::DataTraits>;
+        requires DataConcept<typename T_::DataType>;
+        requires !std::is_same_v<typename T_::DataTraits::MapType, void>;
+    };
+
+    /// YAML transport settings, data traits should have both map and sequence types.
+    template<class T_>
+    concept YamlSettingsConcept = requires {
+        {T_::DuplicateKeys} -> std::convertible_to<YesNoRuntime>;
 
         requires DataTraitConcept<typename T_::DataTraits>;
         requires DataConcept<typename T_::DataType>;
+        requires !std::is_same_v<typename T_::DataTraits::MapType, void>;
+        requires !std::is_same_v<typename T_::DataTraits::SequenceType, void>;
     };
 }
     
@@ -3,16 +3,38 @@
 #include "config.hpp"
 
 #include "concepts.hpp"
+#include "memory-usage.hpp"
+#include "ordered-map.hpp"
 
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <variant>
-#include <map>
 
 
 namespace CPP_SERIALIZER_NAMESPACE::internal {
     //These structs turn optional types into solid types
     
+    template<class DataTraits>
+    struct allocatorhelper {
+        using AllocatorType = std::allocator<std::byte>;
+    };
+    
+    template<class DataTraits> requires requires { typename DataTraits::AllocatorType; }
+    struct allocatorhelper<DataTraits> {
+        using AllocatorType = DataTraits::AllocatorType;
+    };
+    
     template<DataTraitConcept DataTraits>
     struct datatraithelper : public DataTraits {
+        /// Allocator for the memory of data and its locations, traits may omit it to use
+        /// the global allocator.
+        using AllocatorType = allocatorhelper<DataTraits>::AllocatorType;
+        
         static constexpr bool HasNumber() {
             return !std::is_same_v<typename DataTraits::NumberType, void>;
         }
@@ -37,70 +59,293 @@ namespace CPP_SERIALIZER_NAMESPACE::internal {
         static constexpr bool HasMap() {
             return !std::is_same_v<typename DataTraits::MapType, void>;
         }
+        
+        /// Traits may set Lazy to true to allow data to hold lazy nodes, see Data::SetLazy.
+        /// Only data with lazy nodes modifies itself during const access.
+        static constexpr bool HasLazy() {
+            if constexpr(requires { DataTraits::Lazy; })
+                return DataTraits::Lazy;
+            else
+                return false;
+        }
     };
     
-    template<
-        class StorageType, 
-        class IndexType, class KeyType, 
-        class SequenceType, class MapType
-    > 
+    /**
+     * @brief Part of a source recorded by a lazy parse.
+     * Only the byte range of the node is recorded, the node is parsed by the given function
+     * when it is first accessed. Source buffer should outlive the node.
+     */
+    template<class DataType>
+    struct lazynode {
+        /// Byte range of the node in the source
+        std::string_view source;
+        
+        /// Mixed time settings of the transport that recorded the node
+        std::array<bool, 8> settings;
+        
+        /// Parses the range into the target, replacing this node
+        void (*materialize)(DataType &target, const lazynode &node);
+        
+        bool operator==(const lazynode &) const = default;
+    };
+    
+    /**
+     * @brief Contents of another data shared by this data.
+     * Shared nodes are used for YAML aliases: the contents of the anchored node are read
+     * through the pointer instead of being copied, see Data::SetShared.
+     */
+    template<class DataType>
+    struct sharednode {
+        std::shared_ptr<const DataType> target;
+        
+        bool operator==(const sharednode &) const = default;
+    };
+    
+    /// Adds the given alternative to the variant, void types are not added.
+    template<class Variant_, class T_>
+    struct addalternative {
+        using type = Variant_;
+    };
+    
+    template<class ...Types_, class T_> requires (!std::is_void_v<T_>)
+    struct addalternative<std::variant<Types_...>, T_> {
+        using type = std::variant<Types_..., T_>;
+    };
+    
+    template<class Variant_, class T_>
+    using addalternative_t = addalternative<Variant_, T_>::type;
+    
+    /// Variant that data stores, containers that are void and lazy nodes of data types
+    /// without lazy nodes are left out.
+    template<class DataType, class StorageType, class SequenceType, class MapType, bool lazy_>
+    using datavariant = addalternative_t<
+        addalternative_t<
+            addalternative_t<
+                addalternative_t<std::variant<std::nullptr_t, StorageType>, SequenceType>,
+                MapType
+            >,
+            std::conditional_t<lazy_, lazynode<DataType>, void>
+        >,
+        sharednode<DataType>
+    >;
+    
+    template<class VariantType, class LocationType, bool lazy_> 
     class datadatahelper {
     protected:
+        datadatahelper() = default;
+        
+        explicit datadatahelper(LocationType location_) : location(std::move(location_)) { }
+        
         /// The data stored in this data object. nullptr here denotes data is not set
-        /// at all, not that it contains a null value.
-        std::variant<std::nullptr_t, StorageType, SequenceType, MapType> data;
+        /// at all, not that it contains a null value. Shared nodes are read through, see
+        /// Data::Resolve.
+        VariantType data;
+        
+        [[no_unique_address]]
+        LocationType location;
     };
     
-    template<class StorageType, class IndexType, class SequenceType>
-    class datadatahelper<StorageType, IndexType, void, SequenceType, void> {
+    /// Lazy nodes are replaced by the parsed data and its location on first access, thus
+    /// data and location are mutable.
+    template<class VariantType, class LocationType>
+    class datadatahelper<VariantType, LocationType, true> {
     protected:
-        std::variant<std::nullptr_t, StorageType, SequenceType> data;
+        datadatahelper() = default;
+        
+        explicit datadatahelper(LocationType location_) : location(std::move(location_)) { }
+        
+        mutable VariantType data;
+        
+        [[no_unique_address]]
+        mutable LocationType location;
     };
     
-    template<class KeyType, class StorageType, class MapType>
-    class datadatahelper<StorageType, void, KeyType, void, MapType> {
-    protected:
-        std::variant<std::nullptr_t, StorageType, MapType> data;
-    };
+    /// Base of datahelper for the given traits.
+    template<class DataTraits, class DataType, class StorageType, class SequenceType, class MapType>
+    using datadatahelperfor = datadatahelper<
+        datavariant<DataType, StorageType, SequenceType, MapType, datatraithelper<DataTraits>::HasLazy()>,
+        typename DataTraits::LocationType, datatraithelper<DataTraits>::HasLazy()
+    >;
     
-    template<class StorageType>
-    class datadatahelper<StorageType, void, void, void, void> {
-    protected:
-        std::variant<std::nullptr_t, StorageType> data;
+    /// Key location table of data whose map stores the key locations.
+    struct nokeylocations {
+        nokeylocations() = default;
+        
+        template<class Allocator_>
+        explicit nokeylocations(const Allocator_ &) { }
     };
     
     template<
-        DataTraitConcept DataTraits,
+        DataTraitConcept DataTraits, class DataType,
         class StorageType, 
         class IndexType, class KeyType, 
         class SequenceType, class MapType
     > 
-    class datahelper : public datadatahelper<StorageType, IndexType, KeyType, SequenceType, MapType> {
+    class datahelper : public datadatahelperfor<DataTraits, DataType, StorageType, SequenceType, MapType> {
     public:
+        using AllocatorType = allocatorhelper<DataTraits>::AllocatorType;
+        
+        datahelper() = default;
+        
+        datahelper(const AllocatorType &alloc, DataTraits::LocationType location_) :
+            datahelper::datadatahelper(std::move(location_)),
+            key_locations(alloc)
+        { }
         
         bool KeyExists(const KeyType &key) const {
-            if(std::holds_alternative<SequenceType>(this->data)) {
-                const auto &map = std::get<SequenceType>(this->data);
-                if(auto it = map.find(key); it != end(map))
-                    return true;
-            }
+            if(auto map = std::get_if<MapType>(&resolved().data))
+                return map->find(key) != end(*map);
             
             return false;
         }
+        
+        bool IsMap() const {
+            return std::holds_alternative<MapType>(resolved().data);
+        }
+        
+        /// Returns the stored map without copying. Data should hold a map.
+        const MapType &GetMap() const {
+            return std::get<MapType>(resolved().data);
+        }
+        
+        /// Returns the stored map for modification, shared maps are detached first. Data
+        /// should hold a map.
+        MapType &GetMap() {
+            static_cast<DataType &>(*this).Detach();
+            
+            return std::get<MapType>(this->data);
+        }
+        
+        /// Replaces the contents with an empty map and removes the key locations. Allocator
+        /// aware maps are constructed with the allocator of this data.
+        MapType &EmplaceMap() {
+            if constexpr(!StoresKeyLocations)
+                key_locations.clear();
+            
+            if constexpr(std::uses_allocator_v<MapType, AllocatorType>) {
+                return this->data.template emplace<MapType>(
+                    std::make_obj_using_allocator<MapType>(static_cast<const DataType &>(*this).get_allocator())
+                );
+            }
+            else {
+                return this->data.template emplace<MapType>();
+            }
+        }
+        
+        /// Returns the location of the given key, nullptr if it is not recorded.
+        const DataTraits::LocationType *GetKeyLocation(const KeyType &key) const {
+            if constexpr(StoresKeyLocations) {
+                auto map = std::get_if<MapType>(&resolved().data);
+                if(!map)
+                    return nullptr;
+                
+                auto it = map->find(key);
+                
+                return it == map->end() ? nullptr : &map->GetMetadata(it);
+            }
+            else {
+                auto &locations = resolved().key_locations;
+                auto it = locations.find(key);
+                
+                return it == locations.end() ? nullptr : &it->second;
+            }
+        }
+        
+        /// Records the location of the given key, usually the start of the key in the source.
+        /// If the map stores key locations, the key should already be in the map; otherwise
+        /// the location is not recorded.
+        template<class K_, class L_>
+        void SetKeyLocation(K_ &&key, L_ &&keylocation) {
+            if(static_cast<DataType &>(*this).IsShared())
+                static_cast<DataType &>(*this).Detach();
+            
+            if constexpr(StoresKeyLocations) {
+                if(auto map = std::get_if<MapType>(&this->data)) {
+                    if(auto it = map->find(key); it != map->end())
+                        map->GetMetadata(it) = std::forward<L_>(keylocation);
+                }
+            }
+            else {
+                key_locations[KeyType(std::forward<K_>(key))] = std::forward<L_>(keylocation);
+            }
+        }
     
     protected:
-        std::map<KeyType, typename DataTraits::LocationType> key_locations;
+        /// Maps that store a location next to each entry, such as LocatedHashMap, keep the
+        /// key locations themselves. Other maps use a separate table.
+        static constexpr bool StoresKeyLocations = requires(MapType map, typename MapType::const_iterator it) {
+            {map.GetMetadata(it)} -> std::same_as<typename DataTraits::LocationType &>;
+        };
+        
+        const DataType &resolved() const {
+            return static_cast<const DataType &>(*this).Resolve();
+        }
+        
+        /// Assigns the key locations of the other data along with its contents.
+        template<class Other_>
+        void AssignKeyLocations(Other_ &&other) {
+            if constexpr(!StoresKeyLocations)
+                key_locations = std::forward<Other_>(other).key_locations;
+        }
+        
+        /// Copies the key locations of the other data, whose map has just been copied to this
+        /// data in the same order.
+        void CopyKeyLocations(const DataType &other) {
+            if constexpr(StoresKeyLocations) {
+                auto &map    = std::get<MapType>(this->data);
+                auto &source = std::get<MapType>(other.data);
+                
+                for(auto it = map.begin(), from = source.begin(); it != map.end(); ++it, ++from)
+                    map.GetMetadata(it) = source.GetMetadata(from);
+            }
+            else {
+                key_locations = other.key_locations;
+            }
+        }
+        
+        void AddKeyLocationUsage(MemoryUsage &usage) const {
+            if constexpr(!StoresKeyLocations)
+                internal::AddMemoryUsage(usage, key_locations, &MemoryUsage::Containers);
+        }
+        
+        using KeyLocationPair = std::pair<KeyType, typename DataTraits::LocationType>;
+        
+        using KeyLocationMap = OrderedHashMap<
+            KeyType, typename DataTraits::LocationType, std::hash<KeyType>, std::equal_to<KeyType>,
+            typename std::allocator_traits<AllocatorType>::template rebind_alloc<KeyLocationPair>
+        >;
+        
+        /// Locations of the keys for maps that cannot store them, empty otherwise.
+        [[no_unique_address]]
+        std::conditional_t<StoresKeyLocations, nokeylocations, KeyLocationMap> key_locations;
     };
     
     
     template<
-        DataTraitConcept DataTraits,
+        DataTraitConcept DataTraits, class DataType,
         class IndexType, 
         class StorageType, class SequenceType
     > 
-    class datahelper<DataTraits, StorageType, IndexType, void, SequenceType, void> : 
-        public datadatahelper<StorageType, IndexType, void, SequenceType, void> 
-    { };
+    class datahelper<DataTraits, DataType, StorageType, IndexType, void, SequenceType, void> : 
+        public datadatahelperfor<DataTraits, DataType, StorageType, SequenceType, void> 
+    {
+    public:
+        using AllocatorType = allocatorhelper<DataTraits>::AllocatorType;
+        
+        datahelper() = default;
+        
+        datahelper(const AllocatorType &, DataTraits::LocationType location_) :
+            datahelper::datadatahelper(std::move(location_))
+        { }
+        
+    protected:
+        template<class Other_>
+        void AssignKeyLocations(Other_ &&) { }
+        
+        void CopyKeyLocations(const DataType &) { }
+        
+        void AddKeyLocationUsage(MemoryUsage &) const { }
+    };
 
 
 }
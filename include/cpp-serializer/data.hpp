@@ -5,6 +5,7 @@
 #include "cpp-serializer/tmp.hpp"
 #include "data-helper.hpp"
 #include <any>
+#include <memory>
 #include <string_view>
 #include <variant>
 
@@ -19,68 +20,371 @@ namespace CPP_SERIALIZER_NAMESPACE {
      * or source of emit operations. Depending on the traits, Data
      * can store scalars, sequence or maps. Additionally, it can 
      * contain Location information about where the data is stored.
+     * If the traits allow it, Data can also hold a lazy node that only records where its
+     * contents are in the source, such nodes are parsed when they are first accessed. As
+     * const access may parse the node, lazily parsed data should not be read by multiple
+     * threads before Materialize is called. Data can also share the contents of another data, such as
+     * YAML aliases, see SetShared.
      * @tparam DataTraits_ Defines what and how this data will store
-     *         the data.
+     *         the data. Traits are checked against DataTraitConcept when Data is
+     *         instantiated, thus traits may refer to Data of themselves, such as in
+     *         their map type.
      */
-    template<DataTraitConcept DataTraits_>
-    class Data : internal::datahelper<
-        DataTraits_,
+    template<class DataTraits_>
+    class Data : public internal::datahelper<
+        DataTraits_, Data<DataTraits_>,
         typename DataTraits_::StorageType,
         typename DataTraits_::IndexType,
         typename DataTraits_::KeyType,
         typename DataTraits_::SequenceType,
         typename DataTraits_::MapType
     > {
+        static_assert(DataTraitConcept<DataTraits_>, "Data traits should satisfy DataTraitConcept");
+
     public:
         /// Data traits definition.
         using DataTraits = internal::datatraithelper<DataTraits_>;
         
         /// Storage data type definition
         using StorageType = DataTraits::StorageType;
+        
+        /// Allocator used for the stored value and the location, see DataTraits.
+        using allocator_type = DataTraits::AllocatorType;
+        
+        /// Unparsed node recorded by lazy parsing, see SetLazy.
+        using LazyNode = internal::lazynode<Data>;
+        
+        /// Contents of another data shared by this data, see SetShared.
+        using SharedNode = internal::sharednode<Data>;
+        
+        Data() = default;
+        
+        /**
+         * @brief Constructs an empty data that obtains its memory from the given allocator.
+         * Values set later and the skip list of the location use this allocator if they are
+         * allocator aware. With std::pmr, a monotonic arena allows a whole document to be
+         * released at once. Copies use the default allocator as in std::pmr containers.
+         */
+        explicit Data(const allocator_type &alloc) :
+            Data::datahelper(alloc, MakeLocation(alloc)),
+            allocator(alloc)
+        { }
+        
+        Data(const Data &other) : 
+            Data(std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.allocator))
+        {
+            Assign(other);
+        }
+        
+        Data(Data &&) = default;
+        
+        /// Allocator extended copy, allows Data to be stored in allocator aware containers.
+        Data(const Data &other, const allocator_type &alloc) : Data(alloc) {
+            Assign(other);
+        }
+        
+        /// Allocator extended move, allows Data to be stored in allocator aware containers.
+        Data(Data &&other, const allocator_type &alloc) : Data(alloc) {
+            Assign(std::move(other));
+        }
+        
+        /// Assignment keeps the allocator of this data.
+        Data &operator=(const Data &other) {
+            if(this != &other)
+                Assign(other);
+            
+            return *this;
+        }
+        
+        /// Assignment keeps the allocator of this data.
+        Data &operator=(Data &&other) {
+            if(this != &other)
+                Assign(std::move(other));
+            
+            return *this;
+        }
     
+        /// Sets the stored value. If data already holds a value, it is assigned to, allowing
+        /// its memory to be reused. Rvalues are moved.
         template<class T_>
-        void SetData(const T_ &val) {
-            this->data = StorageType{val};
+        void SetData(T_ &&val) {
+            if constexpr(std::is_assignable_v<StorageType &, T_ &&>) {
+                if(auto current = std::get_if<StorageType>(&this->data)) {
+                    *current = std::forward<T_>(val);
+                    return;
+                }
+            }
+            
+            EmplaceData(std::forward<T_>(val));
         }
         
-        StorageType GetData() const {
-            return std::get<StorageType>(this->data);
+        /// Constructs the stored value in place using the given arguments. Allocator aware
+        /// values are constructed with the allocator of this data.
+        template<class ...Args_>
+        StorageType &EmplaceData(Args_ &&...args) {
+            if constexpr(std::uses_allocator_v<StorageType, allocator_type>) {
+                return this->data.template emplace<StorageType>(
+                    std::make_obj_using_allocator<StorageType>(allocator, std::forward<Args_>(args)...)
+                );
+            }
+            else {
+                return this->data.template emplace<StorageType>(std::forward<Args_>(args)...);
+            }
+        }
+        
+        allocator_type get_allocator() const {
+            return allocator;
+        }
+        
+        /**
+         * @brief Sets the contents of this data to a node that will be parsed on access.
+         * This is used by transports for lazy parsing, the location should be set to the
+         * start of the node separately. Location obtained before the node is accessed does
+         * not contain the skip list. Only available if the traits allow lazy nodes, see
+         * internal::datatraithelper::HasLazy.
+         */
+        void SetLazy(const LazyNode &node) requires (DataTraits::HasLazy()) {
+            this->data = node;
+        }
+        
+        /// Parses the lazy node held by this data, does nothing if data is already parsed
+        /// or the traits do not allow lazy nodes.
+        void Materialize() const {
+            if constexpr(DataTraits::HasLazy()) {
+                if(auto lazy = std::get_if<LazyNode>(&this->data)) {
+                    //node is replaced during materialization
+                    auto node = *lazy;
+                    node.materialize(const_cast<Data &>(*this), node);
+                }
+            }
+        }
+        
+        /**
+         * @brief Makes this data share the contents of the given data instead of a copy.
+         * Const access reads the contents of the target, thus any number of data can share
+         * a subtree without copying it. Non-const access detaches the data first, see
+         * Detach. Location of this data is not changed. Target should not be modified
+         * while it is shared.
+         */
+        void SetShared(std::shared_ptr<const Data> target) {
+            this->data = SharedNode{std::move(target)};
+        }
+        
+        /// Checks if this data shares the contents of another data.
+        bool IsShared() const {
+            return std::holds_alternative<SharedNode>(this->data);
+        }
+        
+        /// Returns the data that holds the contents of this data: the target of a shared
+        /// data or this data itself.
+        const Data &Resolve() const {
+            auto node = this;
+            node->Materialize();
+            
+            while(auto shared = std::get_if<SharedNode>(&node->data)) {
+                node = shared->target.get();
+                node->Materialize();
+            }
+            
+            return *node;
+        }
+        
+        /**
+         * @brief Replaces shared contents with a copy that can be modified.
+         * Copy is shallow: children of a shared map or sequence share the children of the
+         * target, thus detaching a node costs as much as copying its top level. Does
+         * nothing if this data is not shared.
+         */
+        void Detach() {
+            Materialize();
+            
+            auto shared = std::get_if<SharedNode>(&this->data);
+            if(!shared)
+                return;
+            
+            //keeps the target alive while the contents are replaced
+            auto owner = std::move(shared->target);
+            auto &source = owner->Resolve();
+            
+            auto share = [&](const Data &child) {
+                auto copy = Data(allocator);
+                copy.SetShared(std::shared_ptr<const Data>(owner, &child));
+                copy.SetLocation(child.GetLocation());
+                
+                return copy;
+            };
+            
+            if(auto value = std::get_if<StorageType>(&source.data)) {
+                SetData(*value);
+                return;
+            }
+            
+            if constexpr(DataTraits::HasSequence()) {
+                if(auto sequence = std::get_if<typename DataTraits::SequenceType>(&source.data)) {
+                    auto &copy = EmplaceSequence();
+                    
+                    for(const auto &child : *sequence)
+                        copy.push_back(share(child));
+                    
+                    return;
+                }
+            }
+            
+            if constexpr(DataTraits::HasMap()) {
+                if(auto map = std::get_if<typename DataTraits::MapType>(&source.data)) {
+                    auto &copy = this->EmplaceMap();
+                    
+                    for(const auto &[key, child] : *map)
+                        copy[key] = share(child);
+                    
+                    this->CopyKeyLocations(source);
+                    return;
+                }
+            }
+            
+            this->data = nullptr;
+        }
+        
+        /// Returns the stored value without copying. Data should hold a value.
+        const StorageType &GetData() const & {
+            return std::get<StorageType>(Resolve().data);
+        }
+        
+        /// Moves the stored value out of a temporary data.
+        StorageType GetData() && {
+            Detach();
+            
+            return std::move(std::get<StorageType>(this->data));
+        }
+        
+        /// Moves the stored value out, data is left without a value.
+        StorageType TakeData() {
+            Detach();
+            
+            auto value = std::move(std::get<StorageType>(this->data));
+            this->data = nullptr;
+            
+            return value;
+        }
+        
+        bool IsSequence() const requires (DataTraits::HasSequence()) {
+            return std::holds_alternative<typename DataTraits::SequenceType>(Resolve().data);
+        }
+        
+        /// Returns the stored sequence without copying. Data should hold a sequence.
+        const auto &GetSequence() const requires (DataTraits::HasSequence()) {
+            return std::get<typename DataTraits::SequenceType>(Resolve().data);
+        }
+        
+        /// Returns the stored sequence for modification, shared sequences are detached
+        /// first. Data should hold a sequence.
+        auto &GetSequence() requires (DataTraits::HasSequence()) {
+            Detach();
+        
+            return std::get<typename DataTraits::SequenceType>(this->data);
+        }
+        
+        /// Replaces the contents with an empty sequence. Allocator aware sequences are
+        /// constructed with the allocator of this data.
+        auto &EmplaceSequence() requires (DataTraits::HasSequence()) {
+            using SequenceType = DataTraits::SequenceType;
+        
+            if constexpr(std::uses_allocator_v<SequenceType, allocator_type>)
+                return this->data.template emplace<SequenceType>(std::make_obj_using_allocator<SequenceType>(allocator));
+            else
+                return this->data.template emplace<SequenceType>();
+        }
+        
+        /**
+         * @brief Returns the memory used by this data, its children and locations.
+         * Size of this object is not included. Lazy nodes are not parsed, thus only the
+         * memory that is allocated so far is reported. Contents of shared data are not
+         * included as they are owned by the target.
+         */
+        MemoryUsage GetMemoryUsage() const {
+            auto usage = MemoryUsage{};
+            
+            std::visit([&]<class T_>(const T_ &value) {
+                if constexpr(std::is_same_v<T_, StorageType>)
+                    internal::AddMemoryUsage(usage, value, &MemoryUsage::Payload);
+                else
+                    internal::AddMemoryUsage(usage, value, &MemoryUsage::Containers);
+            }, this->data);
+            
+            internal::AddMemoryUsage(usage, this->location, &MemoryUsage::Locations);
+            this->AddKeyLocationUsage(usage);
+            
+            return usage;
+        }
+        
+        /// Compares the stored values, locations are not compared. Lazy nodes are parsed
+        /// and shared data is compared by its contents.
+        bool operator==(const Data &other) const requires std::equality_comparable<StorageType> {
+            return Resolve().data == other.Resolve().data;
         }
 
-        DataTraits::LocationType GetLocation() const {
-            return location;
+        const DataTraits::LocationType &GetLocation() const {
+            return this->location;
         }
 
-        void SetLocation(const DataTraits::LocationType &value) {
-            location = value;
+        template<class T_>
+        void SetLocation(T_ &&value) requires std::is_assignable_v<typename DataTraits::LocationType &, T_ &&> {
+            this->location = std::forward<T_>(value);
         }
 
+        /// Obtains the location of the given offset in the stored string. If data does not 
+        /// hold a string, the location is obtained using an empty string.
         auto GetLocation(size_t offset) {
-            if constexpr(!std::is_same_v<typename DataTraits::StringType, void>) {
-                if constexpr(IsInstantiationV<StorageType, std::variant>) {
-                    auto data = GetData();
-
-                    if(std::holds_alternative<typename DataTraits::StringType>(data))
-                        return location.Obtain(offset, std::get<typename DataTraits::StringType>(data));
-                }
-                else if constexpr(std::is_same_v<StorageType, std::any>) {
-                    auto data = GetData();
-
-                    if(data.type() == typeid(StorageType)) {
-                        return location.Obtain(offset, std::any_cast<typename DataTraits::StringType>(data));
+            using StringType = DataTraits::StringType;
+            
+            if constexpr(!std::is_same_v<StringType, void>) {
+                if(auto stored = std::get_if<StorageType>(&Resolve().data)) {
+                    if constexpr(IsInstantiationV<StorageType, std::variant>) {
+                        if(auto str = std::get_if<StringType>(stored))
+                            return this->location.Obtain(offset, *str);
+                    }
+                    else if constexpr(std::is_same_v<StorageType, std::any>) {
+                        if(auto str = std::any_cast<StringType>(stored))
+                            return this->location.Obtain(offset, *str);
+                    }
+                    else if constexpr(std::is_convertible_v<StorageType, std::string_view>) {
+                        return this->location.Obtain(offset, *stored);
                     }
-                }
-                else if constexpr(std::is_convertible_v<StorageType, std::string_view>) {
-                    return location.Obtain(offset, std::any_cast<typename DataTraits::StringType>(GetData()));
                 }
             }
                 
-            return location.Obtain(offset, "");;
+            return this->location.Obtain(offset, "");
         }
     
     private:
+        using LocationType = DataTraits::LocationType;
+        
+        /// Assigns the contents of the other data, memory is obtained from the allocator of
+        /// this data.
+        template<class Other_>
+        void Assign(Other_ &&other) {
+            if(auto value = std::get_if<StorageType>(&other.data)) {
+                if constexpr(std::is_rvalue_reference_v<Other_ &&>)
+                    SetData(std::move(*value));
+                else
+                    SetData(*value);
+            }
+            else
+                this->data = std::forward<Other_>(other).data;
+            
+            this->location = std::forward<Other_>(other).location;
+            this->AssignKeyLocations(std::forward<Other_>(other));
+        }
+        
+        static LocationType MakeLocation(const allocator_type &alloc) {
+            if constexpr(std::uses_allocator_v<LocationType, allocator_type>)
+                return std::make_obj_using_allocator<LocationType>(alloc);
+            else
+                return LocationType{};
+        }
+        
         [[no_unique_address]]
-        DataTraits::LocationType location;
+        allocator_type allocator;
     };
 
 }
@@ -3,17 +3,29 @@ set(Local
     
     #Meta headers
     concepts.hpp
+    fields.hpp
     tmp.hpp
     utf.hpp
     
     #internal structures
     data-helper.hpp
     data.hpp
+    memory-usage.hpp
+    ordered-map.hpp
+    small-vector.hpp
+    tape.hpp
     location.hpp
     source.hpp
     target.hpp
     
     #transports
     txt.hpp
+    ini-helper.hpp
     ini.hpp
+    yaml-helper.hpp
+    yaml.hpp
+    
+    #services
+    batch.hpp
+    snapshot.hpp
 )
\ No newline at end of file
@@ -0,0 +1,236 @@
+#pragma once
+
+#include "config.hpp"
+
+#include "cpp-serializer/concepts.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace CPP_SERIALIZER_NAMESPACE::internal {
+
+    /// FNV-1a hash of a field name, used to build and to query field tables.
+    constexpr std::uint64_t FieldHash(std::string_view name) {
+        auto hash = std::uint64_t{14695981039346656037ull};
+
+        for(auto c : name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    /// Mixes the hash of a name with the displacement of its bucket.
+    constexpr std::uint64_t FieldMix(std::uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+
+        return hash;
+    }
+
+}
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /**
+     * @brief Describes a member of a structure that can be loaded directly.
+     * Name is the key of the member in the document, it does not need to match the name of
+     * the member, see CPPSER_FIELD.
+     */
+    template<class Class_, class Member_>
+    struct Field {
+        using ClassType  = Class_;
+        using MemberType = Member_;
+
+        std::string_view Name;
+        Member_ Class_::*Pointer;
+    };
+
+    /**
+     * @brief Compile time description of the fields of a structure.
+     * Field names are placed in a perfect hash table when the table is constructed, thus a
+     * constexpr table finds the field of a key with a single hash of the key and a single
+     * comparison. Table is built with the hash and displace method: names are distributed
+     * to buckets and each bucket receives a displacement that moves all of its names to
+     * empty slots. Tables with duplicate names cannot be constructed.
+     *
+     * A structure is described either by a static constexpr member named Fields or by
+     * specializing StructFields:
+     * @code
+     * struct Server {
+     *     std::string host;
+     *     int port = 0;
+     *
+     *     static constexpr auto Fields = ser::FieldTable{
+     *         CPPSER_FIELD(Server, host),
+     *         ser::Field{"port-number", &Server::port}
+     *     };
+     * };
+     * @endcode
+     */
+    template<class ...Fields_>
+    class FieldTable {
+    public:
+        /// Number of fields
+        static constexpr size_t Size = sizeof...(Fields_);
+
+        /// Number of slots in the hash table, at most half of them are used.
+        static constexpr size_t Slots = std::bit_ceil(Size * 2 + 1);
+
+        /// Number of buckets, each bucket has two names on average.
+        static constexpr size_t Buckets = Size / 2 + 1;
+
+        constexpr explicit FieldTable(Fields_ ...fields) :
+            Fields(fields...), names{fields.Name...}
+        {
+            for(size_t i = 0; i < Size; i++) {
+                for(size_t j = i + 1; j < Size; j++) {
+                    if(names[i] == names[j])
+                        throw std::logic_error("Field names should be unique");
+                }
+            }
+
+            auto hashes = std::array<std::uint64_t, Size>{};
+            for(size_t i = 0; i < Size; i++)
+                hashes[i] = internal::FieldHash(names[i]);
+
+            //buckets with more names are placed first as they are harder to place
+            auto counts = std::array<size_t, Buckets>{};
+            for(auto hash : hashes)
+                counts[hash % Buckets]++;
+
+            auto order = std::array<size_t, Buckets>{};
+            for(size_t i = 0; i < Buckets; i++)
+                order[i] = i;
+
+            for(size_t i = 1; i < Buckets; i++) {
+                for(size_t j = i; j > 0 && counts[order[j]] > counts[order[j - 1]]; j--)
+                    std::swap(order[j], order[j - 1]);
+            }
+
+            for(auto bucket : order) {
+                if(counts[bucket] == 0)
+                    break;
+
+                place(hashes, bucket);
+            }
+        }
+
+        /// Returns the index of the field with the given name, Size if there is none.
+        constexpr size_t Find(std::string_view name) const {
+            auto hash = internal::FieldHash(name);
+            auto slot = slotof(hash, displacements[hash % Buckets]);
+            auto index = size_t(slots[slot]);
+
+            if(index == 0 || names[index - 1] != name)
+                return Size;
+
+            return index - 1;
+        }
+
+        /// Name of the field at the given index.
+        constexpr std::string_view GetName(size_t index) const {
+            return names[index];
+        }
+
+        /// Calls func with the field at the given index, does nothing if there is none.
+        template<class F_>
+        constexpr void Visit(size_t index, F_ &&func) const {
+            [&]<size_t ...I_>(std::index_sequence<I_...>) {
+                (void)((index == I_ && (func(std::get<I_>(Fields)), true)) || ...);
+            }(std::index_sequence_for<Fields_...>{});
+        }
+
+        std::tuple<Fields_...> Fields;
+
+    private:
+        using SlotType = std::conditional_t<(Size < 255), std::uint8_t, std::uint16_t>;
+
+        static constexpr size_t slotof(std::uint64_t hash, std::uint32_t displacement) {
+            return internal::FieldMix(hash + displacement * 0x9e3779b97f4a7c15ull) & (Slots - 1);
+        }
+
+        /// Finds a displacement that places every name of the bucket to an empty slot.
+        constexpr void place(const std::array<std::uint64_t, Size> &hashes, size_t bucket) {
+            for(std::uint32_t displacement = 1; displacement < 1u << 20; displacement++) {
+                auto taken = std::array<size_t, Size>{};
+                auto count = size_t{0};
+                auto fits = true;
+
+                for(size_t i = 0; i < Size && fits; i++) {
+                    if(hashes[i] % Buckets != bucket)
+                        continue;
+
+                    auto slot = slotof(hashes[i], displacement);
+                    fits = slots[slot] == 0;
+
+                    for(size_t j = 0; j < count && fits; j++)
+                        fits = taken[j] != slot;
+
+                    taken[count++] = slot;
+                }
+
+                if(!fits)
+                    continue;
+
+                displacements[bucket] = displacement;
+
+                for(size_t i = 0; i < Size; i++) {
+                    if(hashes[i] % Buckets == bucket)
+                        slots[slotof(hashes[i], displacement)] = SlotType(i + 1);
+                }
+
+                return;
+            }
+
+            throw std::logic_error("Field table cannot be constructed");
+        }
+
+        std::array<std::string_view, Size> names;
+        std::array<std::uint32_t, Buckets> displacements = {};
+
+        /// Index of the field plus one, 0 marks empty slots
+        std::array<SlotType, Slots> slots = {};
+    };
+
+    /**
+     * @brief Field table of the given structure.
+     * Uses the static Fields member of the structure if it exists. Specialize for
+     * structures that cannot be modified, specialization should be visible before the
+     * structure is loaded.
+     */
+    template<class T_>
+    inline constexpr auto StructFields = [] {
+        if constexpr(requires { T_::Fields; })
+            return T_::Fields;
+        else
+            return nullptr;
+    }();
+
+    /// Structures that are described by a field table, see StructFields.
+    template<class T_>
+    concept FieldDescribedConcept = !std::is_same_v<std::remove_cv_t<decltype(StructFields<T_>)>, std::nullptr_t>;
+
+    /// A key in the source that does not correspond to a field of the structure.
+    template<LocationConcept LocationType_>
+    struct UnknownKey {
+        std::string Key;
+        LocationType_ Location;
+    };
+
+}
+
+#ifndef CPPSER_FIELD
+/// Describes the given member of the class using the name of the member as the key.
+#   define CPPSER_FIELD(classname, member) \
+    CPP_SERIALIZER_NAMESPACE::Field{#member, &classname::member}
+#endif
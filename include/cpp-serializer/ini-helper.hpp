@@ -0,0 +1,545 @@
+#pragma once
+
+#include "config.hpp"
+#include "concepts.hpp"
+#include "cpp-serializer/source.hpp"
+#include "cpp-serializer/target.hpp"
+#include "location.hpp"
+#include "tmp.hpp"
+#include "types.hpp"
+#include "utf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace CPP_SERIALIZER_NAMESPACE::internal {
+
+    /// A section header or a key value pair in an INI document.
+    struct IniLine {
+        enum Type {
+            Section,
+            KeyValue
+        };
+
+        Type type;
+
+        /// Name of the section or the key
+        std::string_view key;
+
+        /// Value of the key, empty for sections
+        std::string_view value;
+
+        /// Line number starting from 1
+        size_t line;
+
+        /// Byte offset of the key in the source and its character offset in the line
+        size_t keyoffset;
+        size_t keychar;
+
+        /// Byte offset of the value in the source and its character offset in the line
+        size_t valueoffset;
+        size_t valuechar;
+    };
+
+    constexpr inline bool IsIniBlank(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    /// Removes spaces and tabs from both ends.
+    inline std::string_view TrimIni(std::string_view str) {
+        while(!str.empty() && IsIniBlank(str.front())) str.remove_prefix(1);
+        while(!str.empty() && IsIniBlank(str.back()))  str.remove_suffix(1);
+
+        return str;
+    }
+
+    /// Removes a comment that starts with ; or # after white space. If quotes is set,
+    /// comment characters within a leading quoted string are ignored.
+    inline std::string_view StripIniComment(std::string_view value, bool quotes) {
+        auto quote = char{0};
+
+        for(size_t i = 0; i < value.size(); i++) {
+            auto c = value[i];
+
+            if(quote) {
+                if(c == quote)
+                    quote = 0;
+            }
+            else if(quotes && i == 0 && (c == '"' || c == '\'')) {
+                quote = c;
+            }
+            else if((c == ';' || c == '#') && (i == 0 || IsIniBlank(value[i - 1]))) {
+                return TrimIni(value.substr(0, i));
+            }
+        }
+
+        return value;
+    }
+
+    /**
+     * @brief Splits an INI document into section headers and key value pairs.
+     * Lines are found using memchr and only the separators of each line are searched,
+     * thus the document is scanned at memory speed. Keys, values and section names are
+     * views into the given source with surrounding white space removed. Empty lines and
+     * lines starting with ; or # are skipped. A line without = is a key with an empty
+     * value. Both \n and \r\n line endings are supported.
+     * @tparam inlinecomments_ Mixed time option to remove comments that follow values.
+     * @tparam quotes_ Mixed time option to remove quotes surrounding values.
+     * @param source Part of the document to be scanned, should start at a line.
+     * @param settings Mixed time settings in the order of inline comments and quotes.
+     * @param func Called with an IniLine for each section header and key value pair. If
+     *        it returns bool, returning false stops the scan.
+     * @param line Line number of the start of the source in the document.
+     * @param offset Byte offset of the start of the source in the document.
+     * @return false if the scan is stopped by func.
+     * @throws std::runtime_error if a section header is not terminated.
+     */
+    template<YesNoRuntime inlinecomments_, YesNoRuntime quotes_, class F_>
+    bool ScanIni(std::string_view source, const std::array<bool, 2> &settings, F_ &&func, size_t line = 1, size_t offset = 0) {
+        //mixed time options
+        const bool inlinecomments = GetMixedTimeOption<inlinecomments_, 0>(settings);
+        const bool quotes = GetMixedTimeOption<quotes_, 1>(settings);
+
+        auto data = source.data();
+        auto size = source.size();
+        auto pos  = size_t{0};
+
+        for(; pos < size; line++) {
+            auto newline = static_cast<const char *>(std::memchr(data + pos, '\n', size - pos));
+            auto end     = newline ? static_cast<size_t>(newline - data) : size;
+            auto start   = pos;
+
+            pos = end + 1;
+
+            if(end > start && data[end - 1] == '\r')
+                end--;
+
+            auto begin = start;
+            while(begin < end && IsIniBlank(data[begin]))
+                begin++;
+
+            if(begin == end || data[begin] == ';' || data[begin] == '#')
+                continue;
+
+            auto entry = IniLine{};
+            entry.line    = line;
+            entry.keychar = begin - start + 1;
+
+            if(data[begin] == '[') {
+                auto close = static_cast<const char *>(std::memchr(data + begin + 1, ']', end - begin - 1));
+                if(!close)
+                    throw std::runtime_error("Unterminated section header on line " + std::to_string(line));
+
+                auto name = std::string_view{data + begin + 1, static_cast<size_t>(close - data) - begin - 1};
+                auto trimmed = TrimIni(name);
+
+                entry.type      = IniLine::Section;
+                entry.key       = trimmed;
+                entry.keyoffset = offset + static_cast<size_t>(trimmed.data() - data);
+                entry.keychar  += UTF8CodePoints({data + begin, static_cast<size_t>(trimmed.data() - data) - begin});
+            }
+            else {
+                auto separator = static_cast<const char *>(std::memchr(data + begin, '=', end - begin));
+                auto keyend    = separator ? static_cast<size_t>(separator - data) : end;
+                auto value     = separator ? TrimIni({separator + 1, end - keyend - 1}) : std::string_view{data + end, 0};
+
+                if(inlinecomments)
+                    value = StripIniComment(value, quotes);
+
+                if(quotes && value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front())
+                    value = value.substr(1, value.size() - 2);
+
+                entry.type        = IniLine::KeyValue;
+                entry.key         = TrimIni({data + begin, keyend - begin});
+                entry.keyoffset   = offset + begin;
+                entry.value       = value;
+                entry.valueoffset = offset + static_cast<size_t>(value.data() - data);
+                entry.valuechar   = entry.keychar + UTF8CodePoints({data + begin, static_cast<size_t>(value.data() - data) - begin});
+            }
+
+            if constexpr(std::is_same_v<decltype(func(static_cast<const IniLine &>(entry))), bool>) {
+                if(!func(static_cast<const IniLine &>(entry)))
+                    return false;
+            }
+            else {
+                func(static_cast<const IniLine &>(entry));
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Finds the section headers of an INI document without splitting other lines.
+     * Headers are detected exactly as ScanIni does.
+     * @param func Called with an IniLine of type Section for each header, the byte offset
+     *        of the header line and the byte offset of the line that follows it.
+     * @throws std::runtime_error if a section header is not terminated.
+     */
+    template<class F_>
+    void ScanIniSections(std::string_view source, F_ &&func) {
+        auto data = source.data();
+        auto size = source.size();
+        auto pos  = size_t{0};
+
+        for(size_t line = 1; pos < size; line++) {
+            auto newline = static_cast<const char *>(std::memchr(data + pos, '\n', size - pos));
+            auto end     = newline ? static_cast<size_t>(newline - data) : size;
+            auto start   = pos;
+            auto begin   = pos;
+
+            pos = end + 1;
+
+            while(begin < end && IsIniBlank(data[begin]))
+                begin++;
+
+            if(begin == end || data[begin] != '[')
+                continue;
+
+            auto close = static_cast<const char *>(std::memchr(data + begin + 1, ']', end - begin - 1));
+            if(!close)
+                throw std::runtime_error("Unterminated section header on line " + std::to_string(line));
+
+            auto name = TrimIni({data + begin + 1, static_cast<size_t>(close - data) - begin - 1});
+
+            auto entry = IniLine{};
+            entry.type      = IniLine::Section;
+            entry.key       = name;
+            entry.line      = line;
+            entry.keyoffset = static_cast<size_t>(name.data() - data);
+            entry.keychar   = 1 + UTF8CodePoints({data + start, entry.keyoffset - start});
+
+            func(static_cast<const IniLine &>(entry), start, std::min(pos, size));
+        }
+    }
+
+    /// Creates a location for INI parsing, unused parts are ignored by the location type.
+    template<LocationConcept LocationType>
+    LocationType MakeIniLocation(size_t offset, size_t line, size_t character, const std::optional<std::string> &resource) {
+        auto location = LocationType{offset, line, character};
+
+        if constexpr(LocationType::HasResourceName())
+            location.ResourceName = resource;
+
+        return location;
+    }
+
+    /**
+     * @brief Stores scanned INI lines into data.
+     * Section headers create a map in the root, values are stored in the current section
+     * or in the root before the first section. Repeated sections are merged and repeated
+     * keys replace the earlier value. Key locations are recorded in the map that contains
+     * the key, locations of the values and sections are stored in their data.
+     */
+    template<DataConcept DataType>
+    class iniloader {
+    public:
+        using DataTraits   = DataType::DataTraits;
+        using LocationType = DataTraits::LocationType;
+        using KeyType      = DataTraits::KeyType;
+        using ParserType   = DataTraits::DataParserType;
+
+        /// Root should already be a map. Values are stored into section, which should be
+        /// the root or a map within it.
+        iniloader(DataType &root_, DataType &section_, std::optional<std::string> resource_) :
+            root(root_), section(&section_), resource(std::move(resource_))
+        { }
+
+        void operator()(const IniLine &line) {
+            auto keylocation = makelocation(line.keyoffset, line.line, line.keychar);
+
+            if(line.type == IniLine::Section) {
+                //section pointer stays valid until the next section is inserted
+                auto [it, inserted] = root.GetMap().try_emplace(KeyType(line.key));
+                section = &it->second;
+
+                if(inserted || !section->IsMap()) {
+                    section->EmplaceMap();
+                    section->SetLocation(keylocation);
+                }
+
+                root.SetKeyLocation(it->first, std::move(keylocation));
+                return;
+            }
+
+            auto &value = section->GetMap().try_emplace(KeyType(line.key)).first->second;
+            auto context = Context<LocationType>{makelocation(line.valueoffset, line.line, line.valuechar), {}};
+
+            if constexpr(InPlaceDataParserConcept<ParserType, LocationType, DataType>) {
+                parser(context, line.value, value);
+            }
+            else {
+                auto [location, data] = parser(context, line.value);
+                value.SetData(std::move(data));
+                value.SetLocation(std::move(location));
+            }
+
+            section->SetKeyLocation(KeyType(line.key), std::move(keylocation));
+        }
+
+        LocationType makelocation(size_t offset, size_t line, size_t character) const {
+            return MakeIniLocation<LocationType>(offset, line, character, resource);
+        }
+
+    private:
+        DataType &root;
+        DataType *section;
+        std::optional<std::string> resource;
+        ParserType parser{};
+    };
+
+    /**
+     * @brief Parses the given reader as an INI document into the target.
+     * Target becomes a map, keys before the first section are stored directly in it and
+     * each section is stored as a map, see iniloader.
+     * @tparam inlinecomments_ Mixed time option to remove comments that follow values.
+     * @tparam quotes_ Mixed time option to remove quotes surrounding values.
+     * @param settings Mixed time settings in the order of inline comments and quotes.
+     */
+    template<YesNoRuntime inlinecomments_, YesNoRuntime quotes_, SourceConcept SourceType, DataConcept DataType>
+    void ParseIni(SourceType &reader, DataType &target, const std::array<bool, 2> &settings) {
+        if constexpr(std::is_same_v<typename DataType::StorageType, std::string_view>) {
+            static_assert(
+                std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>,
+                "View storage requires a source that returns views to its own buffer, such as Source<std::string_view>"
+            );
+        }
+
+        //whole document is scanned at once, streams are read into a buffer
+        auto raw = reader.Read(std::numeric_limits<size_t>::max());
+
+        auto loader = iniloader<DataType>(target, target, reader.GetResourceName());
+
+        target.EmplaceMap();
+        target.SetLocation(loader.makelocation(0, 1, 1));
+
+        ScanIni<inlinecomments_, quotes_>(std::string_view{raw}, settings, loader);
+    }
+
+    /**
+     * @brief Scans the given reader as an INI document and reports each value to the handler.
+     * No data is built. The path of the context has the section, if any, followed by the
+     * key. Views in the context and the value are only valid during the call. Sources
+     * that return views are scanned in place, streams are read in chunks of complete
+     * lines, thus memory use does not depend on the document size.
+     * @tparam inlinecomments_ Mixed time option to remove comments that follow values.
+     * @tparam quotes_ Mixed time option to remove quotes surrounding values.
+     * @param settings Mixed time settings in the order of inline comments and quotes.
+     * @param handler Called with the context and the value, returning false from a bool
+     *        returning handler stops parsing.
+     * @param chunksize Number of bytes to read from streams at once.
+     */
+    template<
+        YesNoRuntime inlinecomments_, YesNoRuntime quotes_,
+        LocationConcept LocationType, SourceConcept SourceType, class F_
+    >
+    void ParseIniEvents(SourceType &reader, const std::array<bool, 2> &settings, F_ &&handler, size_t chunksize = 64 * 1024) {
+        auto resource = reader.GetResourceName();
+        auto context  = Context<LocationType>{};
+
+        //section name should survive the chunk it is read from
+        auto section = std::string{};
+
+        auto onvalue = [&](const IniLine &line) {
+            if(line.type == IniLine::Section) {
+                section = line.key;
+                context.path.entries.resize(1);
+                context.path.entries[0] = Path::Entry{Path::Map, std::string_view{section}};
+
+                return true;
+            }
+
+            context.path.entries.emplace_back(Path::Map, line.key);
+            context.location = MakeIniLocation<LocationType>(line.valueoffset, line.line, line.valuechar, resource);
+
+            auto proceed = true;
+            if constexpr(std::is_same_v<decltype(handler(std::as_const(context), line.value)), bool>)
+                proceed = handler(std::as_const(context), line.value);
+            else
+                handler(std::as_const(context), line.value);
+
+            context.path.entries.pop_back();
+
+            return proceed;
+        };
+
+        if constexpr(std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>) {
+            ScanIni<inlinecomments_, quotes_>(reader.Read(std::numeric_limits<size_t>::max()), settings, onvalue);
+        }
+        else {
+            auto buffer = std::string{};
+            auto line   = size_t{1};
+            auto offset = size_t{0};
+
+            while(!reader.IsEof()) {
+                buffer += reader.Read(chunksize);
+
+                //only complete lines are scanned, the rest waits for the next chunk
+                auto end = reader.IsEof() ? buffer.size() : buffer.rfind('\n') + 1;
+                if(end == 0)
+                    continue;
+
+                auto lines = std::string_view{buffer}.substr(0, end);
+
+                if(!ScanIni<inlinecomments_, quotes_>(lines, settings, onvalue, line, offset))
+                    return;
+
+                line   += static_cast<size_t>(std::count(lines.begin(), lines.end(), '\n'));
+                offset += end;
+                buffer.erase(0, end);
+            }
+        }
+    }
+
+    /// Checks if the value should be quoted to be read back as is.
+    inline bool IniNeedsQuotes(std::string_view value) {
+        if(value.empty())
+            return false;
+
+        return
+            IsIniBlank(value.front()) || IsIniBlank(value.back()) ||
+            value.front() == '"' || value.front() == '\'' ||
+            value.find_first_of(";#") != std::string_view::npos;
+    }
+
+    /// Returns the quote character that can surround the value, quotes are not escaped,
+    /// thus the value should not contain the chosen quote. Returns 0 if the value contains
+    /// both quotes.
+    inline char IniQuoteFor(std::string_view value) {
+        if(value.find('"') == std::string_view::npos)
+            return '"';
+
+        if(value.find('\'') == std::string_view::npos)
+            return '\'';
+
+        return 0;
+    }
+
+    /// Checks if the key is read back as is by ScanIni.
+    inline bool IsIniKeyValid(std::string_view key) {
+        if(key.empty())
+            return true;
+
+        return
+            !IsIniBlank(key.front()) && !IsIniBlank(key.back()) &&
+            key.front() != '[' && key.front() != ';' && key.front() != '#' &&
+            key.find_first_of("=\r\n") == std::string_view::npos;
+    }
+
+    /// Checks if the section name is read back as is by ScanIni.
+    inline bool IsIniSectionValid(std::string_view name) {
+        if(name.empty())
+            return true;
+
+        return
+            !IsIniBlank(name.front()) && !IsIniBlank(name.back()) &&
+            name.find_first_of("]\r\n") == std::string_view::npos;
+    }
+
+    /**
+     * @brief Emits the given map data as an INI document.
+     * Scalars in the root map are written first, followed by a section for each map.
+     * Values are converted by the data emitter.
+     * @tparam quotes_ Mixed time option to quote values that would not be read back as is.
+     * @param settings Mixed time settings containing quotes option.
+     * @throws std::invalid_argument if sections are nested, a key or a section name would
+     *         not be read back as is, a value contains a line break or a value that needs
+     *         quotes contains both quote characters.
+     */
+    template<YesNoRuntime quotes_, DataConcept DataType, TargetConcept TargetType>
+    void EmitIni(const DataType &source, TargetType &target, const std::array<bool, 1> &settings) {
+        using DataTraits = DataType::DataTraits;
+
+        //mixed time options
+        const bool quotes = GetMixedTimeOption<quotes_, 0>(settings);
+
+        typename DataTraits::DataEmitterType emitter{};
+
+        //returns true if any value is written
+        auto emitvalues = [&](const DataType &map, bool nested) {
+            auto written = false;
+            
+            for(auto &[key, value] : map.GetMap()) {
+                if(value.IsMap()) {
+                    if(nested)
+                        throw std::invalid_argument("INI sections cannot be nested");
+
+                    continue;
+                }
+
+                //emitters may return a reference to the stored value
+                decltype(auto) data = emitter(value.GetData());
+                auto text = std::string_view{data};
+
+                if(text.find_first_of("\r\n") != std::string_view::npos)
+                    throw std::invalid_argument("INI values cannot contain line breaks");
+
+                if(!IsIniKeyValid(key)) {
+                    throw std::invalid_argument(
+                        "INI key '" + std::string(key) + "' cannot contain = or line breaks, start with [, ; "
+                        "or # or have surrounding white space"
+                    );
+                }
+
+                auto quote = char{0};
+
+                if(quotes && IniNeedsQuotes(text)) {
+                    quote = IniQuoteFor(text);
+
+                    if(!quote)
+                        throw std::invalid_argument("INI value of '" + std::string(key) + "' needs quotes but contains both quote characters");
+                }
+
+                target.Put(key);
+                target.Put(" = ");
+
+                if(quote) {
+                    target.Put(quote);
+                    target.Put(text);
+                    target.Put(quote);
+                }
+                else {
+                    target.Put(text);
+                }
+
+                target.Put('\n');
+                written = true;
+            }
+            
+            return written;
+        };
+
+        auto separate = emitvalues(source, false);
+
+        for(auto &[key, value] : source.GetMap()) {
+            if(!value.IsMap())
+                continue;
+
+            if(!IsIniSectionValid(key)) {
+                throw std::invalid_argument(
+                    "INI section '" + std::string(key) + "' cannot contain ] or line breaks or have surrounding white space"
+                );
+            }
+
+            if(separate)
+                target.Put('\n');
+
+            target.Put('[');
+            target.Put(key);
+            target.Put("]\n");
+
+            emitvalues(value, true);
+            separate = true;
+        }
+    }
+
+}
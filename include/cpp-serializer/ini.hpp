@@ -2,11 +2,462 @@
 
 #include "config.hpp"
 
+#include "concepts.hpp"
 #include "data.hpp"
+#include "ini-helper.hpp"
+#include "location.hpp"
+#include "ordered-map.hpp"
+#include "source.hpp"
+#include "target.hpp"
+#include "txt-helper.hpp"
+#include "types.hpp"
 
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "macros.hpp"
 
 namespace CPP_SERIALIZER_NAMESPACE {
 
+    /**
+     * @brief Data traits for INI documents.
+     * Documents are stored as a map of sections, each section is a map of string values.
+     * Keys before the first section are stored in the root map.
+     */
+    template<LocationConcept LocationType_>
+    struct IniDataTraits {
+        using StorageType = std::string;
+
+        using NumberType = void;
+        using IntegerType = void;
+        using RealType = void;
+        using StringType = std::string;
+        using NullType = void;
+        using BoolType = void;
+        using IndexType = void;
+        using SequenceType = void;
+        using KeyType = std::string;
+        using MapType = LocatedHashMap<std::string, Data<IniDataTraits>, LocationType_>;
+
+        using DataParserType = internal::SimpleTextDataConverter<LocationType_>;
+        using DataEmitterType = internal::SimpleTextDataConverter<LocationType_>;
+        using LocationType = LocationType_;
+    };
+
+    /**
+     * @brief INI data traits that refer to the parsed buffer instead of owning copies.
+     * Keys, section names and values are views to the source buffer, thus parsing only
+     * allocates for the maps. Parsed data is only valid as long as the buffer given to the
+     * parser is alive and unmodified. Only sources that return views to their buffer, such
+     * as Source<std::string_view>, can be used; this is checked at compile time.
+     */
+    template<LocationConcept LocationType_>
+    struct ViewIniDataTraits {
+        using StorageType = std::string_view;
+
+        using NumberType = void;
+        using IntegerType = void;
+        using RealType = void;
+        using StringType = std::string_view;
+        using NullType = void;
+        using BoolType = void;
+        using IndexType = void;
+        using SequenceType = void;
+        using KeyType = std::string_view;
+        using MapType = LocatedHashMap<std::string_view, Data<ViewIniDataTraits>, LocationType_>;
+
+        using DataParserType = internal::ViewTextDataConverter<LocationType_>;
+        using DataEmitterType = internal::ViewTextDataConverter<LocationType_>;
+        using LocationType = LocationType_;
+    };
+
+    struct SimpleIniSettings {
+        constexpr static auto InlineComments = YesNoRuntime::No;
+        constexpr static auto Quotes = YesNoRuntime::Yes;
+
+        using DataTraits = IniDataTraits<LineLocation>;
+        using DataType   = Data<DataTraits>;
+    };
+
+    template<class Location = LineLocation>
+    struct RuntimeIniSettings {
+        constexpr static auto InlineComments = YesNoRuntime::Runtime;
+        constexpr static auto Quotes = YesNoRuntime::Runtime;
+
+        using DataTraits = IniDataTraits<Location>;
+        using DataType   = Data<DataTraits>;
+    };
+
+    /// INI settings that parse without copying, see ViewIniDataTraits for lifetime
+    /// requirements.
+    template<class Location = LineLocation>
+    struct ViewIniSettings {
+        constexpr static auto InlineComments = YesNoRuntime::Runtime;
+        constexpr static auto Quotes = YesNoRuntime::Runtime;
+
+        using DataTraits = ViewIniDataTraits<Location>;
+        using DataType   = Data<DataTraits>;
+    };
+
+    /**
+     * @brief Index of the section headers of an INI document.
+     * Index is built by a single scan that only looks for header lines, thus a large
+     * document can be indexed quickly and then individual sections can be parsed on
+     * demand using IniTransport::ParseSection. Entries are sorted by name. An index can be
+     * saved and loaded back, for instance next to the document, to skip the scan on the
+     * next run. Index is only valid for the document it is built from; size of the
+     * document and the header names are checked when a section is parsed.
+     */
+    class IniSectionIndex {
+    public:
+        /// A section header and the range of its contents.
+        struct Entry {
+            /// Name of the section
+            std::string Name;
+
+            /// Byte offset, line and character offset of the name in the document
+            size_t NameOffset = 0;
+            size_t Line       = 0;
+            size_t NameChar   = 0;
+
+            /// Byte range of the section contents, from the line after the header up to
+            /// the next header line
+            size_t Begin = 0;
+            size_t End   = 0;
+
+            bool operator==(const Entry &) const = default;
+        };
+
+        IniSectionIndex() = default;
+
+        /**
+         * @brief Builds the index of the given document.
+         * @throws std::runtime_error if a section header is not terminated.
+         */
+        static IniSectionIndex Build(std::string_view source) {
+            auto index = IniSectionIndex{};
+            index.sourcesize = source.size();
+
+            internal::ScanIniSections(source, [&](const internal::IniLine &line, size_t linestart, size_t next) {
+                if(!index.entries.empty())
+                    index.entries.back().End = linestart;
+
+                index.entries.push_back({std::string(line.key), line.keyoffset, line.line, line.keychar, next, source.size()});
+            });
+
+            std::ranges::stable_sort(index.entries, std::less<>{}, &Entry::Name);
+
+            return index;
+        }
+
+        /// Returns the entries of the given section in document order, empty if the
+        /// section does not exist. Repeated sections have multiple entries.
+        std::span<const Entry> Find(std::string_view name) const {
+            auto [first, last] = std::equal_range(
+                entries.begin(), entries.end(), name,
+                [](const auto &left, const auto &right) { return nameof(left) < nameof(right); }
+            );
+
+            return {first, last};
+        }
+
+        bool SectionExists(std::string_view name) const {
+            return !Find(name).empty();
+        }
+
+        /// All entries sorted by name.
+        const std::vector<Entry> &GetEntries() const {
+            return entries;
+        }
+
+        /// Size of the indexed document in bytes.
+        size_t GetSourceSize() const {
+            return sourcesize;
+        }
+
+        /// Writes the index in a line based text format that can be read by Load.
+        void Save(std::ostream &output) const {
+            output << "cppser-ini-index 1\n" << sourcesize << ' ' << entries.size() << '\n';
+
+            for(auto &entry : entries) {
+                output
+                    << entry.NameOffset << ' ' << entry.Line << ' ' << entry.NameChar << ' '
+                    << entry.Begin << ' ' << entry.End << ' ' << entry.Name << '\n';
+            }
+        }
+
+        /**
+         * @brief Reads an index written by Save.
+         * Entry count is checked against the rest of the input when the stream can seek,
+         * ranges are checked against the document size and entries should be sorted by
+         * name, thus a damaged index is rejected here instead of while parsing a section.
+         * @throws std::runtime_error if the input is not a valid index.
+         */
+        static IniSectionIndex Load(std::istream &input) {
+            auto index = IniSectionIndex{};
+            auto header = std::string{};
+            auto version = 0;
+            auto count = size_t{0};
+
+            input >> header >> version >> index.sourcesize >> count;
+            if(!input || header != "cppser-ini-index" || version != 1)
+                throw std::runtime_error("Invalid INI section index");
+
+            //an entry is five numbers and the name, each followed by a separator
+            auto remaining = remainingsize(input);
+            if(remaining && count > *remaining / 10)
+                throw std::runtime_error("Invalid INI section index");
+
+            //without the size of the input, entries are added as they are read
+            index.entries.reserve(remaining ? count : 0);
+
+            for(size_t i = 0; i < count; i++) {
+                auto &entry = index.entries.emplace_back();
+
+                input >> entry.NameOffset >> entry.Line >> entry.NameChar >> entry.Begin >> entry.End;
+
+                //name is the rest of the line, it may contain spaces
+                if(!input || input.get() != ' ' || !std::getline(input, entry.Name))
+                    throw std::runtime_error("Invalid INI section index");
+
+                if(
+                    entry.Begin > entry.End || entry.End > index.sourcesize ||
+                    entry.NameOffset > entry.Begin || entry.Name.size() > entry.Begin - entry.NameOffset
+                )
+                    throw std::runtime_error("Invalid INI section index");
+            }
 
+            if(!std::ranges::is_sorted(index.entries, std::less<>{}, &Entry::Name))
+                throw std::runtime_error("Invalid INI section index");
+
+            return index;
+        }
+
+        bool operator==(const IniSectionIndex &) const = default;
+
+    private:
+        static std::string_view nameof(std::string_view name) { return name; }
+        static std::string_view nameof(const Entry &entry) { return entry.Name; }
+
+        /// Number of bytes left in the given stream, none if the stream cannot seek.
+        static std::optional<size_t> remainingsize(std::istream &input) {
+            auto position = input.tellg();
+            if(position == std::istream::pos_type(-1))
+                return std::nullopt;
+
+            input.seekg(0, std::ios::end);
+            auto end = input.tellg();
+            input.seekg(position);
+
+            if(end == std::istream::pos_type(-1) || !input)
+                return std::nullopt;
+
+            return static_cast<size_t>(end - position);
+        }
+
+        std::vector<Entry> entries;
+        size_t sourcesize = 0;
+    };
+
+    CPPSER_DEFINE_MIXTIME_STRUCT(IniTransport, InlineComments, inlinecomments, false)
+    CPPSER_DEFINE_MIXTIME_STRUCT(IniTransport, Quotes, quotes, true)
+
+    /**
+     * @brief Allows parsing and emitting INI documents.
+     *
+     * Documents consist of [section] headers and key = value lines, lines starting with ; or
+     * # are comments. Parsed data is a map of sections and the location of every key is
+     * recorded in the map containing it, see Data::GetKeyLocation. If quotes is set, quotes
+     * surrounding a value are removed while parsing and values that would otherwise change
+     * are quoted while emitting. If inline comments is set, ; or # after white space starts
+     * a comment.
+     *
+     * @tparam Settings_ INI transport settings, should follow IniSettingsConcept
+     */
+    template<IniSettingsConcept Settings_ = SimpleIniSettings>
+    class IniTransport :
+        public internal::IniTransport_inlinecomments_helper<Settings_::InlineComments>,
+        public internal::IniTransport_quotes_helper<Settings_::Quotes>
+    {
+    public:
+        using Settings     = Settings_;
+        using DataType     = Settings::DataType;
+        using DataTraits   = Settings::DataTraits;
+        using StorageType  = DataType::StorageType;
+        using LocationType = DataTraits::LocationType;
+
+        /**
+         * @brief Parses a given source into the given data target.
+         * Existing contents of the data are replaced.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source. Streams are
+         *        read to the end before parsing.
+         * @param data Data target, this variable will be filled with the parsed document.
+         * @throws std::runtime_error if a section header is not terminated.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        void Parse(Source_ &source, DataType &data) {
+            auto reader = make_source<AutoTranslateSource>(source);
+
+            auto settings = std::array<bool, 2>{};
+
+            CPPSER_READ_IF_RUNTIME(InlineComments, 0);
+            CPPSER_READ_IF_RUNTIME(Quotes, 1);
+
+            DispatchMixedTime<Settings::InlineComments, Settings::Quotes>(
+                settings,
+                [&]<YesNoRuntime inlinecomments_, YesNoRuntime quotes_>() {
+                    internal::ParseIni<inlinecomments_, quotes_>(reader, data, settings);
+                }
+            );
+        }
+
+        /**
+         * @brief Parses a given source without building data, calling the handler for
+         * every value.
+         * Handler is called as handler(const Context<LocationType> &, std::string_view value).
+         * The path of the context contains the section, if any, and the key; the location
+         * of the context is the location of the value. Views are only valid during the
+         * call. If the handler returns bool, returning false stops parsing, thus a few
+         * fields can be extracted without reading the rest of the document. Streams are
+         * read in chunks, memory use does not grow with the document.
+         * @throws std::runtime_error if a section header is not terminated.
+         */
+        template<bool AutoTranslateSource = true, class Source_, class F_>
+        requires std::invocable<F_ &, const Context<LocationType> &, std::string_view>
+        void ParseEvents(Source_ &source, F_ &&handler) {
+            auto reader = make_source<AutoTranslateSource>(source);
+
+            auto settings = std::array<bool, 2>{};
+
+            CPPSER_READ_IF_RUNTIME(InlineComments, 0);
+            CPPSER_READ_IF_RUNTIME(Quotes, 1);
+
+            DispatchMixedTime<Settings::InlineComments, Settings::Quotes>(
+                settings,
+                [&]<YesNoRuntime inlinecomments_, YesNoRuntime quotes_>() {
+                    internal::ParseIniEvents<inlinecomments_, quotes_, LocationType>(reader, settings, handler);
+                }
+            );
+        }
+
+        /**
+         * @brief Builds the section index of the given source, see IniSectionIndex.
+         * Source should return views to its buffer, such as a memory mapped file wrapped
+         * in a std::string_view.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        IniSectionIndex IndexSections(Source_ &source) {
+            auto reader = make_source<AutoTranslateSource>(source);
+            static_assert(
+                std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>,
+                "Section index requires a source that returns views to its own buffer"
+            );
+
+            return IniSectionIndex::Build(reader.Read(std::numeric_limits<size_t>::max()));
+        }
+
+        /**
+         * @brief Parses only the given section using the index.
+         * Data becomes a map of the values in the section located at its header; repeated
+         * sections are merged. Locations refer to the whole document.
+         * @param source Source the index is built from.
+         * @return false if the section does not exist, data is not changed in that case.
+         * @throws std::runtime_error if the index does not match the source.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        bool ParseSection(Source_ &source, const IniSectionIndex &index, std::string_view name, DataType &data) {
+            auto reader = make_source<AutoTranslateSource>(source);
+            static_assert(
+                std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>,
+                "Section index requires a source that returns views to its own buffer"
+            );
+
+            auto raw = reader.Read(std::numeric_limits<size_t>::max());
+            auto entries = index.Find(name);
+
+            if(raw.size() != index.GetSourceSize())
+                throw std::runtime_error("INI section index does not match the source");
+
+            if(entries.empty())
+                return false;
+
+            for(auto &entry : entries) {
+                if(entry.End > raw.size() || raw.substr(entry.NameOffset, entry.Name.size()) != entry.Name)
+                    throw std::runtime_error("INI section index does not match the source");
+            }
+
+            auto settings = std::array<bool, 2>{};
+
+            CPPSER_READ_IF_RUNTIME(InlineComments, 0);
+            CPPSER_READ_IF_RUNTIME(Quotes, 1);
+
+            auto loader = internal::iniloader<DataType>(data, data, reader.GetResourceName());
+            auto &first = entries.front();
+
+            data.EmplaceMap();
+            data.SetLocation(loader.makelocation(first.NameOffset, first.Line, first.NameChar));
+
+            DispatchMixedTime<Settings::InlineComments, Settings::Quotes>(
+                settings,
+                [&]<YesNoRuntime inlinecomments_, YesNoRuntime quotes_>() {
+                    for(auto &entry : entries) {
+                        internal::ScanIni<inlinecomments_, quotes_>(
+                            raw.substr(entry.Begin, entry.End - entry.Begin), settings, loader,
+                            entry.Line + 1, entry.Begin
+                        );
+                    }
+                }
+            );
+
+            return true;
+        }
+
+        /// Parses a given source and returns the result, see Parse(source, data).
+        template<bool AutoTranslateSource = true, class Source_>
+        DataType Parse(Source_ &source) {
+            DataType data;
+            Parse<AutoTranslateSource>(source, data);
+            return data;
+        }
+
+        /**
+         * @brief Emits the given document to the given target.
+         * Data should be a map, scalars of the root map are written before the sections.
+         * @throws std::invalid_argument if sections are nested or a value contains a line
+         *         break.
+         */
+        template<class T_>
+        void Emit(const DataType &data, T_ &target) {
+            auto writer = make_target(target);
+
+            auto settings = std::array<bool, 1>{};
+            CPPSER_READ_IF_RUNTIME(Quotes, 0);
+
+            DispatchMixedTime<Settings::Quotes>(
+                settings,
+                [&]<YesNoRuntime quotes_>() {
+                    internal::EmitIni<quotes_>(data, writer, settings);
+                }
+            );
+        }
+    };
+
+    inline IniTransport<> IniTransportSimple;
+    using RuntimeIniTransport = IniTransport<RuntimeIniSettings<>>;
+    using ViewIniTransport = IniTransport<ViewIniSettings<>>;
 
 }
+
+#include "unmacro.hpp"
@@ -3,8 +3,13 @@
 #include "config.hpp"
 
 #include "cpp-serializer/concepts.hpp"
+#include "cpp-serializer/memory-usage.hpp"
 #include "cpp-serializer/utf.hpp"
+#include <algorithm>
+#include <cstddef>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <variant>
 #include <vector>
@@ -14,6 +19,74 @@
 namespace CPP_SERIALIZER_NAMESPACE {
     
     namespace internal {
+        /**
+         * @brief Sorted map of skip points stored in a contiguous array.
+         * Skip points are added in increasing offsets during parsing, thus adding to the 
+         * end is constant time. Clearing keeps the memory, allowing it to be reused by the
+         * next parse. Supports the subset of std::map interface used by skip lists.
+         */
+        template<class Value_, class Allocator_ = std::allocator<std::pair<size_t, Value_>>>
+        class FlatSkipList {
+        public:
+            using value_type     = std::pair<size_t, Value_>;
+            using allocator_type = typename std::allocator_traits<Allocator_>::template rebind_alloc<value_type>;
+            using iterator       = typename std::vector<value_type, allocator_type>::iterator;
+            using const_iterator = typename std::vector<value_type, allocator_type>::const_iterator;
+
+            FlatSkipList() = default;
+
+            explicit FlatSkipList(const allocator_type &alloc) : entries(alloc) { }
+
+            /// Returns the entry at the given offset, creating it if necessary.
+            Value_ &operator[](size_t offset) {
+                if(entries.empty() || entries.back().first < offset) {
+                    return entries.emplace_back(offset, Value_{}).second;
+                }
+
+                auto it = std::lower_bound(
+                    entries.begin(), entries.end(), offset, 
+                    [](const value_type &entry, size_t off) { return entry.first < off; }
+                );
+
+                if(it == entries.end() || it->first != offset)
+                    it = entries.emplace(it, offset, Value_{});
+
+                return it->second;
+            }
+
+            /// Returns the first entry with an offset greater than the given offset.
+            const_iterator upper_bound(size_t offset) const {
+                return std::upper_bound(
+                    entries.begin(), entries.end(), offset, 
+                    [](size_t off, const value_type &entry) { return off < entry.first; }
+                );
+            }
+
+            iterator begin() { return entries.begin(); }
+            iterator end() { return entries.end(); }
+            const_iterator begin() const { return entries.begin(); }
+            const_iterator end() const { return entries.end(); }
+
+            friend iterator begin(FlatSkipList &list) { return list.begin(); }
+            friend iterator end(FlatSkipList &list) { return list.end(); }
+            friend const_iterator begin(const FlatSkipList &list) { return list.begin(); }
+            friend const_iterator end(const FlatSkipList &list) { return list.end(); }
+
+            bool empty() const { return entries.empty(); }
+            size_t size() const { return entries.size(); }
+            size_t capacity() const { return entries.capacity(); }
+            const value_type *data() const { return entries.data(); }
+
+            /// Removes all entries without releasing the memory.
+            void clear() { entries.clear(); }
+            void reserve(size_t size) { entries.reserve(size); }
+
+            allocator_type get_allocator() const { return entries.get_allocator(); }
+
+        private:
+            std::vector<value_type, allocator_type> entries;
+        };
+
         /// Internal implementation of ObtainLocation calls in Location structures.
         template<LocationConcept Parent, bool skiplist = Parent::HasSkipList()> 
         Parent::ObtainedType ObtainLocation(const Parent &source, size_t byte_offset, const std::string_view &data) {
@@ -83,6 +156,9 @@ namespace CPP_SERIALIZER_NAMESPACE {
         static constexpr bool HasSkipList() { return false; }
         static constexpr bool HasResourceName() { return false; }
 
+        /// Location without a skip list or resource name does not allocate
+        MemoryUsage GetMemoryUsage() const { return {}; }
+
         /// Obtains line location from the given offset and data
         auto Obtain(size_t, const std::string_view &) {
             return ObtainedType{};
@@ -111,6 +187,9 @@ namespace CPP_SERIALIZER_NAMESPACE {
         static constexpr bool HasSkipList() { return false; }
         static constexpr bool HasResourceName() { return false; }
 
+        /// Location without a skip list or resource name does not allocate
+        MemoryUsage GetMemoryUsage() const { return {}; }
+
         /// Obtains line location from the given offset and data
         auto Obtain(size_t byte_offset, const std::string_view &) {
             return ByteLocation{byte_offset};
@@ -143,6 +222,9 @@ namespace CPP_SERIALIZER_NAMESPACE {
         static constexpr bool HasSkipList() { return false; }
         static constexpr bool HasResourceName() { return false; }
 
+        /// Location without a skip list or resource name does not allocate
+        MemoryUsage GetMemoryUsage() const { return {}; }
+
         /// Obtains line location from the given offset and data
         auto Obtain(size_t byte_offset, const std::string_view &data) {
             return internal::ObtainLocation(*this, byte_offset, data);
@@ -176,6 +258,9 @@ namespace CPP_SERIALIZER_NAMESPACE {
         static constexpr bool HasLineOffset() { return true; }
         static constexpr bool HasSkipList() { return false; }
         static constexpr bool HasResourceName() { return false; }
+
+        /// Location without a skip list or resource name does not allocate
+        MemoryUsage GetMemoryUsage() const { return {}; }
     
         size_t LineOffset = 0;
         size_t CharOffset = 0;
@@ -211,6 +296,13 @@ namespace CPP_SERIALIZER_NAMESPACE {
         static constexpr bool HasLineOffset() { return true; }
         static constexpr bool HasSkipList() { return false; }
         static constexpr bool HasResourceName() { return true; }
+
+        MemoryUsage GetMemoryUsage() const {
+            auto usage = MemoryUsage{};
+            internal::AddMemoryUsage(usage, ResourceName, &MemoryUsage::Locations);
+
+            return usage;
+        }
         
         size_t LineOffset = 0;
         size_t CharOffset = 0;
@@ -230,24 +322,37 @@ namespace CPP_SERIALIZER_NAMESPACE {
      * If the text is not supplied, encoding is assumed to be
      * ASCII. Skip list is only necessary if there is whitespace
      * folding or escape character. It might however, improve lookup
-     * speed for the cost of additional memory.
+     * speed for the cost of additional memory. Skip list memory is obtained from the
+     * given allocator.
      */
-    struct InnerLocation {
-        using ObtainedType = LineLocation;
+    template<class Allocator_>
+    struct BasicInnerLocation {
+        using ObtainedType   = LineLocation;
+        using allocator_type = Allocator_;
         
-        InnerLocation() = default;
+        BasicInnerLocation() = default;
 
-        InnerLocation(size_t byte_offset,  size_t line_offset, size_t char_offset) :
+        BasicInnerLocation(size_t byte_offset,  size_t line_offset, size_t char_offset, const Allocator_ &alloc = {}) :
             ByteOffset(byte_offset),
             LineOffset(line_offset),
-            CharOffset(char_offset)
+            CharOffset(char_offset),
+            SkipList(alloc)
         { }
 
+        explicit BasicInnerLocation(const Allocator_ &alloc) : SkipList(alloc) { }
+
         static constexpr bool HasByteOffset() { return true; }
         static constexpr bool HasCharOffset() { return true; }
         static constexpr bool HasLineOffset() { return true; }
         static constexpr bool HasSkipList() { return true; }
-        static constexpr bool HasResourceName() { return true; }
+        static constexpr bool HasResourceName() { return false; }
+
+        MemoryUsage GetMemoryUsage() const {
+            auto usage = MemoryUsage{};
+            internal::AddMemoryUsage(usage, SkipList, &MemoryUsage::SkipLists);
+
+            return usage;
+        }
         
         /// Converts to a type without skip list
         operator ObtainedType() const {
@@ -257,39 +362,61 @@ namespace CPP_SERIALIZER_NAMESPACE {
         size_t ByteOffset = 0;
         size_t LineOffset = 0;
         size_t CharOffset = 0;
-        std::map<size_t, ObtainedType> SkipList;
+        internal::FlatSkipList<ObtainedType, Allocator_> SkipList;
         
         /// Obtains line location from the given offset and data
-        auto Obtain(size_t byte_offset, const std::string_view &data) {
+        ObtainedType Obtain(size_t byte_offset, const std::string_view &data) {
             return internal::ObtainLocation(*this, byte_offset, data);
         }
     };
+
+    using InnerLocation = BasicInnerLocation<std::allocator<std::byte>>;
     
     /**
      * Similar to InnerLocation, but in addition stores resource
      * name.
      */
-    struct GlobalInnerLocation {
-        using ObtainedType = GlobalLocation;
+    template<class Allocator_>
+    struct BasicGlobalInnerLocation {
+        using ObtainedType   = GlobalLocation;
+        using allocator_type = Allocator_;
 
-        GlobalInnerLocation() = default;
+        BasicGlobalInnerLocation() = default;
 
-        GlobalInnerLocation(size_t byte_offset,  size_t line_offset, size_t char_offset) :
-            GlobalInnerLocation(byte_offset, line_offset, char_offset, std::nullopt)
+        BasicGlobalInnerLocation(size_t byte_offset,  size_t line_offset, size_t char_offset, const Allocator_ &alloc = {}) :
+            BasicGlobalInnerLocation(byte_offset, line_offset, char_offset, std::nullopt, alloc)
         { }
 
-        GlobalInnerLocation(size_t byte_offset,  size_t line_offset, size_t char_offset, const std::optional<std::string> &resource_name) :
+        BasicGlobalInnerLocation(
+            size_t byte_offset,  size_t line_offset, size_t char_offset, 
+            const std::optional<std::string> &resource_name, const Allocator_ &alloc = {}
+        ) :
             ByteOffset(byte_offset),
             LineOffset(line_offset),
             CharOffset(char_offset),
-            ResourceName(resource_name)
+            ResourceName(resource_name),
+            SkipList(alloc)
         { }
+
+        explicit BasicGlobalInnerLocation(const Allocator_ &alloc) : SkipList(alloc) { }
         
         static constexpr bool HasByteOffset() { return true; }
         static constexpr bool HasCharOffset() { return true; }
         static constexpr bool HasLineOffset() { return true; }
         static constexpr bool HasSkipList() { return true; }
         static constexpr bool HasResourceName() { return true; }
+
+        /// Resource names of skip list entries are counted as a part of the skip list.
+        MemoryUsage GetMemoryUsage() const {
+            auto usage    = MemoryUsage{};
+            auto skiplist = MemoryUsage{};
+            
+            internal::AddMemoryUsage(usage, ResourceName, &MemoryUsage::Locations);
+            internal::AddMemoryUsage(skiplist, SkipList, &MemoryUsage::SkipLists);
+            usage.SkipLists += skiplist.Total();
+
+            return usage;
+        }
         
         /// Converts to a type without skip list
         operator ObtainedType() const {
@@ -300,14 +427,36 @@ namespace CPP_SERIALIZER_NAMESPACE {
         size_t LineOffset = 0;
         size_t CharOffset = 0;
         std::optional<std::string> ResourceName = "";
-        std::map<size_t, GlobalLocation> SkipList;
+        internal::FlatSkipList<GlobalLocation, Allocator_> SkipList;
         
         /// Obtains line location from the given offset and data
-        auto Obtain(size_t byte_offset, const std::string_view &data) {
+        ObtainedType Obtain(size_t byte_offset, const std::string_view &data) {
             return internal::ObtainLocation(*this, byte_offset, data);
         }
     };
 
+    using GlobalInnerLocation = BasicGlobalInnerLocation<std::allocator<std::byte>>;
+
+    namespace pmr {
+        /// Inner location with a skip list using polymorphic allocator.
+        using InnerLocation = BasicInnerLocation<std::pmr::polymorphic_allocator<std::byte>>;
+
+        /// Global inner location with a skip list using polymorphic allocator.
+        using GlobalInnerLocation = BasicGlobalInnerLocation<std::pmr::polymorphic_allocator<std::byte>>;
+    }
+
+    namespace internal {
+        /// Resets the given location to the start of a source. Memory of the skip list is kept.
+        template<LocationConcept LocationType>
+        void ResetLocation(LocationType &location) {
+            if constexpr(LocationType::HasByteOffset()) location.ByteOffset = 0;
+            if constexpr(LocationType::HasLineOffset()) location.LineOffset = 1;
+            if constexpr(LocationType::HasCharOffset()) location.CharOffset = 1;
+            if constexpr(LocationType::HasResourceName()) location.ResourceName = std::nullopt;
+            if constexpr(LocationType::HasSkipList()) location.SkipList.clear();
+        }
+    }
+
 #include "macros.hpp"
 
     /**
@@ -370,9 +519,11 @@ namespace CPP_SERIALIZER_NAMESPACE {
      * @brief Path data used in locating resources
      * Path data is used in complex sources such as xml and yaml to identify types. If the
      * system is used like a stream like parser, this information is passed to the parsing
-     * function along with the obtained data.
+     * function along with the obtained data, see IniTransport::ParseEvents.
      */
     struct Path {    
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
         /// Node type could be named or indexed. If nothing is actually used, cppser will
         /// create an index sequence
         enum Type {
@@ -382,14 +533,49 @@ namespace CPP_SERIALIZER_NAMESPACE {
         
         /// Entry for a node. Attributes are only used in some contextes such as xml.
         struct Entry {
-            Type type;
+            using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+            Entry() = default;
+            Entry(const Entry &) = default;
+            Entry(Entry &&) = default;
+
+            explicit Entry(const allocator_type &alloc) : attributes(alloc) { }
+
+            Entry(Type type_, std::variant<std::string_view, int> entry_, const allocator_type &alloc = {}) :
+                type(type_), entry(entry_), attributes(alloc)
+            { }
+
+            Entry(const Entry &other, const allocator_type &alloc) :
+                type(other.type), entry(other.entry), attributes(other.attributes, alloc)
+            { }
+
+            Entry(Entry &&other, const allocator_type &alloc) :
+                type(other.type), entry(other.entry), attributes(std::move(other.attributes), alloc)
+            { }
+
+            Entry &operator=(const Entry &) = default;
+            Entry &operator=(Entry &&) = default;
+
+            Type type = Sequence;
             std::variant<std::string_view, int> entry;
-            std::map<std::string, std::string> attributes;
+            std::pmr::map<std::pmr::string, std::pmr::string> attributes;
         };
+
+        Path() = default;
+        Path(const Path &) = default;
+        Path(Path &&) = default;
+
+        explicit Path(const allocator_type &alloc) : entries(alloc) { }
+        Path(const Path &other, const allocator_type &alloc) : entries(other.entries, alloc) { }
+        Path(Path &&other, const allocator_type &alloc) : entries(std::move(other.entries), alloc) { }
+
+        Path &operator=(const Path &) = default;
+        Path &operator=(Path &&) = default;
         
         /// Entries in this path. Does not include the current element as it might not
-        /// be a node itself.
-        std::vector<Entry> entries;
+        /// be a node itself. Memory is obtained from the allocator given at construction,
+        /// global allocator is used by default.
+        std::pmr::vector<Entry> entries;
     };
     
     /// Context stores parsing context: location and path data. Not all types require
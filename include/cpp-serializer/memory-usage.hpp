@@ -0,0 +1,168 @@
+#pragma once
+
+#include "config.hpp"
+
+#include "cpp-serializer/tmp.hpp"
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /**
+     * @brief Memory used by data, locations or containers in bytes.
+     * Only separately allocated memory is counted, size of the object itself is not included
+     * as it is a part of its owner. Memory of node based containers such as std::map is
+     * estimated.
+     */
+    struct MemoryUsage {
+        /// Memory of the stored values, such as string buffers
+        size_t Payload = 0;
+
+        /// Storage of sequences, maps and key location tables, including keys
+        size_t Containers = 0;
+
+        /// Memory of locations except skip lists, such as resource names
+        size_t Locations = 0;
+
+        /// Storage of skip lists including the resource names of their entries
+        size_t SkipLists = 0;
+
+        size_t Total() const {
+            return Payload + Containers + Locations + SkipLists;
+        }
+
+        MemoryUsage &operator+=(const MemoryUsage &other) {
+            Payload    += other.Payload;
+            Containers += other.Containers;
+            Locations  += other.Locations;
+            SkipLists  += other.SkipLists;
+
+            return *this;
+        }
+
+        friend MemoryUsage operator+(MemoryUsage left, const MemoryUsage &right) {
+            return left += right;
+        }
+
+        bool operator==(const MemoryUsage &) const = default;
+    };
+
+    /// Statistics collected by a transport while parsing.
+    struct ParseStatistics {
+        /// Number of completed parse calls
+        size_t Parses = 0;
+
+        /// Largest memory held by the scratch buffers after a parse, in bytes
+        size_t PeakScratchSize = 0;
+
+        /// Total number of skip list entries created
+        size_t SkipListEntries = 0;
+    };
+
+    /**
+     * @brief Collects parse statistics from transports.
+     * Transports record to a collector only if one is given to them, thus parsing does not
+     * pay for statistics unless they are requested. Counters are atomic, a collector can
+     * be shared by multiple transports and threads, such as the workers of ParseBatch.
+     */
+    class ParseStatisticsCollector {
+    public:
+        /// Records a completed parse.
+        void Record(size_t scratchsize, size_t skiplistentries) {
+            parses.fetch_add(1, std::memory_order_relaxed);
+            entries.fetch_add(skiplistentries, std::memory_order_relaxed);
+
+            auto peak = peakscratch.load(std::memory_order_relaxed);
+            while(peak < scratchsize && !peakscratch.compare_exchange_weak(peak, scratchsize, std::memory_order_relaxed)) { }
+        }
+
+        ParseStatistics Get() const {
+            return {
+                parses.load(std::memory_order_relaxed),
+                peakscratch.load(std::memory_order_relaxed),
+                entries.load(std::memory_order_relaxed)
+            };
+        }
+
+        void Reset() {
+            parses.store(0, std::memory_order_relaxed);
+            peakscratch.store(0, std::memory_order_relaxed);
+            entries.store(0, std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<size_t> parses{0};
+        std::atomic<size_t> peakscratch{0};
+        std::atomic<size_t> entries{0};
+    };
+
+    namespace internal {
+        /// Checks if the given pointer refers to the inside of the object, such as small
+        /// buffers of strings.
+        template<class T_>
+        bool IsStoredInside(const T_ &object, const void *ptr) {
+            auto begin = reinterpret_cast<const std::byte *>(std::addressof(object));
+            auto p     = static_cast<const std::byte *>(ptr);
+
+            return std::greater_equal<>{}(p, begin) && std::less<>{}(p, begin + sizeof(T_));
+        }
+
+        /**
+         * @brief Adds the memory owned by the given value to the usage.
+         * Values that report their usage through GetMemoryUsage are added by category, other
+         * memory is added to the given category. Contiguous containers report their capacity,
+         * node based containers are estimated using three pointers per node. Views are not
+         * counted.
+         */
+        template<class T_>
+        void AddMemoryUsage(MemoryUsage &usage, const T_ &value, size_t MemoryUsage::*category = &MemoryUsage::Payload) {
+            if constexpr(requires { {value.GetMemoryUsage()} -> std::same_as<MemoryUsage>; }) {
+                usage += value.GetMemoryUsage();
+            }
+            else if constexpr(IsInstantiationV<T_, std::optional>) {
+                if(value)
+                    AddMemoryUsage(usage, *value, category);
+            }
+            else if constexpr(IsInstantiationV<T_, std::variant>) {
+                std::visit([&](const auto &alternative) { AddMemoryUsage(usage, alternative, category); }, value);
+            }
+            else if constexpr(IsInstantiationV<T_, std::pair>) {
+                AddMemoryUsage(usage, value.first, category);
+                AddMemoryUsage(usage, value.second, category);
+            }
+            else if constexpr(std::ranges::range<const T_> && !std::ranges::view<T_>) {
+                using ValueType = std::ranges::range_value_t<const T_>;
+
+                if constexpr(requires { {value.GetMemoryUsage()} -> std::convertible_to<size_t>; }) {
+                    usage.*category += value.GetMemoryUsage();
+                }
+                else if constexpr(requires { value.data(); value.capacity(); }) {
+                    //strings store a null terminator
+                    constexpr auto extra = requires { value.c_str(); } ? 1 : 0;
+
+                    if(!IsStoredInside(value, value.data()))
+                        usage.*category += (value.capacity() + extra) * sizeof(ValueType);
+                }
+                else {
+                    auto count = static_cast<size_t>(std::ranges::distance(value));
+                    usage.*category += count * (sizeof(ValueType) + 3 * sizeof(void *));
+                }
+
+                if constexpr(!std::is_trivially_copyable_v<ValueType>) {
+                    for(const auto &element : value)
+                        AddMemoryUsage(usage, element, category);
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,461 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    namespace internal {
+        /// Metadata of OrderedHashMap entries when no metadata is stored.
+        struct nometadata {
+            bool operator==(const nometadata &) const = default;
+        };
+    }
+
+    /**
+     * @brief Insertion ordered hash map using open addressing.
+     * Key and value pairs are stored contiguously in insertion order, thus iteration follows
+     * the order of the document and each key is stored next to its value. A separate table
+     * of slots maps hashes to entries using linear probing, each slot stores the entry index
+     * along with a part of the hash so that most probes do not touch the entries. Lookup,
+     * insertion and erase are constant time on average. Erased entries are left in place
+     * and skipped by iteration until they make up half of the entries, then the entries are
+     * compacted and the slots rebuilt. Keys should not be modified through iterators.
+     * Iterators and references are invalidated by insertion and erase.
+     *
+     * If Metadata_ is not void, each entry stores a value of this type next to its key,
+     * see GetMetadata. Data uses this to keep key locations without a separate map.
+     */
+    template<
+        class Key_, class T_,
+        class Hash_ = std::hash<Key_>, class KeyEqual_ = std::equal_to<Key_>,
+        class Allocator_ = std::allocator<std::pair<Key_, T_>>,
+        class Metadata_ = void
+    >
+    class OrderedHashMap {
+    public:
+        using key_type       = Key_;
+        using mapped_type    = T_;
+        using value_type     = std::pair<Key_, T_>;
+        using size_type      = size_t;
+        using hasher         = Hash_;
+        using key_equal      = KeyEqual_;
+        using metadata_type  = std::conditional_t<std::is_void_v<Metadata_>, internal::nometadata, Metadata_>;
+
+    private:
+        /// Erased entries have no value.
+        struct Entry {
+            template<class ...Args_>
+            explicit Entry(std::in_place_t, Args_ &&...args) : value(std::in_place, std::forward<Args_>(args)...) { }
+
+            std::optional<value_type> value;
+
+            [[no_unique_address]]
+            metadata_type metadata{};
+        };
+
+        using EntryAllocator = typename std::allocator_traits<Allocator_>::template rebind_alloc<Entry>;
+        using EntryList      = std::vector<Entry, EntryAllocator>;
+
+        /// Forward iterator over the entries that skips erased entries.
+        template<bool Const_>
+        class basic_iterator {
+            using EntryPointer = std::conditional_t<Const_, const Entry *, Entry *>;
+
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = OrderedHashMap::value_type;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = std::conditional_t<Const_, const value_type *, value_type *>;
+            using reference         = std::conditional_t<Const_, const value_type &, value_type &>;
+
+            basic_iterator() = default;
+
+            /// Iterators convert to const iterators.
+            template<bool OtherConst_> requires (Const_ && !OtherConst_)
+            basic_iterator(const basic_iterator<OtherConst_> &other) :
+                entry(other.entry), last(other.last)
+            { }
+
+            reference operator*() const { return *entry->value; }
+            pointer operator->() const { return &*entry->value; }
+
+            basic_iterator &operator++() {
+                entry++;
+                skip();
+
+                return *this;
+            }
+
+            basic_iterator operator++(int) {
+                auto copy = *this;
+                ++*this;
+
+                return copy;
+            }
+
+            bool operator==(const basic_iterator &other) const {
+                return entry == other.entry;
+            }
+
+        private:
+            friend class OrderedHashMap;
+            friend class basic_iterator<!Const_>;
+
+            basic_iterator(EntryPointer entry_, EntryPointer last_) : entry(entry_), last(last_) {
+                skip();
+            }
+
+            void skip() {
+                while(entry != last && !entry->value)
+                    entry++;
+            }
+
+            EntryPointer entry = nullptr;
+            EntryPointer last  = nullptr;
+        };
+
+    public:
+        using allocator_type = typename std::allocator_traits<Allocator_>::template rebind_alloc<value_type>;
+        using iterator       = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+
+        OrderedHashMap() = default;
+
+        explicit OrderedHashMap(const allocator_type &alloc) : entries(alloc), slots(alloc) { }
+
+        OrderedHashMap(const OrderedHashMap &) = default;
+
+        /// Moved from map is left empty.
+        OrderedHashMap(OrderedHashMap &&other) noexcept :
+            entries(std::move(other.entries)),
+            slots(std::move(other.slots)),
+            erased(std::exchange(other.erased, 0))
+        {
+            other.entries.clear();
+            other.slots.clear();
+        }
+
+        OrderedHashMap &operator=(const OrderedHashMap &) = default;
+
+        /// Moved from map is left empty.
+        OrderedHashMap &operator=(OrderedHashMap &&other) noexcept(
+            std::allocator_traits<EntryAllocator>::propagate_on_container_move_assignment::value ||
+            std::allocator_traits<EntryAllocator>::is_always_equal::value
+        ) {
+            if(this != &other) {
+                entries = std::move(other.entries);
+                slots   = std::move(other.slots);
+                erased  = std::exchange(other.erased, 0);
+
+                //vectors with allocators that differ move the elements one by one and keep
+                //the moved from elements
+                other.entries.clear();
+                other.slots.clear();
+            }
+
+            return *this;
+        }
+
+        OrderedHashMap(std::initializer_list<value_type> init) {
+            reserve(init.size());
+
+            for(auto &value : init)
+                insert(value);
+        }
+
+        iterator begin() { return makeiterator(0); }
+        iterator end() { return makeiterator(entries.size()); }
+        const_iterator begin() const { return makeiterator(0); }
+        const_iterator end() const { return makeiterator(entries.size()); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+
+        size_t size() const { return entries.size() - erased; }
+        bool empty() const { return size() == 0; }
+
+        allocator_type get_allocator() const { return entries.get_allocator(); }
+
+        /// Returns the number of bytes allocated for entries and slots. Memory owned by keys
+        /// and values is not included.
+        size_t GetMemoryUsage() const {
+            return entries.capacity() * sizeof(Entry) + slots.capacity() * sizeof(Slot);
+        }
+
+        /// Returns the metadata stored next to the entry at the given position.
+        metadata_type &GetMetadata(const_iterator pos) requires (!std::is_void_v<Metadata_>) {
+            return entries[indexof(pos)].metadata;
+        }
+
+        const metadata_type &GetMetadata(const_iterator pos) const requires (!std::is_void_v<Metadata_>) {
+            return pos.entry->metadata;
+        }
+
+        /// Removes all entries, memory is kept.
+        void clear() {
+            entries.clear();
+            erased = 0;
+            std::fill(slots.begin(), slots.end(), Slot{});
+        }
+
+        /// Prepares the map to hold the given number of entries without rehashing.
+        void reserve(size_t count) {
+            if(count > capacityfor(slots.size()))
+                rehash(count);
+
+            entries.reserve(erased + count);
+        }
+
+        iterator find(const Key_ &key) {
+            if(slots.empty())
+                return end();
+
+            auto slot = lookup(key, hasher{}(key));
+
+            return slots[slot].IsEmpty() ? end() : makeiterator(slots[slot].index);
+        }
+
+        const_iterator find(const Key_ &key) const {
+            if(slots.empty())
+                return end();
+
+            auto slot = lookup(key, hasher{}(key));
+
+            return slots[slot].IsEmpty() ? end() : makeiterator(slots[slot].index);
+        }
+
+        bool contains(const Key_ &key) const { return find(key) != end(); }
+        size_t count(const Key_ &key) const { return contains(key); }
+
+        T_ &at(const Key_ &key) {
+            auto it = find(key);
+            if(it == end())
+                throw std::out_of_range("Key not found in map");
+
+            return it->second;
+        }
+
+        const T_ &at(const Key_ &key) const {
+            auto it = find(key);
+            if(it == end())
+                throw std::out_of_range("Key not found in map");
+
+            return it->second;
+        }
+
+        T_ &operator[](const Key_ &key) {
+            return try_emplace(key).first->second;
+        }
+
+        T_ &operator[](Key_ &&key) {
+            return try_emplace(std::move(key)).first->second;
+        }
+
+        /// Inserts the given entry if its key does not exist. Existing entry is not modified.
+        std::pair<iterator, bool> insert(const value_type &value) {
+            return try_emplace(value.first, value.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type &&value) {
+            return try_emplace(std::move(value.first), std::move(value.second));
+        }
+
+        template<class ...Args_>
+        std::pair<iterator, bool> emplace(const Key_ &key, Args_ &&...args) {
+            return try_emplace(key, std::forward<Args_>(args)...);
+        }
+
+        /// Inserts a value constructed from the given arguments if the key does not exist.
+        template<class K_, class ...Args_>
+        std::pair<iterator, bool> try_emplace(K_ &&key, Args_ &&...args) {
+            if(capacityfor(slots.size()) <= entries.size())
+                rehash(size() + 1);
+
+            auto hash = hasher{}(key);
+            auto slot = lookup(key, hash);
+
+            if(!slots[slot].IsEmpty())
+                return {makeiterator(slots[slot].index), false};
+
+            assert(entries.size() < Slot::Empty);
+
+            auto index = entries.size();
+            entries.emplace_back(
+                std::in_place, std::piecewise_construct,
+                std::forward_as_tuple(std::forward<K_>(key)),
+                std::forward_as_tuple(std::forward<Args_>(args)...)
+            );
+            slots[slot] = {static_cast<std::uint32_t>(index), Slot::Fingerprint(hash)};
+
+            return {makeiterator(index), true};
+        }
+
+        /// Removes the entry with the given key, order of the remaining entries is kept.
+        size_t erase(const Key_ &key) {
+            if(slots.empty())
+                return 0;
+
+            auto slot = lookup(key, hasher{}(key));
+            if(slots[slot].IsEmpty())
+                return 0;
+
+            eraseslot(slot, 0);
+
+            return 1;
+        }
+
+        iterator erase(const_iterator pos) {
+            auto slot = lookup(pos->first, hasher{}(pos->first));
+
+            return makeiterator(eraseslot(slot, indexof(pos) + 1));
+        }
+
+        bool operator==(const OrderedHashMap &other) const {
+            return std::equal(begin(), end(), other.begin(), other.end());
+        }
+
+    private:
+        /// Entry of the hash table, empty slots have index set to Empty.
+        struct Slot {
+            static constexpr std::uint32_t Empty = std::numeric_limits<std::uint32_t>::max();
+
+            static std::uint32_t Fingerprint(size_t hash) {
+                return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+            }
+
+            bool IsEmpty() const { return index == Empty; }
+
+            std::uint32_t index       = Empty;
+            std::uint32_t fingerprint = 0;
+        };
+
+        using SlotAllocator = typename std::allocator_traits<Allocator_>::template rebind_alloc<Slot>;
+
+        /// Maximum number of entries for the given slot count, load factor is kept under 3/4.
+        static size_t capacityfor(size_t slotcount) {
+            return slotcount - slotcount / 4;
+        }
+
+        iterator makeiterator(size_t index) {
+            return {entries.data() + index, entries.data() + entries.size()};
+        }
+
+        const_iterator makeiterator(size_t index) const {
+            return {entries.data() + index, entries.data() + entries.size()};
+        }
+
+        size_t indexof(const_iterator pos) const {
+            return static_cast<size_t>(pos.entry - entries.data());
+        }
+
+        /// Erases the entry of the given slot, returns the index that the entry at next has
+        /// afterwards.
+        size_t eraseslot(size_t slot, size_t next) {
+            auto index = slots[slot].index;
+
+            removeslot(slot);
+            entries[index].value.reset();
+            erased++;
+
+            //compaction moves every entry, doing it once half of the entries are erased
+            //keeps erase constant time on average
+            if(erased > entries.size() / 2) {
+                next -= static_cast<size_t>(std::count_if(
+                    entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(next),
+                    [](const Entry &entry) { return !entry.value; }
+                ));
+                rehash(size());
+            }
+
+            return next;
+        }
+
+        /// Returns the slot containing the key, or the empty slot where it should be placed.
+        template<class K_>
+        size_t lookup(const K_ &key, size_t hash) const {
+            assert(!slots.empty());
+
+            auto mask        = slots.size() - 1;
+            auto fingerprint = Slot::Fingerprint(hash);
+
+            for(auto i = hash & mask; ; i = (i + 1) & mask) {
+                auto &slot = slots[i];
+
+                if(slot.IsEmpty() || (slot.fingerprint == fingerprint && key_equal{}(entries[slot.index].value->first, key)))
+                    return i;
+            }
+        }
+
+        /// Empties the given slot, following entries of the probe chain are shifted back.
+        void removeslot(size_t slot) {
+            auto mask = slots.size() - 1;
+            auto hole = slot;
+
+            for(auto i = (slot + 1) & mask; !slots[i].IsEmpty(); i = (i + 1) & mask) {
+                auto ideal = hasher{}(entries[slots[i].index].value->first) & mask;
+
+                //entry can be moved into the hole if its ideal slot is not between the hole
+                //and its current slot
+                if(((i - ideal) & mask) >= ((i - hole) & mask)) {
+                    slots[hole] = slots[i];
+                    hole = i;
+                }
+            }
+
+            slots[hole] = Slot{};
+        }
+
+        /// Removes erased entries and rebuilds the slots for the given number of entries.
+        void rehash(size_t count) {
+            if(erased) {
+                std::erase_if(entries, [](const Entry &entry) { return !entry.value; });
+                erased = 0;
+            }
+
+            auto slotcount = size_t{8};
+            while(capacityfor(slotcount) < count)
+                slotcount *= 2;
+
+            slots.assign(slotcount, Slot{});
+
+            auto mask = slotcount - 1;
+            for(std::uint32_t index = 0; index < entries.size(); index++) {
+                auto hash = hasher{}(entries[index].value->first);
+                auto i    = hash & mask;
+
+                while(!slots[i].IsEmpty())
+                    i = (i + 1) & mask;
+
+                slots[i] = {index, Slot::Fingerprint(hash)};
+            }
+        }
+
+        EntryList entries;
+        std::vector<Slot, SlotAllocator> slots;
+
+        /// Number of erased entries that are not yet removed from the entry list
+        size_t erased = 0;
+    };
+
+    /// OrderedHashMap that stores the location of each key next to its entry, see
+    /// Data::GetKeyLocation.
+    template<class Key_, class T_, class Location_>
+    using LocatedHashMap = OrderedHashMap<
+        Key_, T_, std::hash<Key_>, std::equal_to<Key_>, std::allocator<std::pair<Key_, T_>>, Location_
+    >;
+
+}
@@ -0,0 +1,419 @@
+#pragma once
+
+#include "config.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    namespace internal {
+        /// Inline capacity that holds up to 8 elements in at most 512 bytes. Elements larger
+        /// than 512 bytes still have a single inline element.
+        template<class T_>
+        inline constexpr size_t DefaultInlineCapacity = std::clamp<size_t>(512 / sizeof(T_), 1, 8);
+
+        /// Inline storage of SmallVector, empty when there is no inline capacity so that
+        /// the element type is not required to be complete.
+        template<class T_, size_t Capacity_>
+        struct smallvectorstorage {
+            T_ *get() { return reinterpret_cast<T_*>(bytes); }
+            const T_ *get() const { return reinterpret_cast<const T_*>(bytes); }
+
+            alignas(T_) std::byte bytes[sizeof(T_) * Capacity_];
+        };
+
+        template<class T_>
+        struct smallvectorstorage<T_, 0> {
+            T_ *get() { return nullptr; }
+            const T_ *get() const { return nullptr; }
+        };
+    }
+
+    /**
+     * @brief Vector that stores a small number of elements without allocating.
+     * Up to InlineCapacity_ elements are stored inside the object itself, larger sizes move
+     * the elements to memory obtained from the allocator. Elements are contiguous, thus
+     * iterators are pointers. Most sequences in documents are short, with this type they
+     * do not require an additional allocation. Default inline capacity is tuned for data
+     * storage elements such as strings or variants, holding up to 8 elements while keeping
+     * inline storage under 512 bytes. Moving a vector with inline elements moves the
+     * elements one by one.
+     *
+     * Element type should be complete unless InlineCapacity_ is 0. Without inline capacity
+     * the elements are always allocated, which allows SmallVector to be the sequence type of
+     * Data: Data stores its sequence by value and cannot contain copies of itself.
+     */
+    template<
+        class T_, size_t InlineCapacity_ = internal::DefaultInlineCapacity<T_>,
+        class Allocator_ = std::allocator<T_>
+    >
+    class SmallVector {
+        using AllocTraits = std::allocator_traits<Allocator_>;
+
+        //without inline capacity elements are never moved, the element type is not checked
+        //as it might still be incomplete
+        using NothrowElementMove = std::disjunction<
+            std::bool_constant<InlineCapacity_ == 0>, std::is_nothrow_move_constructible<T_>
+        >;
+
+    public:
+        using value_type             = T_;
+        using size_type              = size_t;
+        using difference_type        = std::ptrdiff_t;
+        using reference              = T_ &;
+        using const_reference        = const T_ &;
+        using pointer                = T_ *;
+        using const_pointer          = const T_ *;
+        using iterator               = T_ *;
+        using const_iterator         = const T_ *;
+        using reverse_iterator       = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using allocator_type         = Allocator_;
+
+        static constexpr size_t InlineCapacity = InlineCapacity_;
+
+        SmallVector() = default;
+
+        explicit SmallVector(const Allocator_ &alloc) : allocator(alloc) { }
+
+        //constructors that copy delegate to the allocator constructor, thus the destructor
+        //releases the memory and the elements if a copy throws
+
+        explicit SmallVector(size_t size_, const T_ &value = T_{}, const Allocator_ &alloc = {}) : SmallVector(alloc) {
+            assign(size_, value);
+        }
+
+        SmallVector(std::initializer_list<T_> init, const Allocator_ &alloc = {}) : SmallVector(alloc) {
+            reserve(init.size());
+            for(auto &value : init)
+                push_back(value);
+        }
+
+        SmallVector(const SmallVector &other) :
+            SmallVector(AllocTraits::select_on_container_copy_construction(other.allocator))
+        {
+            reserve(other.count);
+            for(auto &value : other)
+                push_back(value);
+        }
+
+        SmallVector(SmallVector &&other) noexcept(NothrowElementMove::value) :
+            allocator(std::move(other.allocator))
+        {
+            take(other);
+        }
+
+        /// Elements that are copied before a copy throws remain in the vector.
+        SmallVector &operator=(const SmallVector &other) {
+            if(this != &other) {
+                clear();
+
+                if constexpr(AllocTraits::propagate_on_container_copy_assignment::value) {
+                    if(allocator != other.allocator)
+                        release();
+
+                    allocator = other.allocator;
+                }
+
+                reserve(other.count);
+                for(auto &value : other)
+                    push_back(value);
+            }
+
+            return *this;
+        }
+
+        /// Elements are moved one by one if the allocators differ and the allocator does
+        /// not propagate, which may allocate.
+        SmallVector &operator=(SmallVector &&other) noexcept(
+            NothrowElementMove::value && (
+                AllocTraits::propagate_on_container_move_assignment::value ||
+                AllocTraits::is_always_equal::value
+            )
+        ) {
+            if(this != &other) {
+                clear();
+
+                //allocated memory can only be taken if it can be released by this allocator
+                if(
+                    AllocTraits::propagate_on_container_move_assignment::value ||
+                    other.isinline() || allocator == other.allocator
+                ) {
+                    release();
+
+                    if constexpr(AllocTraits::propagate_on_container_move_assignment::value)
+                        allocator = std::move(other.allocator);
+
+                    take(other);
+                }
+                else {
+                    reserve(other.count);
+                    std::uninitialized_move(other.begin(), other.end(), begin());
+                    count = other.count;
+                    other.clear();
+                }
+            }
+
+            return *this;
+        }
+
+        SmallVector &operator=(std::initializer_list<T_> init) {
+            clear();
+            reserve(init.size());
+            for(auto &value : init)
+                push_back(value);
+
+            return *this;
+        }
+
+        ~SmallVector() {
+            clear();
+            release();
+        }
+
+        iterator begin() { return elements; }
+        iterator end() { return elements + count; }
+        const_iterator begin() const { return elements; }
+        const_iterator end() const { return elements + count; }
+        const_iterator cbegin() const { return elements; }
+        const_iterator cend() const { return elements + count; }
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        T_ *data() { return elements; }
+        const T_ *data() const { return elements; }
+
+        size_t size() const { return count; }
+        size_t capacity() const { return cap; }
+        bool empty() const { return count == 0; }
+
+        allocator_type get_allocator() const { return allocator; }
+
+        T_ &operator[](size_t index) { assert(index < count); return elements[index]; }
+        const T_ &operator[](size_t index) const { assert(index < count); return elements[index]; }
+
+        T_ &at(size_t index) {
+            if(index >= count)
+                throw std::out_of_range("Index out of range");
+
+            return elements[index];
+        }
+
+        const T_ &at(size_t index) const {
+            if(index >= count)
+                throw std::out_of_range("Index out of range");
+
+            return elements[index];
+        }
+
+        T_ &front() { assert(count); return elements[0]; }
+        const T_ &front() const { assert(count); return elements[0]; }
+        T_ &back() { assert(count); return elements[count - 1]; }
+        const T_ &back() const { assert(count); return elements[count - 1]; }
+
+        /// Ensures that the given number of elements can be stored without reallocation.
+        void reserve(size_t size) {
+            if(size > cap)
+                reallocate(size);
+        }
+
+        /// Moves the elements back inside the object if they fit.
+        void shrink_to_fit() {
+            if(!isinline() && count <= InlineCapacity_)
+                reallocate(InlineCapacity_);
+        }
+
+        void clear() {
+            std::destroy(begin(), end());
+            count = 0;
+        }
+
+        void assign(size_t size, const T_ &value) {
+            //an element of this vector is copied before the elements are destroyed
+            auto ptr = std::addressof(value);
+            if(std::less_equal<const T_*>{}(begin(), ptr) && std::less<const T_*>{}(ptr, end())) {
+                T_ copy(value);
+                assign(size, copy);
+
+                return;
+            }
+
+            clear();
+            reserve(size);
+            std::uninitialized_fill_n(elements, size, value);
+            count = size;
+        }
+
+        template<class ...Args_>
+        T_ &emplace_back(Args_ &&...args) {
+            if(count == cap) {
+                //arguments might refer to an element, construct before reallocation
+                T_ value(std::forward<Args_>(args)...);
+                reallocate(grow(count + 1));
+
+                std::construct_at(elements + count, std::move(value));
+                return elements[count++];
+            }
+
+            //size is increased after construction, a throwing constructor adds nothing
+            std::construct_at(elements + count, std::forward<Args_>(args)...);
+            return elements[count++];
+        }
+
+        void push_back(const T_ &value) { emplace_back(value); }
+        void push_back(T_ &&value) { emplace_back(std::move(value)); }
+
+        void pop_back() {
+            assert(count);
+            std::destroy_at(elements + --count);
+        }
+
+        /// Constructs an element before the given position.
+        template<class ...Args_>
+        iterator emplace(const_iterator pos, Args_ &&...args) {
+            auto index = static_cast<size_t>(pos - begin());
+            assert(index <= count);
+
+            if(index == count) {
+                emplace_back(std::forward<Args_>(args)...);
+                return begin() + index;
+            }
+
+            T_ value(std::forward<Args_>(args)...);
+
+            if(count == cap)
+                reallocate(grow(count + 1));
+
+            std::construct_at(elements + count, std::move(elements[count - 1]));
+            std::move_backward(elements + index, elements + count - 1, elements + count);
+            count++;
+
+            elements[index] = std::move(value);
+
+            return begin() + index;
+        }
+
+        iterator insert(const_iterator pos, const T_ &value) { return emplace(pos, value); }
+        iterator insert(const_iterator pos, T_ &&value) { return emplace(pos, std::move(value)); }
+
+        iterator erase(const_iterator pos) {
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last) {
+            auto from = begin() + (first - begin());
+            auto to   = begin() + (last - begin());
+
+            if(from != to) {
+                auto newend = std::move(to, end(), from);
+                std::destroy(newend, end());
+                count -= static_cast<size_t>(to - from);
+            }
+
+            return from;
+        }
+
+        void resize(size_t size) {
+            if(size < count) {
+                std::destroy(begin() + size, end());
+            }
+            else {
+                reserve(size);
+                std::uninitialized_value_construct(end(), begin() + size);
+            }
+
+            count = size;
+        }
+
+        bool operator==(const SmallVector &other) const {
+            return std::equal(begin(), end(), other.begin(), other.end());
+        }
+
+    private:
+        bool isinline() const {
+            return elements == storage.get();
+        }
+
+        size_t grow(size_t required) const {
+            return std::max(cap * 2, required);
+        }
+
+        /// Moves the elements to a storage with the given capacity.
+        void reallocate(size_t newcap) {
+            assert(newcap >= count);
+
+            auto target = newcap <= InlineCapacity_ ? inlinestorage() : AllocTraits::allocate(allocator, newcap);
+
+            if(target != elements) {
+                try {
+                    std::uninitialized_move(begin(), end(), target);
+                }
+                catch(...) {
+                    if(target != inlinestorage())
+                        AllocTraits::deallocate(allocator, target, newcap);
+
+                    throw;
+                }
+
+                std::destroy(begin(), end());
+                release();
+            }
+
+            elements = target;
+            cap      = std::max(newcap, InlineCapacity_);
+        }
+
+        /// Releases allocated memory, elements should already be destroyed.
+        void release() {
+            if(!isinline())
+                AllocTraits::deallocate(allocator, elements, cap);
+
+            elements = inlinestorage();
+            cap      = InlineCapacity_;
+        }
+
+        /// Takes the elements of the other vector, which is left empty.
+        void take(SmallVector &other) {
+            if(other.isinline()) {
+                std::uninitialized_move(other.begin(), other.end(), begin());
+                count = other.count;
+                other.clear();
+            }
+            else {
+                elements = other.elements;
+                count    = other.count;
+                cap      = other.cap;
+
+                other.elements = other.inlinestorage();
+                other.count    = 0;
+                other.cap      = InlineCapacity_;
+            }
+        }
+
+        T_ *inlinestorage() {
+            return storage.get();
+        }
+
+        [[no_unique_address]]
+        Allocator_ allocator;
+
+        T_    *elements = inlinestorage();
+        size_t count    = 0;
+        size_t cap      = InlineCapacity_;
+
+        [[no_unique_address]]
+        internal::smallvectorstorage<T_, InlineCapacity_> storage;
+    };
+
+}
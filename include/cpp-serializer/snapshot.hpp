@@ -0,0 +1,354 @@
+#pragma once
+
+#include "config.hpp"
+
+#include "cpp-serializer/concepts.hpp"
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /**
+     * @brief Creates an immutable snapshot of the given data.
+     * Lazy nodes are parsed before the snapshot is returned, thus the snapshot can be read
+     * by multiple threads at the same time.
+     */
+    template<class DataType_> requires DataConcept<std::remove_cvref_t<DataType_>>
+    std::shared_ptr<const std::remove_cvref_t<DataType_>> MakeSnapshot(DataType_ &&data) {
+        auto snapshot = std::make_shared<const std::remove_cvref_t<DataType_>>(std::forward<DataType_>(data));
+        snapshot->Materialize();
+
+        return snapshot;
+    }
+
+    /**
+     * @brief Publishes immutable snapshots to concurrent readers.
+     * Readers obtain the current snapshot without waiting for writers and a snapshot stays
+     * alive as long as a reader holds it, even if a newer one is published. Writers replace
+     * the snapshot atomically, thus a reader sees either the old or the new version as a
+     * whole. Published objects should not be modified.
+     */
+    template<class T_>
+    class SharedSnapshot {
+    public:
+        using Pointer = std::shared_ptr<const T_>;
+
+        SharedSnapshot() = default;
+
+        explicit SharedSnapshot(Pointer initial) : current(std::move(initial)) { }
+
+        SharedSnapshot(const SharedSnapshot &) = delete;
+        SharedSnapshot &operator=(const SharedSnapshot &) = delete;
+
+        /// Returns the current snapshot, null if nothing is published yet.
+        Pointer Load() const {
+            return current.load(std::memory_order_acquire);
+        }
+
+        /// Publishes the given snapshot and returns the previous one.
+        Pointer Publish(Pointer next) {
+            return current.exchange(std::move(next), std::memory_order_acq_rel);
+        }
+
+        /**
+         * @brief Builds a new snapshot from the current one and publishes it.
+         * If another writer publishes in between, func is called again with the newer
+         * snapshot, thus concurrent updates are not lost.
+         * @param func Called with the current snapshot, should return the next snapshot
+         *        either as a Pointer or as a T_.
+         * @return The published snapshot
+         */
+        template<class F_>
+        Pointer Update(F_ &&func) {
+            auto prev = Load();
+
+            while(true) {
+                auto next = makepointer(func(prev));
+
+                if(current.compare_exchange_weak(prev, next, std::memory_order_acq_rel, std::memory_order_acquire))
+                    return next;
+            }
+        }
+
+    private:
+        static Pointer makepointer(Pointer value) {
+            return value;
+        }
+
+        template<class V_> requires (!std::is_convertible_v<V_, Pointer>)
+        static Pointer makepointer(V_ &&value) {
+            return std::make_shared<const T_>(std::forward<V_>(value));
+        }
+
+        std::atomic<Pointer> current;
+    };
+
+    /**
+     * @brief Persistent map from keys to immutable data snapshots.
+     * Maps are never modified, Set and Erase return a new map that shares all unchanged
+     * parts with the original. Entries are stored in a hash trie with 32 children per
+     * node, thus an update copies only the nodes on the path to the key. Setting a key to
+     * data that is equal to its current data returns the same map, thus reloading a
+     * document that changed a few keys keeps the rest of the old version shared. Combined
+     * with SharedSnapshot, readers can use a version while a newer one is built and
+     * published. Maps are cheap to copy.
+     */
+    template<
+        class Key_, DataConcept DataType_,
+        class Hash_ = std::hash<Key_>, class KeyEqual_ = std::equal_to<Key_>
+    >
+    class SnapshotMap {
+    public:
+        using KeyType      = Key_;
+        using DataType     = DataType_;
+        using DataPointer  = std::shared_ptr<const DataType_>;
+
+        SnapshotMap() = default;
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+
+        /// Returns the data of the given key, null if the key does not exist.
+        DataPointer Find(const Key_ &key) const {
+            auto hash = Hash_{}(key);
+            auto node = root.get();
+
+            for(unsigned shift = 0; node; shift += Bits) {
+                if(shift >= HashBits) {
+                    for(auto &entry : node->collisions) {
+                        if(KeyEqual_{}(entry.key, key))
+                            return entry.data;
+                    }
+
+                    return nullptr;
+                }
+
+                auto bit = bitfor(hash, shift);
+                if(!(node->bitmap & bit))
+                    return nullptr;
+
+                auto &slot = node->slots[position(node->bitmap, bit)];
+
+                if(auto entry = std::get_if<Entry>(&slot))
+                    return entry->hash == hash && KeyEqual_{}(entry->key, key) ? entry->data : nullptr;
+
+                node = std::get<NodePointer>(slot).get();
+            }
+
+            return nullptr;
+        }
+
+        bool KeyExists(const Key_ &key) const {
+            return Find(key) != nullptr;
+        }
+
+        /// Returns a map where the given key refers to the given snapshot.
+        SnapshotMap Set(const Key_ &key, DataPointer data) const {
+            auto result = *this;
+            auto added  = false;
+
+            result.root = insert(root.get(), Hash_{}(key), 0, key, std::move(data), added);
+            if(added)
+                result.count++;
+
+            return result;
+        }
+
+        /// Returns a map where the given key holds the given data. If the key already holds
+        /// equal data, this map is returned as is.
+        SnapshotMap Set(const Key_ &key, DataType_ data) const {
+            if constexpr(std::equality_comparable<DataType_>) {
+                if(auto existing = Find(key); existing && *existing == data)
+                    return *this;
+            }
+
+            return Set(key, MakeSnapshot(std::move(data)));
+        }
+
+        /// Returns a map without the given key.
+        SnapshotMap Erase(const Key_ &key) const {
+            if(!KeyExists(key))
+                return *this;
+
+            auto result = *this;
+            result.root = erase(root.get(), Hash_{}(key), 0, key);
+            result.count--;
+
+            return result;
+        }
+
+        /**
+         * @brief Returns a map that contains exactly the given entries.
+         * Keys that hold equal data in this map keep their snapshot, thus only changed keys
+         * are copied. Keys that are not in the entries are erased.
+         * @param entries Range of key and data pairs, data is moved if the range is an rvalue.
+         */
+        template<class Range_>
+        SnapshotMap Reload(Range_ &&entries) const {
+            auto result = *this;
+            auto keys   = std::unordered_set<Key_, Hash_, KeyEqual_>{};
+
+            for(auto &entry : entries) {
+                if constexpr(std::is_rvalue_reference_v<Range_ &&>)
+                    result = result.Set(entry.first, std::move(entry.second));
+                else
+                    result = result.Set(entry.first, DataType_(entry.second));
+
+                keys.insert(entry.first);
+            }
+
+            ForEach([&](const Key_ &key, const DataType_ &) {
+                if(!keys.contains(key))
+                    result = result.Erase(key);
+            });
+
+            return result;
+        }
+
+        /// Calls func(key, data) for every entry, order is unspecified.
+        template<class F_>
+        void ForEach(F_ &&func) const {
+            if(root)
+                visit(*root, func);
+        }
+
+    private:
+        static constexpr unsigned Bits     = 5;
+        static constexpr unsigned HashBits = sizeof(size_t) * 8;
+
+        struct Node;
+        using NodePointer = std::shared_ptr<const Node>;
+
+        struct Entry {
+            size_t hash;
+            Key_ key;
+            DataPointer data;
+        };
+
+        /// Each set bit of the bitmap has a slot that is either an entry or a child node.
+        /// Nodes below the last level store entries with equal hashes in collisions.
+        struct Node {
+            std::uint32_t bitmap = 0;
+            std::vector<std::variant<Entry, NodePointer>> slots;
+            std::vector<Entry> collisions;
+        };
+
+        static std::uint32_t bitfor(size_t hash, unsigned shift) {
+            return std::uint32_t{1} << ((hash >> shift) & 31);
+        }
+
+        static size_t position(std::uint32_t bitmap, std::uint32_t bit) {
+            return static_cast<size_t>(std::popcount(bitmap & (bit - 1)));
+        }
+
+        /// Returns a copy of the node with the given entry set, node can be null.
+        static NodePointer insert(const Node *node, size_t hash, unsigned shift, const Key_ &key, DataPointer data, bool &added) {
+            auto copy = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+
+            if(shift >= HashBits) {
+                for(auto &entry : copy->collisions) {
+                    if(KeyEqual_{}(entry.key, key)) {
+                        entry.data = std::move(data);
+                        return copy;
+                    }
+                }
+
+                copy->collisions.push_back({hash, key, std::move(data)});
+                added = true;
+
+                return copy;
+            }
+
+            auto bit = bitfor(hash, shift);
+            auto pos = position(copy->bitmap, bit);
+
+            if(!(copy->bitmap & bit)) {
+                copy->bitmap |= bit;
+                copy->slots.emplace(copy->slots.begin() + static_cast<std::ptrdiff_t>(pos), Entry{hash, key, std::move(data)});
+                added = true;
+
+                return copy;
+            }
+
+            auto &slot = copy->slots[pos];
+
+            if(auto entry = std::get_if<Entry>(&slot)) {
+                if(entry->hash == hash && KeyEqual_{}(entry->key, key)) {
+                    entry->data = std::move(data);
+                    return copy;
+                }
+
+                //both entries share this slot, move the existing one a level down
+                auto moved = false;
+                auto child = insert(nullptr, entry->hash, shift + Bits, entry->key, entry->data, moved);
+
+                slot = insert(child.get(), hash, shift + Bits, key, std::move(data), added);
+            }
+            else {
+                slot = insert(std::get<NodePointer>(slot).get(), hash, shift + Bits, key, std::move(data), added);
+            }
+
+            return copy;
+        }
+
+        /// Returns a copy of the node without the given key, null if the node becomes empty.
+        /// Key should exist.
+        static NodePointer erase(const Node *node, size_t hash, unsigned shift, const Key_ &key) {
+            auto copy = std::make_shared<Node>(*node);
+
+            if(shift >= HashBits) {
+                std::erase_if(copy->collisions, [&](const Entry &entry) { return KeyEqual_{}(entry.key, key); });
+
+                return copy->collisions.empty() ? nullptr : copy;
+            }
+
+            auto bit  = bitfor(hash, shift);
+            auto pos  = position(copy->bitmap, bit);
+            auto &slot = copy->slots[pos];
+
+            NodePointer child;
+            if(!std::holds_alternative<Entry>(slot))
+                child = erase(std::get<NodePointer>(slot).get(), hash, shift + Bits, key);
+
+            if(!child) {
+                copy->slots.erase(copy->slots.begin() + static_cast<std::ptrdiff_t>(pos));
+                copy->bitmap &= ~bit;
+            }
+            //a child with a single entry is replaced by the entry
+            else if(child->collisions.size() == 1)
+                slot = child->collisions.front();
+            else if(child->slots.size() == 1 && std::holds_alternative<Entry>(child->slots.front()))
+                slot = child->slots.front();
+            else
+                slot = std::move(child);
+
+            return copy->slots.empty() ? nullptr : copy;
+        }
+
+        template<class F_>
+        static void visit(const Node &node, F_ &func) {
+            for(auto &entry : node.collisions)
+                func(entry.key, *entry.data);
+
+            for(auto &slot : node.slots) {
+                if(auto entry = std::get_if<Entry>(&slot))
+                    func(entry->key, *entry->data);
+                else
+                    visit(*std::get<NodePointer>(slot), func);
+            }
+        }
+
+        NodePointer root;
+        size_t count = 0;
+    };
+
+}
@@ -154,8 +154,9 @@ namespace CPP_SERIALIZER_NAMESPACE {
     
         /// Returns a single character from this source, advances one step.
         char Get() {
-            char c;
-            assert(source.get(c));
+            char c = 0;
+            [[maybe_unused]] auto &ret = source.get(c);
+            assert(ret);
 
             return c;
         }
@@ -175,7 +176,7 @@ namespace CPP_SERIALIZER_NAMESPACE {
         /// Returns a single character from this source from a forward position. Does not
         /// perform bounds checking
         char PeekNext(size_t forward = 1) const {
-            assert(forward < static_cast<size_t>(std::numeric_limits<std::ios::pos_type>::max()));
+            assert(forward < static_cast<size_t>(std::numeric_limits<std::streamoff>::max()));
             
             source.seekg(static_cast<std::ios::pos_type>(forward), std::ios::cur);
 
@@ -191,7 +192,7 @@ namespace CPP_SERIALIZER_NAMESPACE {
         /// Tries to obtain a single character without advancing read pointer. If at the end 
         /// of the stream returns nullopt.
         std::optional<char> TryPeekNext(size_t forward = 1) const {
-            assert(forward < static_cast<size_t>(std::numeric_limits<std::ios::pos_type>::max()));
+            assert(forward < static_cast<size_t>(std::numeric_limits<std::streamoff>::max()));
             
             source.seekg(static_cast<std::ios::pos_type>(forward), std::ios::cur);
 
@@ -207,20 +208,15 @@ namespace CPP_SERIALIZER_NAMESPACE {
             return c;
         }
 
-        /// Reads a string data from the source upto the given size. 
+        /// Reads a string data from the source upto the given size. Stops early if the
+        /// end of the stream is reached. Does not query the size of the stream, thus can be
+        /// used with non-seekable streams.
         std::string Read(size_t size) {
-            if(size == 0) return "";
-
-            auto maxsize = *Size();
-            if(size > maxsize) size = maxsize;
-
             std::string str;
-            str.reserve(size);
 
             while(size) {
                 char buf[1024];
                 source.read(buf, std::min<size_t>(size, 1024));
-                if(source.bad() || source.fail()) return "";
                 
                 size_t obtained = static_cast<size_t>(source.gcount());
 
@@ -228,6 +224,8 @@ namespace CPP_SERIALIZER_NAMESPACE {
                 else size = 0;
 
                 str.append(buf, static_cast<size_t>(obtained));
+
+                if(source.bad() || source.fail()) break;
             }
 
             return str;
@@ -284,7 +282,7 @@ namespace CPP_SERIALIZER_NAMESPACE {
         /// Advances the read pointer forwards. If EOF is encountered, no error will be produced and
         /// the pointer is left at the EOF position.
         void Advance(size_t forward = 1) {
-            assert(forward < static_cast<size_t>(std::numeric_limits<std::ios::pos_type>::max()));
+            assert(forward < static_cast<size_t>(std::numeric_limits<std::streamoff>::max()));
             
             source.seekg(static_cast<std::ios::pos_type>(forward), std::ios::cur);
         }
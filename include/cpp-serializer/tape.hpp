@@ -0,0 +1,436 @@
+#pragma once
+
+#include "config.hpp"
+
+#include "cpp-serializer/concepts.hpp"
+#include "cpp-serializer/location.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /// Type of a node in a tape.
+    enum class TapeNodeType : std::uint8_t {
+        Null,
+        Value,
+        Sequence,
+        Map
+    };
+
+    namespace internal {
+        /**
+         * @brief A single node in a tape.
+         * Nodes are stored in document order, children of a container directly follow it.
+         * Strings are stored in the shared buffer of the tape.
+         */
+        struct TapeNode {
+            /// Index of the node after this node and its children
+            std::uint32_t next;
+
+            /// Key of the node if its parent is a map
+            std::uint32_t key;
+            std::uint32_t keysize;
+
+            /// Value of scalars, start of the key index for maps
+            std::uint32_t value;
+
+            /// Size of the value for scalars, number of children for containers
+            std::uint32_t size;
+
+            TapeNodeType type;
+        };
+    }
+
+    template<LocationConcept LocationType_>
+    class Tape;
+
+    /**
+     * @brief Lightweight handle to a node in a tape.
+     * Cursors are cheap to copy and provide read access similar to Data. A cursor is only
+     * valid as long as its tape is alive and is not modified.
+     */
+    template<LocationConcept LocationType_>
+    class TapeCursor {
+    public:
+        using LocationType = LocationType_;
+
+        /// Iterates over the children of a container.
+        class iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type        = TapeCursor;
+            using difference_type   = std::ptrdiff_t;
+            using pointer           = void;
+            using reference         = TapeCursor;
+
+            iterator() = default;
+
+            TapeCursor operator*() const { return {tape, index}; }
+
+            iterator &operator++() {
+                index = TapeCursor{tape, index}.node().next;
+                return *this;
+            }
+
+            iterator operator++(int) {
+                auto prev = *this;
+                ++*this;
+                return prev;
+            }
+
+            bool operator==(const iterator &other) const { return index == other.index; }
+
+        private:
+            friend class TapeCursor;
+
+            iterator(const Tape<LocationType> *tape_, std::uint32_t index_) : tape(tape_), index(index_) { }
+
+            const Tape<LocationType> *tape = nullptr;
+            std::uint32_t index = 0;
+        };
+
+        TapeCursor(const Tape<LocationType> *tape_, std::uint32_t index_) : tape(tape_), index(index_) { }
+
+        TapeNodeType GetType() const { return node().type; }
+
+        bool IsNull() const { return node().type == TapeNodeType::Null; }
+        bool IsValue() const { return node().type == TapeNodeType::Value; }
+        bool IsSequence() const { return node().type == TapeNodeType::Sequence; }
+        bool IsMap() const { return node().type == TapeNodeType::Map; }
+
+        /// Returns the value of a scalar node. View refers to the string buffer of the tape.
+        std::string_view GetData() const {
+            assert(IsValue());
+
+            return tape->view(node().value, node().size);
+        }
+
+        /// Returns the key of this node, empty if the parent is not a map.
+        std::string_view GetKey() const {
+            return tape->view(node().key, node().keysize);
+        }
+
+        LocationType GetLocation() const {
+            if constexpr(std::is_empty_v<LocationType>)
+                return LocationType{};
+            else
+                return tape->locations[index];
+        }
+
+        /// Obtains the location of the given offset within the value of this node.
+        auto GetLocation(size_t offset) const {
+            auto location = GetLocation();
+
+            return location.Obtain(offset, IsValue() ? GetData() : std::string_view{});
+        }
+
+        /// Number of children of a container, 0 for scalars.
+        size_t size() const {
+            return IsValue() ? 0 : node().size;
+        }
+
+        bool empty() const { return size() == 0; }
+
+        iterator begin() const {
+            return {tape, IsValue() || IsNull() ? node().next : index + 1};
+        }
+
+        iterator end() const {
+            return {tape, node().next};
+        }
+
+        /// Returns the child at the given index. Children are visited in order, skipping
+        /// their subtrees.
+        TapeCursor operator[](size_t child) const {
+            assert(child < size());
+
+            auto it = begin();
+            std::advance(it, static_cast<std::ptrdiff_t>(child));
+
+            return *it;
+        }
+
+        /// Finds the child with the given key in a map using binary search over the key
+        /// index of the map. If the key appears more than once, the last child is returned.
+        std::optional<TapeCursor> Find(std::string_view key) const {
+            if(!IsMap())
+                return std::nullopt;
+
+            auto [first, last] = keyindex();
+            auto it = std::upper_bound(first, last, key, [this](std::string_view k, std::uint32_t child) {
+                return k < tape->keyof(child);
+            });
+
+            if(it == first || tape->keyof(*std::prev(it)) != key)
+                return std::nullopt;
+
+            return TapeCursor{tape, *std::prev(it)};
+        }
+
+        /// Returns a key that appears more than once in this map, tapes do not require keys
+        /// to be unique.
+        std::optional<std::string_view> FindDuplicateKey() const {
+            if(!IsMap())
+                return std::nullopt;
+
+            auto [first, last] = keyindex();
+            auto it = std::adjacent_find(first, last, [this](std::uint32_t left, std::uint32_t right) {
+                return tape->keyof(left) == tape->keyof(right);
+            });
+
+            if(it == last)
+                return std::nullopt;
+
+            return tape->keyof(*it);
+        }
+
+        bool KeyExists(std::string_view key) const {
+            return Find(key).has_value();
+        }
+
+    private:
+        friend class Tape<LocationType>;
+
+        const internal::TapeNode &node() const { return tape->nodes[index]; }
+
+        /// Children of this map sorted by key
+        auto keyindex() const {
+            auto first = tape->keyindex.begin() + node().value;
+
+            return std::pair{first, first + node().size};
+        }
+
+        const Tape<LocationType> *tape;
+        std::uint32_t index;
+    };
+
+    /**
+     * @brief Compact read-mostly document representation.
+     * All nodes of the document are stored in a single contiguous array in document order
+     * and all strings are stored in a single buffer, thus a document requires only a few
+     * allocations and traversal is cache friendly. Documents are built in order using
+     * Begin/End and Value calls, a Key call should precede every child of a map; YAML
+     * documents can be parsed directly into a tape, see YamlTransport::ParseTape. When a
+     * map ends, its children are sorted by key into a key index, thus Find is logarithmic.
+     * Nodes are accessed through TapeCursor handles. Tapes are limited to 4 GiB of strings
+     * and 4G nodes, adding beyond these limits throws std::length_error. Location of each
+     * node is stored, locations with skip lists are not suitable.
+     */
+    template<LocationConcept LocationType_ = NoLocation>
+    class Tape {
+    public:
+        using LocationType = LocationType_;
+        using Cursor       = TapeCursor<LocationType>;
+
+        /// Reserves space for the given number of nodes and string bytes.
+        void Reserve(size_t nodecount, size_t stringbytes) {
+            nodes.reserve(nodecount);
+            strings.reserve(stringbytes);
+
+            if constexpr(!std::is_empty_v<LocationType>)
+                locations.reserve(nodecount);
+        }
+
+        /// Removes all nodes, memory is kept.
+        void Clear() {
+            nodes.clear();
+            strings.clear();
+            locations.clear();
+            keyindex.clear();
+            open.clear();
+            pendingkey = {};
+        }
+
+        /// Sets the key of the next node, should be called before adding a child to a map.
+        void Key(std::string_view key) {
+            assert(!open.empty() && nodes[open.back()].type == TapeNodeType::Map);
+
+            pendingkey = {store(key), checked(key.size())};
+        }
+
+        void Null(const LocationType &location = {}) {
+            add(TapeNodeType::Null, 0, 0, location);
+        }
+
+        void Value(std::string_view value, const LocationType &location = {}) {
+            auto offset = store(value);
+            add(TapeNodeType::Value, offset, checked(value.size()), location);
+        }
+
+        void BeginSequence(const LocationType &location = {}) {
+            open.push_back(add(TapeNodeType::Sequence, 0, 0, location));
+        }
+
+        void BeginMap(const LocationType &location = {}) {
+            open.push_back(add(TapeNodeType::Map, 0, 0, location));
+        }
+
+        /// Ends the last begun container, the key index of a map is built here.
+        void End() {
+            assert(!open.empty());
+
+            auto index = open.back();
+            open.pop_back();
+            nodes[index].next = checked(nodes.size());
+
+            if(nodes[index].type == TapeNodeType::Map)
+                buildindex(index);
+        }
+
+        /**
+         * @brief Adds a copy of the given node and its children as the next node.
+         * The copy has the given location, its children keep their locations. Strings are
+         * shared if the node belongs to this tape. Used for YAML aliases.
+         */
+        void Copy(const Cursor &source, const LocationType &location = {}) {
+            auto &from  = *source.tape;
+            auto first  = source.index;
+            auto last   = from.nodes[first].next;
+            auto base   = checked(nodes.size());
+
+            checked(nodes.size() + (last - first));
+
+            //the source may be a part of this tape, thus nothing is reallocated while copying
+            nodes.reserve(nodes.size() + (last - first));
+            if constexpr(!std::is_empty_v<LocationType>)
+                locations.reserve(locations.size() + (last - first));
+
+            if(!open.empty())
+                nodes[open.back()].size++;
+
+            for(auto i = first; i < last; i++) {
+                auto node = from.nodes[i];
+                node.next = node.next - first + base;
+
+                if(i == first)
+                    std::tie(node.key, node.keysize) = pendingkey;
+                else
+                    node.key = store(from.view(node.key, node.keysize));
+
+                if(node.type == TapeNodeType::Value) {
+                    node.value = store(from.view(node.value, node.size));
+                }
+                else if(node.type == TapeNodeType::Map) {
+                    auto start = node.value;
+                    node.value = checked(keyindex.size());
+
+                    for(std::uint32_t child = 0; child < node.size; child++)
+                        keyindex.push_back(from.keyindex[start + child] - first + base);
+                }
+
+                nodes.push_back(node);
+
+                if constexpr(!std::is_empty_v<LocationType>)
+                    locations.push_back(i == first ? location : from.locations[i]);
+            }
+
+            pendingkey = {};
+        }
+
+        /// Returns the first top level node. Tape should not be empty.
+        Cursor Root() const {
+            assert(!nodes.empty() && open.empty());
+
+            return {this, 0};
+        }
+
+        bool IsEmpty() const { return nodes.empty(); }
+
+        size_t GetNodeCount() const { return nodes.size(); }
+
+        /// Returns the number of bytes used by nodes, strings, key indices and locations.
+        size_t GetMemoryUsage() const {
+            return
+                nodes.capacity() * sizeof(internal::TapeNode) + strings.capacity() +
+                keyindex.capacity() * sizeof(std::uint32_t) + locations.capacity() * sizeof(LocationType);
+        }
+
+    private:
+        friend class TapeCursor<LocationType>;
+
+        /// Offsets and indices are stored in 32 bits.
+        static std::uint32_t checked(size_t value) {
+            if(value > std::numeric_limits<std::uint32_t>::max())
+                throw std::length_error("Tape size limit exceeded");
+
+            return static_cast<std::uint32_t>(value);
+        }
+
+        std::uint32_t store(std::string_view str) {
+            //strings that are already in the buffer, such as the keys of copied nodes, are
+            //shared
+            auto less = std::less<const char *>{};
+            if(!less(str.data(), strings.data()) && !less(strings.data() + strings.size(), str.data() + str.size()))
+                return checked(static_cast<size_t>(str.data() - strings.data()));
+
+            auto offset = checked(strings.size());
+            checked(strings.size() + str.size());
+            strings += str;
+
+            return offset;
+        }
+
+        std::string_view view(std::uint32_t offset, std::uint32_t size) const {
+            return {strings.data() + offset, size};
+        }
+
+        std::string_view keyof(std::uint32_t index) const {
+            return view(nodes[index].key, nodes[index].keysize);
+        }
+
+        /// Appends the children of the given map to the key index sorted by key, children
+        /// with the same key keep their order.
+        void buildindex(std::uint32_t index) {
+            auto start = keyindex.size();
+
+            for(auto child = index + 1; child < nodes[index].next; child = nodes[child].next)
+                keyindex.push_back(child);
+
+            std::stable_sort(keyindex.begin() + static_cast<std::ptrdiff_t>(start), keyindex.end(), [this](std::uint32_t left, std::uint32_t right) {
+                return keyof(left) < keyof(right);
+            });
+
+            nodes[index].value = checked(start);
+        }
+
+        std::uint32_t add(TapeNodeType type, std::uint32_t value, std::uint32_t size, const LocationType &location) {
+            auto index = checked(nodes.size());
+            checked(nodes.size() + 1);
+
+            if(!open.empty())
+                nodes[open.back()].size++;
+
+            nodes.push_back({index + 1, pendingkey.first, pendingkey.second, value, size, type});
+            pendingkey = {};
+
+            if constexpr(!std::is_empty_v<LocationType>)
+                locations.push_back(location);
+
+            return index;
+        }
+
+        std::vector<internal::TapeNode> nodes;
+        std::string strings;
+        std::vector<LocationType> locations;
+
+        /// Children of each map sorted by key, see TapeNode::value
+        std::vector<std::uint32_t> keyindex;
+
+        /// Indices of the containers that are not ended
+        std::vector<std::uint32_t> open;
+        std::pair<std::uint32_t, std::uint32_t> pendingkey = {};
+    };
+
+}
@@ -4,6 +4,7 @@
 #include "cpp-serializer/concepts.hpp"
 #include "cpp-serializer/tmp.hpp"
 #include <cassert>
+#include <cstring>
 #include <ostream>
 #include <string>
 #include <string_view>
@@ -119,6 +120,71 @@ namespace CPP_SERIALIZER_NAMESPACE {
         std::string target;
     };
     
+    namespace internal {
+        /**
+         * @brief Collects small writes into a fixed buffer before passing them to the target.
+         * Emitters write many short pieces such as indentation, indicators and keys; each
+         * write to a stream has a noticeable cost, thus they are combined into writes of
+         * Size_ bytes. Writes larger than the buffer are passed directly. Flush should be
+         * called once writing is finished.
+         */
+        template<TargetConcept TargetType_, size_t Size_ = 4096>
+        class CoalescingTarget {
+        public:
+            explicit CoalescingTarget(TargetType_ &target_) : target(target_) { }
+
+            CoalescingTarget(const CoalescingTarget &) = delete;
+            CoalescingTarget &operator=(const CoalescingTarget &) = delete;
+
+            void Put(const std::string_view &data) {
+                if(data.size() > Size_ - used) {
+                    Flush();
+
+                    if(data.size() >= Size_) {
+                        target.Put(data);
+                        return;
+                    }
+                }
+
+                std::memcpy(buffer + used, data.data(), data.size());
+                used += data.size();
+            }
+
+            void Put(const std::string_view &data, size_t start, size_t len) {
+                Put(data.substr(start, len));
+            }
+
+            void Put(const std::string_view &data, size_t len) {
+                Put(data.substr(0, len));
+            }
+
+            void Put(char data) {
+                if(used == Size_)
+                    Flush();
+
+                buffer[used++] = data;
+            }
+
+            /// Passes the buffered data to the target.
+            void Flush() {
+                if(used) {
+                    target.Put(std::string_view{buffer, used});
+                    used = 0;
+                }
+            }
+
+            /// Returns the current location of the write pointer, including buffered data.
+            size_t Tell() const requires requires(const TargetType_ &t) { t.Tell(); } {
+                return target.Tell() + used;
+            }
+
+        private:
+            TargetType_ &target;
+            size_t used = 0;
+            char buffer[Size_];
+        };
+    }
+
     //TODO: specialize for std::path, ifstream
     
     template<class T_> concept TargetInstatiation = IsInstantiationV<T_, Target>;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.hpp"
+#include <array>
 #include <cstddef>
 #include <string_view>
 #include <tuple>
@@ -99,4 +100,75 @@ namespace CPP_SERIALIZER_NAMESPACE {
         return MaskedMixedTimeDataHelper<Opts...>();
     }
 
+    namespace internal {
+        /// Resolves the option at the given index for the given combination of runtime
+        /// options. Each runtime option takes a bit from the combination in order.
+        template<size_t Comb, size_t Ind, YesNoRuntime ...Opts>
+        consteval YesNoRuntime ResolveMixedTimeOption() {
+            constexpr auto opts = std::array<YesNoRuntime, sizeof...(Opts)>{Opts...};
+
+            if(opts[Ind] != YesNoRuntime::Runtime) return opts[Ind];
+
+            auto bit = size_t{0};
+            for(size_t i = 0; i < Ind; i++)
+                if(opts[i] == YesNoRuntime::Runtime) bit++;
+
+            return (Comb >> bit) & 1 ? YesNoRuntime::Yes : YesNoRuntime::No;
+        }
+
+        template<class Inds_, YesNoRuntime ...Opts>
+        struct MixedTimeDispatcher;
+
+        template<size_t ...Inds, YesNoRuntime ...Opts>
+        struct MixedTimeDispatcher<std::index_sequence<Inds...>, Opts...> {
+            static constexpr size_t RuntimeCount = ((Opts == YesNoRuntime::Runtime) + ... + size_t{0});
+
+            template<size_t Comb, class Func_>
+            static decltype(auto) Invoke(Func_ &func) {
+                return func.template operator()<ResolveMixedTimeOption<Comb, Inds, Opts...>()...>();
+            }
+
+            template<class Func_, size_t ...Combs>
+            static decltype(auto) Call(const std::array<bool, sizeof...(Opts)> &settings, Func_ &func, std::index_sequence<Combs...>) {
+                using Result = decltype(Invoke<0>(func));
+
+                constexpr auto opts  = std::array<YesNoRuntime, sizeof...(Opts)>{Opts...};
+                constexpr auto table = std::array<Result (*)(Func_ &), sizeof...(Combs)>{&Invoke<Combs, Func_>...};
+
+                auto comb = size_t{0};
+                auto bit  = size_t{0};
+                for(size_t i = 0; i < sizeof...(Opts); i++) {
+                    if(opts[i] == YesNoRuntime::Runtime) {
+                        comb |= size_t(settings[i]) << bit;
+                        bit++;
+                    }
+                }
+
+                return table[comb](func);
+            }
+        };
+    }
+
+    /**
+     * @brief Calls the given function with runtime options turned into compile time ones.
+     * Mixed time options that are set to Runtime are read from the settings and the
+     * function is called with a compile time Yes or No in their place, others are passed
+     * as is. This allows inner loops to be compiled with constant options while the
+     * selection is performed only once. Function is instantiated for every combination
+     * of runtime options, thus the number of runtime options should be kept small.
+     * Example:
+     * DispatchMixedTime<opt1, opt2>(settings, [&]<YesNoRuntime o1, YesNoRuntime o2>() {...});
+     * @param settings Runtime values of the options, values of non-runtime options are ignored
+     * @param func Function to call, should accept options as template arguments.
+     * @return The value returned from the function
+     */
+    template<YesNoRuntime ...Opts, class Func_>
+    decltype(auto) DispatchMixedTime(const std::array<bool, sizeof...(Opts)> &settings, Func_ &&func) {
+        using Dispatcher = internal::MixedTimeDispatcher<std::make_index_sequence<sizeof...(Opts)>, Opts...>;
+
+        static_assert(Dispatcher::RuntimeCount < 8, "Too many runtime options for dispatch");
+
+        return Dispatcher::Call(settings, func, std::make_index_sequence<size_t{1} << Dispatcher::RuntimeCount>{});
+    }
+
 }
\ No newline at end of file
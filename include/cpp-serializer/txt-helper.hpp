@@ -3,33 +3,468 @@
 #include "config.hpp"
 #include "concepts.hpp"
 #include "cpp-serializer/source.hpp"
+#include "cpp-serializer/target.hpp"
 #include "utf.hpp"
 #include "types.hpp"
 #include "location.hpp"
 #include "tmp.hpp"
 
+#include <algorithm>
 #include <cctype>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <future>
 #include <limits>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <array>
+#include <vector>
 
 namespace CPP_SERIALIZER_NAMESPACE::internal {
 
 #include "macros.hpp"
     
     /// Performs unity string conversion.
-    template<class LocationType_ = NoLocation>
+    template<class LocationType_ = NoLocation, class StringType_ = std::string>
     struct SimpleTextDataConverter {
         using LocationType = LocationType_;
 
         auto operator()(const Context<LocationType> &c, const std::string_view &s) {
-            return std::pair{c.location, std::string(s)};
+            return std::pair{c.location, StringType_(s)};
+        }
+        /// Converts directly into the target, reusing its memory
+        template<DataConcept DataType>
+        void operator()(const Context<LocationType> &c, const std::string_view &s, DataType &target) {
+            target.SetData(s);
+            target.SetLocation(c.location);
+        }
+        const StringType_ &operator()(const StringType_ &s) { return s; }
+    };
+
+    /// Performs unity conversion without copying, resulting view refers to the parsed
+    /// buffer.
+    template<class LocationType_ = NoLocation>
+    struct ViewTextDataConverter {
+        using LocationType = LocationType_;
+
+        auto operator()(const Context<LocationType> &c, const std::string_view &s) {
+            return std::pair{c.location, s};
+        }
+        auto operator()(const std::string_view &s) { return s; }
+    };
+
+    /**
+     * @brief Reusable buffers for text parsing.
+     * Passing the same scratch to consecutive parse calls allows the memory of the text
+     * buffer and the skip list to be reused. A scratch should not be used by multiple
+     * threads at the same time.
+     */
+    template<LocationConcept LocationType>
+    struct TextScratch {
+        std::string buffer;
+        Context<LocationType> context;
+    };
+
+    /**
+     * @brief Parses the given reader for text without copying.
+     * Parsed data refers to the buffer of the reader, thus reader should be a non-owning
+     * source such as Source<std::string_view>. This function is used by ParseText when
+     * the storage type is a view, it does not support any transformations.
+     */
+    template<SourceConcept SourceType, DataConcept DataType>
+    void ParseTextView(SourceType &reader, DataType &target) {
+        //extract necessary types
+        using DataTraits   = DataType::DataTraits;
+        using LocationType = DataTraits::LocationType;
+
+        static_assert(
+            std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>,
+            "View storage requires a source that returns views to its own buffer, such as Source<std::string_view>"
+        );
+        
+        typename DataTraits::DataParserType parser{};
+        auto [location, data] = parser(Context<LocationType>{LocationType{0, 1, 1}, {}}, reader.Read(std::numeric_limits<size_t>::max()));
+        target.SetData(data);
+        target.SetLocation(std::move(location));
+    }
+
+    /// Result of decoding a single escape sequence
+    struct EscapeResult {
+        /// Number of bytes written to the output
+        size_t length;
+        /// Number of bytes consumed from the input including the backslash
+        size_t consumed;
+        /// False if the sequence is not a valid escape and it is copied as is
+        bool decoded;
+    };
+
+    /// Returns the value of the given hex digit or -1 if it is not a hex digit.
+    constexpr inline int HexValue(int c) noexcept {
+        if(c >= '0' && c <= '9') return c - '0';
+        if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    /**
+     * @brief Decodes a single backslash escape sequence.
+     * The backslash should already be consumed. Supported sequences are \n, \t, \r, \0,
+     * \\, \", \', \uXXXX and \UXXXXXXXX. Surrogates are decoded as U+FFFD. Unknown or
+     * incomplete sequences are copied as is.
+     * @param peek Returns the next input character as int or -1 at the end of input
+     * @param advance Consumes the next input character
+     * @param out Output buffer, should have room for MaxEscapeLength bytes
+     */
+    template<class Peek_, class Advance_>
+    EscapeResult DecodeEscape(Peek_ &&peek, Advance_ &&advance, char *out) {
+        auto c = peek();
+        auto simple = [&](char decoded) {
+            advance();
+            out[0] = decoded;
+            return EscapeResult{1, 2, true};
+        };
+
+        switch(c) {
+        case 'n':  return simple('\n');
+        case 't':  return simple('\t');
+        case 'r':  return simple('\r');
+        case '0':  return simple('\0');
+        case '\\': return simple('\\');
+        case '"':  return simple('"');
+        case '\'': return simple('\'');
+        case 'u':
+        case 'U': {
+            advance();
+
+            out[0] = '\\';
+            out[1] = static_cast<char>(c);
+
+            auto digits = size_t(c == 'u' ? 4 : 8);
+            auto cp     = char32_t{0};
+
+            for(size_t i = 0; i < digits; i++) {
+                auto h = HexValue(peek());
+
+                //not a valid sequence, copy what is consumed
+                if(h == -1) return {i + 2, i + 2, false};
+
+                out[i + 2] = static_cast<char>(peek());
+                advance();
+                cp = (cp << 4) | static_cast<char32_t>(h);
+            }
+
+            return {UTF8Encode(cp, out), digits + 2, true};
+        }
+        default:
+            out[0] = '\\';
+            return {1, 1, false};
         }
-        auto operator()(std::string &s) { return s; }
-        auto operator()(const std::string &s) { return s; }
+    }
+
+    /// Number of bytes read and written by DecodeEscapes
+    struct DecodeResult {
+        size_t read;
+        size_t written;
     };
 
+    /// Maximum length of an escape sequence including the backslash
+    inline constexpr size_t MaxEscapeLength = 10;
+
+    /**
+     * @brief Decodes all backslash escapes in the given input.
+     * Input is searched for backslashes and carriage returns using memchr and the runs
+     * between them are moved in bulk, thus input without escapes is processed at memory
+     * speed. Line breaks \r and \r\n are converted to \n as TransformText does. Output
+     * can be the same as the input as decoded text is never longer than the input.
+     * @param onescape Called as onescape(written, result) after each decoded escape where 
+     *        written is the number of bytes written so far including the escape.
+     * @param last If not set, decoding stops before an escape or a line break that might
+     *        continue after the end of the input. Remaining bytes should be supplied again
+     *        with the rest of the input.
+     */
+    template<class Callback_>
+    DecodeResult DecodeEscapes(const char *in, size_t size, char *out, Callback_ &&onescape, bool last = true) {
+        auto r = size_t{0}, w = size_t{0};
+
+        //offset of the next occurrence, size if there is none
+        auto search = [&](char c) {
+            auto found = static_cast<const char *>(std::memchr(in + r, c, size - r));
+            return found ? static_cast<size_t>(found - in) : size;
+        };
+
+        auto backslash = search('\\');
+        auto cr        = search('\r');
+
+        while(r < size) {
+            //occurrences are searched again only after they are passed
+            if(backslash < r) backslash = search('\\');
+            if(cr < r) cr = search('\r');
+
+            auto hit = std::min(backslash, cr);
+            auto run = hit - r;
+
+            if(out + w != in + r) std::memmove(out + w, in + r, run);
+            
+            w += run;
+            r += run;
+
+            if(hit == size) break;
+
+            if(hit == cr) {
+                if(!last && r + 1 == size) break;
+
+                out[w++] = '\n';
+                r += r + 1 < size && in[r + 1] == '\n' ? 2 : 1;
+                continue;
+            }
+
+            if(!last && size - r < MaxEscapeLength) break;
+
+            char buf[MaxEscapeLength];
+            auto pos = r + 1;
+            auto ret = DecodeEscape(
+                [&]() -> int { return pos < size ? static_cast<unsigned char>(in[pos]) : -1; },
+                [&] { pos++; }, 
+                buf
+            );
+
+            std::memcpy(out + w, buf, ret.length);
+            w += ret.length;
+            r += ret.consumed;
+
+            if(ret.decoded) onescape(w, ret);
+        }
+
+        return {r, w};
+    }
+
+    /// Returns true if the given character should be escaped during emit. Line feeds are
+    /// not escaped, thus paragraphs remain on separate lines; carriage returns are, as the
+    /// parser turns them into line feeds.
+    constexpr inline bool NeedsEscape(char c) noexcept {
+        return c == '\\' || (static_cast<unsigned char>(c) < 0x20 && c != '\n');
+    }
+
+    /**
+     * @brief Finds the first character that needs escaping.
+     * Input is checked 8 bytes at a time by detecting backslashes and control characters
+     * with bitwise arithmetic, only words that contain candidates, including line feeds,
+     * are checked per byte.
+     * @return Offset of the character or npos if there is none.
+     */
+    inline size_t FindEscapable(const std::string_view &data, size_t from = 0) noexcept {
+        constexpr auto ones  = uint64_t{0x0101010101010101};
+        constexpr auto highs = uint64_t{0x8080808080808080};
+        constexpr auto bslsh = ones * '\\';
+
+        auto size = data.size();
+        auto off  = from;
+
+        for(; off + 8 <= size; off += 8) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + off, 8);
+
+            //bytes less than 0x20 or equal to backslash set their high bits
+            auto xored = word ^ bslsh;
+            auto found = ((word - ones * 0x20) & ~word & highs) | ((xored - ones) & ~xored & highs);
+            
+            if(found) {
+                for(size_t i = 0; i < 8; i++)
+                    if(NeedsEscape(data[off + i])) return off + i;
+            }
+        }
+
+        for(; off < size; off++)
+            if(NeedsEscape(data[off])) return off;
+
+        return std::string_view::npos;
+    }
+
+    /// Writes the escaped form of the given character to the buffer. Characters that
+    /// DecodeEscape has a short form for use it, thus decoding restores them.
+    template<class BufferType>
+    void PutEscaped(char c, BufferType &buffer) {
+        switch(c) {
+        case '\\': buffer.append("\\\\"); break;
+        case '\t': buffer.append("\\t"); break;
+        case '\r': buffer.append("\\r"); break;
+        case '\0': buffer.append("\\0"); break;
+        default: {
+            constexpr auto hex = std::string_view{"0123456789abcdef"};
+            auto u = static_cast<unsigned char>(c);
+
+            char escaped[] = {'\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xf]};
+            buffer.append(std::string_view{escaped, sizeof(escaped)});
+        }
+        }
+    }
+
+    /**
+     * @brief Escapes the given text into the buffer.
+     * Runs without characters to escape are appended in bulk. Buffer should support
+     * append.
+     */
+    template<class BufferType>
+    void EscapeText(const std::string_view &data, BufferType &buffer) {
+        auto off = size_t{0};
+
+        for(auto hit = FindEscapable(data); hit != std::string_view::npos; hit = FindEscapable(data, off)) {
+            buffer.append(data.substr(off, hit - off));
+            PutEscaped(data[hit], buffer);
+            off = hit + 1;
+        }
+
+        buffer.append(data.substr(off));
+    }
+
+    /// Buffer adapter that escapes characters before passing them to the underlying buffer.
+    template<class BufferType>
+    class EscapingBuffer {
+    public:
+        explicit EscapingBuffer(BufferType &buffer_) : buffer(buffer_) { }
+
+        void push_back(char c) {
+            if(NeedsEscape(c)) PutEscaped(c, buffer);
+            else buffer.push_back(c);
+        }
+
+        /// Runs without characters to escape are appended in bulk.
+        void append(const std::string_view &data) {
+            EscapeText(data, buffer);
+        }
+
+        size_t size() const {
+            return buffer.size();
+        }
+
+    private:
+        BufferType &buffer;
+    };
+
+    /**
+     * @brief Transforms the text from the reader into the given buffer.
+     * This is the state machine behind ParseText, see ParseText for the options. Buffer
+     * should support push_back and size, size is used as the offset of skip list entries.
+     * Reader is consumed until its end.
+     */
+    template<
+        YesNoRuntime skiplist_, YesNoRuntime folding_, YesNoRuntime glue_, YesNoRuntime escape_,
+        SourceConcept SourceType, class BufferType, LocationConcept LocationType
+    >
+    void TransformText(SourceType &reader, BufferType &str, LocationType &location, const std::array<bool, 4> &settings) {
+        //mixed time options
+        const bool skiplist = GetMixedTimeOption<skiplist_, 0>(settings);
+        const bool folding = GetMixedTimeOption<folding_, 1>(settings);
+        const bool glue = GetMixedTimeOption<glue_, 2>(settings);
+        const bool escape = GetMixedTimeOption<escape_, 3>(settings);
+        
+        auto char_off = size_t(1);
+        auto has_space= false;
+        
+        size_t line = 1;
+        size_t seqline = 0;
+        
+        while(!reader.IsEof()) {
+            auto c = reader.Get();
+
+            //detect special characters
+            auto do_newline = c == '\n' || c == '\r';
+            auto do_space   = folding && UTF8IsSpace(c, reader);
+
+            //if only one enter was there, convert it to space
+            //this can only happen if glue is on
+            if(!do_newline) {
+                //only one enter is there and glueing is on
+                if(seqline == 1) {
+                    //from the source perspective, next character is on the next line
+                    if(!has_space) str.push_back(' ');
+
+                    AddSkipLine(skiplist, location, reader, str.size(), line, char_off);
+                    char_off = 1;
+
+                    seqline = 0;
+                    has_space = do_space;
+                }
+                else seqline = 0;
+            }
+
+            //just a regular character but there was a space before, thus a skip point
+            //is necessary
+            if(!do_newline && !do_space && has_space) {
+                AddSkip(skiplist, location, reader, str.size(), line, char_off);
+                has_space = false;
+            }
+            
+            //new line
+            if(do_newline) {     
+                //If it is \r\n, ignore \n
+                if(c == '\r' && reader.TryPeek() == '\n') {
+                    reader.Advance();
+                }
+
+                if(glue) { //join lines if there is no additional line breaks
+                    if(seqline < 1) {
+                        seqline++; //ignore first enter, if space is needed, it will be handled later
+                    }
+                    else {
+                        //There is an extra line in source, we need to add this.
+                        if(seqline == 1) {
+                            line++;
+                        }
+
+                        seqline++; //incremented further to signal enter is added
+
+                        str.push_back('\n');
+                        AddSkipLine(skiplist, location, reader, str.size(), line, char_off);
+                    }
+                }
+                else {
+                    str.push_back('\n'); //simply add the new line
+                    AddSkipLine(skiplist, location, reader, str.size(), line, char_off);
+                }
+            }
+            else if(do_space) {
+                if(!has_space) {
+                    CPPSER_UTF_COPY(reader, c, str);
+                }
+                else {
+                    CPPSER_UTF_IGNORE_REST(reader, c);
+                }
+
+
+                char_off++;
+                
+                has_space = true;
+            }
+            else if(escape && c == '\\') {
+                char buf[MaxEscapeLength];
+                auto ret = DecodeEscape(
+                    [&reader]() -> int { return reader.IsEof() ? -1 : static_cast<unsigned char>(reader.Peek()); },
+                    [&reader] { reader.Advance(); },
+                    buf
+                );
+
+                for(size_t i = 0; i < ret.length; i++)
+                    str.push_back(buf[i]);
+
+                //escapes are ASCII, thus consumed bytes are characters
+                char_off += ret.consumed;
+
+                if(ret.decoded)
+                    AddSkip(skiplist, location, reader, str.size(), line, char_off);
+            }
+            else {
+                CPPSER_UTF_COPY(reader, c, str);
+
+                char_off++;
+            }
+        }
+    }
 
     /**
      * @brief Parses the given reader for text to the target
@@ -40,207 +475,611 @@ namespace CPP_SERIALIZER_NAMESPACE::internal {
      *         not skiplists
      * @tparam folding_ Mixed time option for whitespace folding. Does not control newlines
      * @tparam glue_ Mixed time option for glueing consecutive lines.
+     * @tparam escape_ Mixed time option for decoding backslash escapes.
      * @tparam SourceType Automatically determined
      * @tparam DataType  Automatically determined
      * @param reader The data source
      * @param target The obtained text will stored here
-     * @param settings Mixed time settings in the order of skiplist, folding and glue. They
-     *        have no effect unless corresponding template argument is set to Runtime
+     * @param settings Mixed time settings in the order of skiplist, folding, glue and escape.
+     *        They have no effect unless corresponding template argument is set to Runtime
+     * @param scratch Buffers to be used while parsing, their memory is reused. If the data
+     *        parser supports in place conversion and the target already holds enough memory,
+     *        parsing does not allocate.
      */
-    template<YesNoRuntime skiplist_, YesNoRuntime folding_, YesNoRuntime glue_, SourceConcept SourceType, DataConcept DataType>
-    void ParseText(SourceType &reader, DataType &target, const std::array<bool, 3> &settings) {
+    template<
+        YesNoRuntime skiplist_, YesNoRuntime folding_, YesNoRuntime glue_, YesNoRuntime escape_, 
+        SourceConcept SourceType, DataConcept DataType
+    >
+    void ParseText(
+        SourceType &reader, DataType &target, const std::array<bool, 4> &settings, 
+        TextScratch<typename DataType::DataTraits::LocationType> &scratch
+    ) {
         //extract necessary types
         using DataTraits   = DataType::DataTraits;
         using LocationType = DataTraits::LocationType;
         using StorageType = DataTraits::StorageType;
+
+        //storage refers to the source, no transformation is possible
+        if constexpr(std::is_same_v<StorageType, std::string_view>) {
+            static_assert(
+                skiplist_ == YesNoRuntime::No && folding_ == YesNoRuntime::No && 
+                glue_ == YesNoRuntime::No && escape_ == YesNoRuntime::No,
+                "View storage cannot be used with skiplist, folding, glue or escape"
+            );
+
+            ParseTextView(reader, target);
+            return;
+        }
         
         //mixed time options
         const bool skiplist = GetMixedTimeOption<skiplist_, 0>(settings);
         const bool folding = GetMixedTimeOption<folding_, 1>(settings);
         const bool glue = GetMixedTimeOption<glue_, 2>(settings);
+        const bool escape = GetMixedTimeOption<escape_, 3>(settings);
         
-        auto location = LocationType{0, 1, 1};
-        auto str      = std::string{};
-        auto char_off = size_t(1);
-        auto has_space= false;
+        auto &location = scratch.context.location;
+        auto &str      = scratch.buffer;
         
-        if(skiplist || folding || glue) {
+        ResetLocation(location);
+        str.clear();
+        
+        if(folding || glue || (skiplist && !escape)) {
             //if size is known, allocate that much space
             if(auto sz = reader.Size(); sz)
                 str.reserve(*sz);
             
-            size_t line = 1;
-            size_t seqline = 0;
+            TransformText<skiplist_, folding_, glue_, escape_>(reader, str, location, settings);
+        }
+        else if(escape) {
+            //read entire buffer and decode escapes in bulk
+            auto raw  = reader.Read(std::numeric_limits<size_t>::max());
+            auto in   = raw.data();
+            auto size = raw.size();
             
-            while(!reader.IsEof()) {
-                auto c = reader.Get();
+            //owned buffers are decoded in place
+            if constexpr(std::is_same_v<decltype(raw), std::string>) {
+                str = std::move(raw);
+                in  = str.data();
+            }
+            else {
+                str.resize(size);
+            }
 
-                //detect special characters
-                auto do_newline = c == '\n' || c == '\r';
-                auto do_space   = folding && UTF8IsSpace(c, reader);
+            auto decoded = DecodeEscapes(in, size, str.data(), [&](size_t offset, const EscapeResult &ret) {
+                //only escapes change locations, location of the escape is found from the 
+                //previous skip point and the escape is skipped
+                CPPSER_IF_MIXED(LocationType::HasSkipList(), skiplist) {
+                    auto start = offset - ret.length;
+                    auto loc   = location.Obtain(start, std::string_view{str.data(), start});
 
-                //if only one enter was there, convert it to space
-                //this can only happen if glue is on
-                if(!do_newline) {
-                    //only one enter is there and glueing is on
-                    if(seqline == 1) {
-                        //from the source perspective, next character is on the next line
-                        if(!has_space) str.push_back(' ');
+                    loc.CharOffset += ret.consumed;
+                    location.SkipList[offset] = loc;
+                }
+            });
 
-                        AddSkipLine(skiplist, location, reader, str.size(), line, char_off);
-                        char_off = 1;
+            str.resize(decoded.written);
+        }
+        else {
+            //read entire buffer, views are copied to reuse the memory of the buffer
+            auto raw = reader.Read(std::numeric_limits<size_t>::max());
+            
+            if constexpr(std::is_same_v<decltype(raw), std::string>)
+                str = std::move(raw);
+            else
+                str.assign(raw);
+        }
+        
+        //further parse data
+        using ParserType = DataTraits::DataParserType;
+        ParserType parser{};
+        
+        if constexpr(InPlaceDataParserConcept<ParserType, LocationType, DataType>) {
+            parser(scratch.context, str, target);
+        }
+        else {
+            StorageType data;
+            std::tie(location, data) = parser(scratch.context, str);
+            target.SetData(std::move(data));
+            target.SetLocation(location);
+        }
+    }
 
-                        seqline = 0;
-                        has_space = do_space;
-                    }
-                    else seqline = 0;
+    /**
+     * @brief Word wrapping state machine.
+     * Lines are broken at the last white space before the width is exceeded, the white
+     * space at the break is dropped. If a line has no break point, it is written as is.
+     * Every line break in the data is doubled unless it is followed by another line
+     * break so that wrapped paragraphs stay separated. Line slices are written directly
+     * from the given data, thus wrapping does not allocate. Data can be supplied in
+     * pieces, in that case the unwritten part of the current line should be supplied
+     * again at the start of the next call.
+     */
+    class TextWrapper {
+    public:
+        explicit TextWrapper(size_t wrapwidth_) : wrapwidth(wrapwidth_) { }
+
+        /**
+         * @brief Wraps the given data into the target.
+         * @param data Text to be written. Should start with the bytes that are returned
+         *        as not written by the previous call.
+         * @param target Target to write the text to
+         * @param last If set, all the data will be written. Otherwise, current line is
+         *        kept as it might be broken by the following data.
+         * @return Offset of the first byte that is not written to the target
+         */
+        template<TargetConcept TargetType>
+        size_t Wrap(const std::string_view &data, TargetType &target, bool last) {
+            auto size       = data.size();
+            auto linestart  = size_t{};             //offset of the current line
+            auto breakoff   = lastbreak;            //offset of the last break candidate in the current line
+            
+            for(auto off = scanned; off < size;) {
+                auto c = data[off];
+
+                //new line resets all
+                if(c == '\n') {
+                    target.Put(data, linestart, off - linestart);
+                    if(!prevnline)
+                        target.Put('\n');
+                    target.Put('\n');
+
+                    off++;
+                    linestart = off;
+                    breakoff  = nobreak;
+                    chars     = 0;
+                    prevnline = true;
+
+                    continue;
                 }
 
-                //just a regular character but there was a space before, thus a skip point
-                //is necessary
-                if(!do_newline && !do_space && has_space) {
-                    AddSkip(skiplist, location, reader, str.size(), line, char_off);
-                    has_space = false;
+                auto bytes = UTF8Bytes(c);
+
+                //incomplete character, rest will be supplied later
+                if(off + bytes > size) {
+                    if(!last) {
+                        size = off;
+                        break;
+                    }
+
+                    bytes = size - off;
                 }
                 
-                //new line
-                if(do_newline) {     
-                    //If it is \r\n, ignore \n
-                    if(c == '\r' && reader.TryPeek() == '\n') {
-                        reader.Advance();
-                    }
+                chars++;
+                prevnline = false;
 
-                    if(glue) { //join lines if there is no additional line breaks
-                        if(seqline < 1) {
-                            seqline++; //ignore first enter, if space is needed, it will be handled later
+                if(UTF8IsSpace(data, off)) {
+                    //a space at the start of a line is not a break point
+                    breakoff  = off == linestart ? nobreak : off;
+                    breakchars = chars;
+                    off += bytes;
+                }
+                else {
+                    off += bytes;
+
+                    if(chars > wrapwidth) {
+                        //write all if no breaking chars are found
+                        if(breakoff == nobreak) {
+                            target.Put(data, linestart, off - linestart);
+                            linestart = off;
+                            chars     = 0;
                         }
                         else {
-                            //There is an extra line in source, we need to add this.
-                            if(seqline == 1) {
-                                line++;
-                            }
-
-                            seqline++; //incremented further to signal enter is added
+                            //write out until the last break and skip it
+                            target.Put(data, linestart, breakoff - linestart);
+                            target.Put('\n');
 
-                            str.push_back('\n');
-                            AddSkipLine(skiplist, location, reader, str.size(), line, char_off);
+                            linestart = std::min(breakoff + UTF8Bytes(data[breakoff]), off);
+                            chars    -= breakchars;
+                            breakoff  = nobreak;
                         }
                     }
-                    else {
-                        str.push_back('\n'); //simply add the new line
-                        AddSkipLine(skiplist, location, reader, str.size(), line, char_off);
-                    }
                 }
-                else if(do_space) {
-                    if(!has_space) {
-                        CPPSER_UTF_COPY(reader, c, str);
-                    }
-                    else {
-                        CPPSER_UTF_IGNORE_REST(reader, c);
-                    }
+            }
 
+            //write the remaining
+            if(last) {
+                target.Put(data, linestart, data.size() - linestart);
+                linestart = data.size();
+                size      = data.size();
+            }
 
-                    char_off++;
-                    
-                    has_space = true;
-                }
-                else {
-                    CPPSER_UTF_COPY(reader, c, str);
+            //store the state relative to the current line
+            scanned         = size - linestart;
+            lastbreak = breakoff == nobreak ? nobreak : breakoff - linestart;
+
+            return linestart;
+        }
+
+    private:
+        static constexpr auto nobreak = std::string_view::npos;
+
+        size_t wrapwidth;
+        size_t scanned    = 0;          //number of bytes of the current line that are processed
+        size_t lastbreak  = nobreak;    //offset of the last break candidate from the line start
+        size_t chars      = 0;          //number of characters in the current line
+        size_t breakchars = 0;          //number of characters upto and including the last break
+        bool   prevnline  = false;
+    };
+
+    /**
+     * @brief Writes the given text to the target wrapping lines at the given width.
+     * See TextWrapper for the details.
+     * @param data Text to be written
+     * @param target Target to write the text to
+     * @param wrapwidth Maximum number of characters in a line
+     */
+    template<TargetConcept TargetType>
+    void WrapText(const std::string_view &data, TargetType &target, size_t wrapwidth) {
+        TextWrapper{wrapwidth}.Wrap(data, target, true);
+    }
+
+    /// Minimum number of bytes a parallel wrap task should process. Smaller texts are
+    /// wrapped on the calling thread.
+    inline constexpr size_t ParallelWrapMinChunk = 64 * 1024;
+
+    /**
+     * @brief Splits the given text into paragraph aligned chunks.
+     * Chunks are split right after a line break that is not followed by another line
+     * break. Wrapping such chunks separately produces the same output as wrapping the
+     * whole text. Returned offsets are the start of each chunk, end of the text is not
+     * included.
+     */
+    inline std::vector<size_t> SplitParagraphs(const std::string_view &data, size_t chunks) {
+        auto ret = std::vector<size_t>{0};
+        
+        if(chunks < 2) return ret;
+
+        auto size = data.size();
+        auto step = std::max(size / chunks, ParallelWrapMinChunk);
+
+        for(auto off = step; off < size; off += step) {
+            //find the next line break that starts a new paragraph
+            auto br = data.find('\n', off);
+            while(br != std::string_view::npos && br + 1 < size && data[br + 1] == '\n')
+                br++;
+
+            if(br == std::string_view::npos || br + 1 >= size) break;
+
+            ret.push_back(br + 1);
+            off = br + 1;
+        }
+
+        return ret;
+    }
+
+    /**
+     * @brief Wraps paragraphs of the given text concurrently.
+     * Text is split into paragraph aligned chunks which are wrapped into separate buffers
+     * using up to the given number of threads. Buffers are written to the target in order,
+     * thus the output is identical to WrapText. 
+     * @param threads Maximum number of threads to use, 0 uses hardware concurrency
+     */
+    template<TargetConcept TargetType>
+    void WrapTextParallel(const std::string_view &data, TargetType &target, size_t wrapwidth, size_t threads) {
+        if(threads == 0) 
+            threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        auto splits = SplitParagraphs(data, threads);
+        
+        if(splits.size() < 2) {
+            WrapText(data, target, wrapwidth);
+            return;
+        }
+
+        splits.push_back(data.size());
+
+        //first chunk is wrapped on this thread directly into the target
+        auto tasks = std::vector<std::future<std::string>>{};
+        tasks.reserve(splits.size() - 2);
+
+        for(size_t i = 1; i < splits.size() - 1; i++) {
+            auto chunk = data.substr(splits[i], splits[i + 1] - splits[i]);
+
+            tasks.push_back(std::async(std::launch::async, [chunk, wrapwidth] {
+                auto buffer = std::string{};
+                //line breaks can be doubled
+                buffer.reserve(chunk.size() + chunk.size() / 8);
+                
+                auto writer = Target<std::string>{buffer};
+                WrapText(chunk, writer, wrapwidth);
+
+                return buffer;
+            }));
+        }
+
+        WrapText(data.substr(0, splits[1]), target, wrapwidth);
+
+        for(auto &task : tasks)
+            target.Put(task.get());
+    }
+
+    /**
+     * @brief Bounded buffer that hands text to a consumer as it fills.
+     * This buffer can be used as the output of TransformText. Whenever the window is
+     * filled, buffered text is passed to the consumer as consumer(data, last) which should
+     * return the number of bytes it has used. Unused bytes are kept for the next call.
+     * Size of the buffer is the total number of bytes that passed through it.
+     */
+    template<class Consumer>
+    class TextStreamBuffer {
+    public:
+        TextStreamBuffer(Consumer &consumer_, size_t window_) : 
+            consumer(consumer_), 
+            window(std::max<size_t>(window_, 1)), 
+            limit(this->window) 
+        {
+            buffer.reserve(this->window);
+        }
+
+        void push_back(char c) {
+            buffer.push_back(c);
+
+            if(buffer.size() >= limit)
+                Flush(false);
+        }
+
+        void append(const std::string_view &data) {
+            buffer.append(data);
+
+            if(buffer.size() >= limit)
+                Flush(false);
+        }
+
+        size_t size() const {
+            return passed + buffer.size();
+        }
+
+        /// Passes the buffered text to the consumer. If last is set, consumer is expected
+        /// to use all the data.
+        void Flush(bool last) {
+            auto used = consumer(std::string_view{buffer}, last);
+
+            passed += used;
+            buffer.erase(0, used);
+            limit = buffer.size() + window;
+        }
 
-                    char_off++;
+    private:
+        Consumer &consumer;
+        std::string buffer;
+        size_t window;
+        size_t limit;
+        size_t passed = 0;
+    };
+
+    /**
+     * @brief Bounded single producer, single consumer queue of text chunks.
+     * Chunk buffers are recycled, thus after the first few chunks no allocation is 
+     * performed. Closing the channel releases both sides.
+     */
+    class TextChannel {
+    public:
+        explicit TextChannel(size_t capacity_) : capacity(std::max<size_t>(capacity_, 1)) { }
+
+        /// Copies the given data into a chunk and queues it. Blocks while the queue is full.
+        /// Data is dropped if the channel is closed.
+        void Push(const std::string_view &data) {
+            auto chunk = std::string{};
+            
+            {
+                auto lock = std::unique_lock{mutex};
+                notfull.wait(lock, [this] { return chunks.size() < capacity || closed; });
+
+                if(closed) return;
+
+                if(!spare.empty()) {
+                    chunk = std::move(spare.back());
+                    spare.pop_back();
                 }
             }
+
+            chunk.assign(data);
+
+            {
+                auto lock = std::lock_guard{mutex};
+                chunks.push_back(std::move(chunk));
+            }
+            notempty.notify_one();
+        }
+
+        /// Replaces the given chunk with the next one in the queue. Given chunk is recycled.
+        /// Blocks while the queue is empty, returns false if the channel is closed and there
+        /// are no more chunks.
+        bool Pop(std::string &chunk) {
+            {
+                auto lock = std::unique_lock{mutex};
+                notempty.wait(lock, [this] { return !chunks.empty() || closed; });
+
+                if(chunks.empty()) return false;
+
+                spare.push_back(std::move(chunk));
+                chunk = std::move(chunks.front());
+                chunks.pop_front();
+            }
+            notfull.notify_one();
+
+            return true;
+        }
+
+        void Close() {
+            {
+                auto lock = std::lock_guard{mutex};
+                closed = true;
+            }
+            notfull.notify_all();
+            notempty.notify_all();
+        }
+
+    private:
+        size_t capacity;
+        bool closed = false;
+        std::deque<std::string> chunks;
+        std::vector<std::string> spare;
+        std::mutex mutex;
+        std::condition_variable notfull, notempty;
+    };
+
+    /**
+     * @brief Reads the text from the given reader into the stream buffer.
+     * Text is transformed using the given options, see ParseText. Stream buffer is not
+     * flushed for the last time.
+     */
+    template<YesNoRuntime folding_, YesNoRuntime glue_, YesNoRuntime escape_, SourceConcept SourceType, class BufferType>
+    void StreamText(SourceType &reader, BufferType &buffer, const std::array<bool, 4> &settings, size_t window) {
+        //mixed time options
+        const bool folding = GetMixedTimeOption<folding_, 0>(settings);
+        const bool glue = GetMixedTimeOption<glue_, 1>(settings);
+        const bool escape = GetMixedTimeOption<escape_, 3>(settings);
+
+        window = std::max<size_t>(window, 1);
+
+        if(folding || glue) {
+            auto location = NoLocation{};
+            TransformText<YesNoRuntime::No, folding_, glue_, escape_>(reader, buffer, location, {false, folding, glue, escape});
+        }
+        else if(escape) {
+            //decode escapes in bulk, an escape that is cut at the end of the window is 
+            //kept for the next window
+            auto pending = std::string{};
+
+            while(!reader.IsEof()) {
+                pending.append(reader.Read(window));
+
+                auto decoded = DecodeEscapes(pending.data(), pending.size(), pending.data(), [](auto, auto &) {}, reader.IsEof());
+                buffer.append(std::string_view{pending.data(), decoded.written});
+                pending.erase(0, decoded.read);
+            }
         }
         else {
-            //read entire buffer
-            str = reader.Read(std::numeric_limits<size_t>::max());
+            while(!reader.IsEof())
+                buffer.append(reader.Read(window));
+        }
+    }
+
+    /**
+     * @brief Parses the given reader and emits it to the target without storing the text.
+     * Text is transformed with the same options as ParseText and emitted as EmitText, but
+     * it is passed through a buffer bounded by the given window. Data emitter of the data
+     * traits is not used. If threaded is set, reading is performed on a separate thread
+     * and up to four windows can be queued between threads.
+     * @tparam folding_ Mixed time option for whitespace folding.
+     * @tparam glue_ Mixed time option for glueing consecutive lines.
+     * @tparam wordwrap_ Mixed time option for word wrapping.
+     * @tparam escape_ Mixed time option for decoding and re-encoding escapes.
+     * @param settings Mixed time settings in the order of folding, glue, wordwrap and escape.
+     * @param window Number of bytes that will be buffered before emitting.
+     */
+    template<
+        YesNoRuntime folding_, YesNoRuntime glue_, YesNoRuntime wordwrap_, YesNoRuntime escape_, 
+        SourceConcept SourceType, TargetConcept TargetType
+    >
+    void ReflowText(SourceType &reader, TargetType &target, const std::array<bool, 4> &settings, size_t wrapwidth, size_t window, bool threaded) {
+        //mixed time options
+        const bool wordwrap = GetMixedTimeOption<wordwrap_, 2>(settings);
+        const bool escape = GetMixedTimeOption<escape_, 3>(settings);
+
+        auto wrapper = TextWrapper{wrapwidth};
+        auto emit    = [&](const std::string_view &data, bool last) -> size_t {
+            if(wordwrap)
+                return wrapper.Wrap(data, target, last);
+            
+            target.Put(data);
+            return data.size();
+        };
+
+        //decoded text is escaped again as it is streamed
+        auto stream  = [&](auto &buffer, size_t chunk) {
+            if(escape) {
+                auto escaping = EscapingBuffer{buffer};
+                StreamText<folding_, glue_, escape_>(reader, escaping, settings, chunk);
+            }
+            else {
+                StreamText<folding_, glue_, escape_>(reader, buffer, settings, chunk);
+            }
+
+            buffer.Flush(true);
+        };
+
+        if(!threaded) {
+            auto buffer = TextStreamBuffer{emit, window};
+            stream(buffer, window);
+
+            return;
         }
+
+        constexpr auto queued = size_t{4};
         
-        //further parse data
-        typename DataTraits::DataParserType parser{};
-        StorageType data;
-        std::tie(location, data) = parser(Context<LocationType>{location, {}}, str);
-        target.SetData(data);
-        target.SetLocation(location);
+        auto channel = TextChannel{queued};
+        auto produce = [&](const std::string_view &data, bool) -> size_t {
+            channel.Push(data);
+            return data.size();
+        };
+        
+        auto producer = std::async(std::launch::async, [&] {
+            try {
+                auto buffer = TextStreamBuffer{produce, window / queued};
+                stream(buffer, window / queued);
+            }
+            catch(...) {
+                channel.Close();
+                throw;
+            }
+
+            channel.Close();
+        });
+
+        try {
+            auto chunk   = std::string{};
+            auto pending = std::string{};
+
+            while(channel.Pop(chunk)) {
+                pending.append(chunk);
+                pending.erase(0, emit(pending, false));
+            }
+
+            emit(pending, true);
+        }
+        catch(...) {
+            channel.Close();
+            producer.wait();
+            throw;
+        }
+
+        producer.get();
     }
 
-    template<YesNoRuntime wordwrap_, TargetConcept TargetType, DataConcept DataType>
-    void EmitText(const DataType &source, TargetType &target, std::array<bool, 1> settings, size_t wrapwidth) {
+    template<YesNoRuntime wordwrap_, YesNoRuntime escape_, TargetConcept TargetType, DataConcept DataType>
+    void EmitText(const DataType &source, TargetType &target, std::array<bool, 2> settings, size_t wrapwidth, size_t threads = 1) {
         //extract necessary types
         using DataTraits   = DataType::DataTraits;
 
         //mixed time options
         const bool wordwrap = GetMixedTimeOption<wordwrap_, 0>(settings);
+        const bool escape = GetMixedTimeOption<escape_, 1>(settings);
 
 
         typename DataTraits::DataEmitterType emitter{};
 
-        if(wordwrap) {
-            auto acc        = std::string{};
-            auto data       = emitter(source.GetData());
-            auto lastbreak  = size_t{};
-            auto reader     = make_source(data);
-            auto chars      = size_t{};
-            auto prevnline  = false;
+        //emitters may return a reference to the stored value
+        decltype(auto) data = emitter(source.GetData());
+        auto text    = std::string_view{data};
+        auto escaped = std::string{};
 
-            while(!reader.IsEof()) {
-                auto c = reader.Get();
-
-                //new line resets all
-                if(c == '\n') {
-                    if(!prevnline)
-                        acc.push_back('\n');
-                    acc.push_back('\n');
-                    target.Put(acc);
-                    acc.clear();
-                    lastbreak = 0;
-                    chars = 0;
-                    prevnline = true;
-                }
-                else if(UTF8IsSpace(c, reader)) {
-                    lastbreak = acc.size();
-                    CPPSER_UTF_COPY(reader, c, acc);
-                    chars++;
-                    prevnline = false;
-                }
-                else {
-                    CPPSER_UTF_COPY(reader, c, acc);
-                    chars++;
-                    prevnline = false;
-
-                    if(chars > wrapwidth) {
-                        //write all if no breaking chars are found
-                        if(lastbreak == 0) {
-                            target.Put(acc);
-                            acc.clear();
-                            chars = 0;
-                        }
-                        else {
-                            //write out until the last break
-                            target.Put(acc, lastbreak);
-                            target.Put('\n');
-                            //skip last break
-                            lastbreak += UTF8Bytes(acc[lastbreak]);
-                            acc = acc.substr(lastbreak);
-                            lastbreak = 0;
-
-                            //determine number of characters remaining in the buffer
-                            chars = 0;
-                            auto size = acc.size();
-                            for(size_t i{}; i<size;) {
-                                i += UTF8Bytes(acc[i]);
-                                chars++;
-                            }
-                        }
-                    }
-                }
-            }
+        //text is only copied if there is something to escape
+        if(escape && FindEscapable(text) != std::string_view::npos) {
+            escaped.reserve(text.size() + text.size() / 8);
+            EscapeText(text, escaped);
+            text = escaped;
+        }
 
-            //write the remaining in the buffer
-            target.Put(acc);
+        if(wordwrap) {
+            if(threads == 1)
+                WrapText(text, target, wrapwidth);
+            else
+                WrapTextParallel(text, target, wrapwidth, threads);
         }
         else {
-            target.Put(emitter(source.GetData()));
+            target.Put(text);
         }
     }
 
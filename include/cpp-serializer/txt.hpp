@@ -10,13 +10,21 @@
 #include "source.hpp"
 #include "target.hpp"
 
+#include <algorithm>
 #include <array>
+#include <limits>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 
 #include "macros.hpp"
 
 namespace CPP_SERIALIZER_NAMESPACE {
     
+    /**
+     * @brief Data traits for text documents.
+     * Data may hold lazy nodes, see TextTransport::ParseLazy.
+     */
     template<LocationConcept LocationType_>
     struct TextDataTraits {            
         using StorageType = std::string;
@@ -35,6 +43,36 @@ namespace CPP_SERIALIZER_NAMESPACE {
         using DataParserType = internal::SimpleTextDataConverter<LocationType_>;
         using DataEmitterType = internal::SimpleTextDataConverter<LocationType_>;
         using LocationType = LocationType_;
+        
+        static constexpr bool Lazy = true;
+    };
+
+    /**
+     * @brief Text data traits that refer to the parsed buffer instead of owning a copy.
+     * Data parsed with these traits stores a view to the source buffer, thus parsing
+     * does not copy or allocate. Parsed data is only valid as long as the buffer given
+     * to the parser is alive and unmodified. Only sources that return views to their
+     * buffer, such as Source<std::string_view>, can be used; this is checked at compile
+     * time. Transformations such as folding and glue are not supported.
+     */
+    template<LocationConcept LocationType_>
+    struct ViewTextDataTraits {            
+        using StorageType = std::string_view;
+        
+        using NumberType = void;
+        using IntegerType = void;
+        using RealType = void;
+        using StringType = std::string_view;
+        using NullType = void;
+        using BoolType = void;
+        using IndexType = void;
+        using SequenceType = void;
+        using KeyType = void;
+        using MapType = void;
+        
+        using DataParserType = internal::ViewTextDataConverter<LocationType_>;
+        using DataEmitterType = internal::ViewTextDataConverter<LocationType_>;
+        using LocationType = LocationType_;
     };
 
     struct SimpleTextSettings {
@@ -42,6 +80,7 @@ namespace CPP_SERIALIZER_NAMESPACE {
         constexpr static auto Folding = YesNoRuntime::No;
         constexpr static auto Glue = YesNoRuntime::No;
         constexpr static auto WordWrap = YesNoRuntime::No;
+        constexpr static auto Escape = YesNoRuntime::No;
 
         using DataTraits = TextDataTraits<NoLocation>;
         using DataType   = Data<DataTraits>;
@@ -52,17 +91,33 @@ namespace CPP_SERIALIZER_NAMESPACE {
         constexpr static auto Folding = YesNoRuntime::No;
         constexpr static auto Glue = YesNoRuntime::No;
         constexpr static auto WordWrap = YesNoRuntime::No;
+        constexpr static auto Escape = YesNoRuntime::No;
 
         using DataTraits = TextDataTraits<InnerLocation>;
         using DataType   = Data<DataTraits>;
     };
     
+    /// Text settings that parse without copying, see ViewTextDataTraits for lifetime
+    /// requirements.
+    template<class Location = NoLocation>
+    struct ViewTextSettings {
+        constexpr static auto SkipList = YesNoRuntime::No;
+        constexpr static auto Folding = YesNoRuntime::No;
+        constexpr static auto Glue = YesNoRuntime::No;
+        constexpr static auto WordWrap = YesNoRuntime::Runtime;
+        constexpr static auto Escape = YesNoRuntime::No;
+
+        using DataTraits = ViewTextDataTraits<Location>;
+        using DataType   = Data<DataTraits>;
+    };
+    
     template<class Location = NoLocation>
     struct RuntimeTextSettings {
         constexpr static auto SkipList = Location::HasSkipList() ? YesNoRuntime::Runtime : YesNoRuntime::No;
         constexpr static auto Folding = YesNoRuntime::Runtime;
         constexpr static auto Glue = YesNoRuntime::Runtime;
         constexpr static auto WordWrap = YesNoRuntime::Runtime;
+        constexpr static auto Escape = YesNoRuntime::Runtime;
 
         using DataTraits = TextDataTraits<Location>;
         using DataType   = Data<DataTraits>;
@@ -71,38 +126,65 @@ namespace CPP_SERIALIZER_NAMESPACE {
     CPPSER_DEFINE_MIXTIME_STRUCT(TextTransport, SkipList, skiplist, true)
     CPPSER_DEFINE_MIXTIME_STRUCT(TextTransport, Folding, folding, true)
     CPPSER_DEFINE_MIXTIME_STRUCT(TextTransport, Glue, glue, true)
+    CPPSER_DEFINE_MIXTIME_STRUCT(TextTransport, Escape, escape, false)
+
+    namespace internal {
+        /// Escape setting of the given text settings, No if the settings do not have one.
+        template<class Settings_>
+        inline constexpr YesNoRuntime TextEscapeSetting = [] {
+            if constexpr(requires { Settings_::Escape; })
+                return YesNoRuntime(Settings_::Escape);
+            else
+                return YesNoRuntime::No;
+        }();
+    }
     namespace internal {
         CPPSER_DEFINE_MIXTIME_STRUCT_LEAVEOPEN(TextTransport, WordWrap, wordwrap, true) //{
             void SetWrapWidth(size_t value) { wrapwidth = value; }
             size_t GetWrapWidth() const { return wrapwidth; }
+            /// Sets the number of threads used to wrap paragraphs. 1 wraps on the calling
+            /// thread, 0 uses hardware concurrency. Small texts are always wrapped on the
+            /// calling thread.
+            void SetEmitThreads(size_t value) { emitthreads = value; }
+            size_t GetEmitThreads() const { return emitthreads; }
         protected:
             size_t wrapwidth = 80;
+            size_t emitthreads = 1;
         };
         template <> 
         struct TextTransport_wordwrap_helper<YesNoRuntime::Yes> {
             void SetWrapWidth(size_t value) { wrapwidth = value; }
             size_t GetWrapWidth() const { return wrapwidth; }
+            void SetEmitThreads(size_t value) { emitthreads = value; }
+            size_t GetEmitThreads() const { return emitthreads; }
         protected:
             size_t wrapwidth = 80;
+            size_t emitthreads = 1;
         };
     }
 
     
-    //TODO: Implement line glueing, escape characters as well as wordwrap
     /**
      * @brief Allows parsing emmitting text files.
      *
      * This class can handle text files with different properties, such as wordwrap, whitespace folding.
+     * If escape is set, backslash escapes (\n, \t, \r, \0, \\, \", \', \uXXXX, \UXXXXXXXX) are 
+     * decoded while parsing. While emitting, backslashes and control characters other than line
+     * feeds are escaped. Line feeds, such as paragraph breaks, are written as line breaks,
+     * thus reflowed paragraphs stay apart; emitted text parses back to the same data if glue
+     * is not set.
+     * Non-ASCII characters are written as UTF-8.
      * @important Currently this class is used for experimentation, it should not be used.
      *
      * @tparam Settings_ Use this structure to specify text transport settings. Text transport settings
-     * should follow TextSettingsConcept
+     * should follow TextSettingsConcept, Escape is optional and defaults to No.
      */
     template<TextSettingsConcept Settings_ = SimpleTextSettings>
     class TextTransport : 
         public internal::TextTransport_skiplist_helper<Settings_::SkipList>,
         public internal::TextTransport_folding_helper<Settings_::Folding>,
-        public internal::TextTransport_glue_helper<Settings_::Glue> ,
+        public internal::TextTransport_glue_helper<Settings_::Glue>,
+        public internal::TextTransport_escape_helper<internal::TextEscapeSetting<Settings_>>,
         public internal::TextTransport_wordwrap_helper<Settings_::WordWrap> 
     {
     public:
@@ -111,6 +193,12 @@ namespace CPP_SERIALIZER_NAMESPACE {
         using DataTraits   = Settings::DataTraits;
         using StorageType  = DataType::StorageType;
         using LocationType = DataTraits::LocationType;
+
+        /// Escape setting, settings without Escape do not escape
+        static constexpr auto Escape = internal::TextEscapeSetting<Settings_>;
+        
+        /// Reusable parse buffers, see Parse.
+        using ScratchType  = internal::TextScratch<LocationType>;
         
         /**
          * @brief Parses a given source into the given data target.
@@ -133,15 +221,55 @@ namespace CPP_SERIALIZER_NAMESPACE {
          */
         template<bool AutoTranslateSource = true, class Source_>
         void Parse(Source_ &source, DataType &data) {
+            ScratchType scratch;
+            Parse<AutoTranslateSource>(source, data, scratch);
+        }
+        
+        /**
+         * @brief Parses a given source into the given data target using the given buffers.
+         * Performs text parsing according to the options of the parser. Memory held by the
+         * scratch and the data is reused, thus repeatedly parsing into the same data with the
+         * same scratch does not allocate once the buffers are large enough. Stream sources
+         * still allocate while reading.
+         * @param source Data source, see Parse(source, data).
+         * @param data Data target, this variable will be filled with the parsed data.
+         * @param scratch Parse buffers, should not be used by multiple threads at the same time.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        void Parse(Source_ &source, DataType &data, ScratchType &scratch) {
             auto reader = make_source<AutoTranslateSource>(source);
             
-            auto settings = std::array<bool, 3>{};
+            parse(reader, data, parsesettings<4>(), scratch);
+            record(scratch);
+        }
+        
+        /**
+         * @brief Records the given source to be parsed when the data is first accessed.
+         * Only the range of the text is recorded, transformations and data conversion are
+         * performed when the data is first accessed using the current options. Thus, this
+         * function does not allocate and documents that are never read are never parsed.
+         * Location of the data is set to the start of the text. 
+         * @param source Data source, should return views to its own buffer, such as 
+         *        Source<std::string_view>; this is checked at compile time. The buffer
+         *        should outlive the data and should not be modified.
+         * @param data Data target, this variable will hold the unparsed text. Its traits
+         *        should allow lazy nodes, such as TextDataTraits.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        void ParseLazy(Source_ &source, DataType &data) {
+            auto reader = make_source<AutoTranslateSource>(source);
             
-            CPPSER_READ_IF_RUNTIME(SkipList, 0);
-            CPPSER_READ_IF_RUNTIME(Folding, 1);
-            CPPSER_READ_IF_RUNTIME(Glue, 2);
+            static_assert(
+                std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>,
+                "Lazy parsing requires a source that returns views to its own buffer, such as Source<std::string_view>"
+            );
+            static_assert(
+                DataType::DataTraits::HasLazy(),
+                "Lazy parsing requires data traits that allow lazy nodes, such as TextDataTraits"
+            );
             
-            internal::ParseText<Settings::SkipList, Settings::Folding, Settings::Glue>(reader, data, settings);
+            data.SetLazy({reader.Read(std::numeric_limits<size_t>::max()), parsesettings<8>(), &materialize});
+            data.SetLocation(LocationType{0, 1, 1});
         }
 
 
@@ -174,21 +302,168 @@ namespace CPP_SERIALIZER_NAMESPACE {
         void Emit(const DataType &data, T_ &target) {
             auto writer = make_target(target);
             auto ww = size_t{80};
+            auto threads = size_t{1};
 
             if constexpr(Settings::WordWrap != YesNoRuntime::No) {
                 ww = this->GetWrapWidth();
+                threads = this->GetEmitThreads();
             }
 
-            auto settings = std::array<bool, 1>{};
+            auto settings = std::array<bool, 2>{};
             CPPSER_READ_IF_RUNTIME(WordWrap, 0);
+            settings[1] = escapesetting();
+
+            DispatchMixedTime<Settings::WordWrap, Escape>(
+                settings, 
+                [&]<YesNoRuntime wordwrap_, YesNoRuntime escape_>() {
+                    internal::EmitText<wordwrap_, escape_>(data, writer, settings, ww, threads);
+                }
+            );
+        }
+
+        /**
+         * @brief Parses the given source and emits it to the given target as it is read.
+         * The whole text is never stored, memory use is bounded by the reflow window. Output
+         * is the same as calling Parse and then Emit, except data emitter is not used.
+         * @tparam AutoTranslateSource See Parse
+         * @param source Data source, see Parse
+         * @param target Emit target, anything that can be turned into a Target.
+         */
+        template<bool AutoTranslateSource = true, class Source_, class T_>
+        void Reflow(Source_ &source, T_ &target) {
+            auto reader = make_source<AutoTranslateSource>(source);
+            auto writer = make_target(target);
+            auto ww = size_t{80};
+
+            if constexpr(Settings::WordWrap != YesNoRuntime::No) {
+                ww = this->GetWrapWidth();
+            }
+
+            auto settings = std::array<bool, 4>{};
+
+            CPPSER_READ_IF_RUNTIME(Folding, 0);
+            CPPSER_READ_IF_RUNTIME(Glue, 1);
+            CPPSER_READ_IF_RUNTIME(WordWrap, 2);
+            settings[3] = escapesetting();
+
+            DispatchMixedTime<Settings::Folding, Settings::Glue, Settings::WordWrap, Escape>(
+                settings, 
+                [&]<YesNoRuntime folding_, YesNoRuntime glue_, YesNoRuntime wordwrap_, YesNoRuntime escape_>() {
+                    internal::ReflowText<folding_, glue_, wordwrap_, escape_>(
+                        reader, writer, settings, ww, reflowwindow, reflowthreaded
+                    );
+                }
+            );
+        }
+
+        /// Sets the collector that parse calls record their statistics to, nullptr (the
+        /// default) disables collection. Copies of the transport, such as the workers of
+        /// ParseBatch, record to the same collector, which should outlive them. Lazy nodes
+        /// are not counted when they are parsed.
+        void SetStatisticsCollector(ParseStatisticsCollector *value) { collector = value; }
+        ParseStatisticsCollector *GetStatisticsCollector() const { return collector; }
 
-            internal::EmitText<Settings::WordWrap>(data, writer, settings, ww);
+        /// Sets the number of bytes buffered during Reflow.
+        void SetReflowWindow(size_t value) { reflowwindow = value; }
+        size_t GetReflowWindow() const { return reflowwindow; }
+
+        /// If set, Reflow reads the source on a separate thread.
+        void SetReflowThreaded(bool value) { reflowthreaded = value; }
+        bool GetReflowThreaded() const { return reflowthreaded; }
+
+    private:
+        bool escapesetting() const {
+            if constexpr(Escape == YesNoRuntime::Runtime)
+                return this->GetEscape();
+            else
+                return Escape == YesNoRuntime::Yes;
         }
+
+        /// Reads the parse options into mixed time settings
+        template<size_t Size_>
+        std::array<bool, Size_> parsesettings() const {
+            auto settings = std::array<bool, Size_>{};
+            
+            CPPSER_READ_IF_RUNTIME(SkipList, 0);
+            CPPSER_READ_IF_RUNTIME(Folding, 1);
+            CPPSER_READ_IF_RUNTIME(Glue, 2);
+            settings[3] = escapesetting();
+            
+            return settings;
+        }
+        
+        template<class Reader_>
+        static void parse(Reader_ &reader, DataType &data, const std::array<bool, 4> &settings, ScratchType &scratch) {
+            DispatchMixedTime<Settings::SkipList, Settings::Folding, Settings::Glue, Escape>(
+                settings, 
+                [&]<YesNoRuntime skiplist_, YesNoRuntime folding_, YesNoRuntime glue_, YesNoRuntime escape_>() {
+                    internal::ParseText<skiplist_, folding_, glue_, escape_>(reader, data, settings, scratch);
+                }
+            );
+        }
+        
+        void record(const ScratchType &scratch) const {
+            //skip list is walked to measure it, only if statistics are requested
+            if(!collector)
+                return;
+
+            auto usage = MemoryUsage{};
+            internal::AddMemoryUsage(usage, scratch.buffer);
+            internal::AddMemoryUsage(usage, scratch.context.location);
+
+            auto entries = size_t{0};
+            if constexpr(LocationType::HasSkipList())
+                entries = scratch.context.location.SkipList.size();
+
+            collector->Record(usage.Total(), entries);
+        }
+        
+        /// Parses a node recorded by ParseLazy
+        static void materialize(DataType &data, const typename DataType::LazyNode &node) {
+            auto reader = Source<std::string_view>{node.source};
+            auto settings = std::array<bool, 4>{};
+            std::copy_n(node.settings.begin(), settings.size(), settings.begin());
+            
+            ScratchType scratch;
+            parse(reader, data, settings, scratch);
+        }
+        
+        size_t reflowwindow = 64 * 1024;
+        bool reflowthreaded = false;
+        ParseStatisticsCollector *collector = nullptr;
     };
     
     inline TextTransport<> TextTransportSimple;
     using RuntimeTextTransport = TextTransport<RuntimeTextSettings<>>;
     using RuntimeTextTransportSkipList = TextTransport<RuntimeTextSettings<GlobalInnerLocation>>;
+    using ViewTextTransport = TextTransport<ViewTextSettings<>>;
+
+    namespace pmr {
+        /**
+         * @brief Text data traits that allocate using polymorphic allocators.
+         * Data constructed with a memory resource stores its text and skip list in that
+         * resource. Use an arena such as std::pmr::monotonic_buffer_resource when parsed
+         * documents are discarded as a whole.
+         */
+        template<LocationConcept LocationType_>
+        struct TextDataTraits : CPP_SERIALIZER_NAMESPACE::TextDataTraits<LocationType_> {
+            using StorageType = std::pmr::string;
+            using StringType = std::pmr::string;
+            
+            using DataParserType = internal::SimpleTextDataConverter<LocationType_, std::pmr::string>;
+            using DataEmitterType = internal::SimpleTextDataConverter<LocationType_, std::pmr::string>;
+            using AllocatorType = std::pmr::polymorphic_allocator<std::byte>;
+        };
+        
+        template<class Location = NoLocation>
+        struct RuntimeTextSettings : CPP_SERIALIZER_NAMESPACE::RuntimeTextSettings<Location> {
+            using DataTraits = pmr::TextDataTraits<Location>;
+            using DataType   = Data<DataTraits>;
+        };
+        
+        using RuntimeTextTransport = TextTransport<RuntimeTextSettings<>>;
+        using RuntimeTextTransportSkipList = TextTransport<RuntimeTextSettings<pmr::GlobalInnerLocation>>;
+    }
 
 }
 
@@ -4,6 +4,7 @@
 #include "concepts.hpp"
 
 #include <stddef.h>
+#include <string_view>
 
 
 namespace CPP_SERIALIZER_NAMESPACE {
@@ -14,6 +15,45 @@ namespace CPP_SERIALIZER_NAMESPACE {
         return 1 + size_t(c >= 0b11000000) + size_t(c >= 0b11100000) + size_t(c >= 0b11110000);
     }
 
+    /// Returns the number of code points in the given UTF8 string.
+    constexpr inline size_t UTF8CodePoints(std::string_view str) noexcept {
+        auto count = size_t{0};
+        for(auto c : str)
+            count += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+
+        return count;
+    }
+
+    /// Encodes the given code point to UTF8 and returns the number of bytes written. Output
+    /// should have room for 4 bytes. Surrogates and invalid code points are encoded as the
+    /// replacement character U+FFFD.
+    constexpr inline size_t UTF8Encode(char32_t cp, char *out) noexcept {
+        if((cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) cp = 0xfffd;
+
+        if(cp < 0x80) {
+            out[0] = static_cast<char>(cp);
+            return 1;
+        }
+        else if(cp < 0x800) {
+            out[0] = static_cast<char>(0xc0 | (cp >> 6));
+            out[1] = static_cast<char>(0x80 | (cp & 0x3f));
+            return 2;
+        }
+        else if(cp < 0x10000) {
+            out[0] = static_cast<char>(0xe0 | (cp >> 12));
+            out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            out[2] = static_cast<char>(0x80 | (cp & 0x3f));
+            return 3;
+        }
+        else {
+            out[0] = static_cast<char>(0xf0 | (cp >> 18));
+            out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3f));
+            out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3f));
+            out[3] = static_cast<char>(0x80 | (cp & 0x3f));
+            return 4;
+        }
+    }
+
     template<SourceConcept Source_>
     constexpr inline bool UTF8IsSpace(char first, Source_ &src) {
         switch(static_cast<unsigned char>(first)) {
@@ -70,4 +110,39 @@ namespace CPP_SERIALIZER_NAMESPACE {
         return false;
     }
 
+    /// Checks if the code point starting at the given offset of data is a white space.
+    /// Unlike the source based variant, this function performs bounds checking and
+    /// returns false for truncated sequences.
+    constexpr inline bool UTF8IsSpace(const std::string_view &data, size_t offset) noexcept {
+        auto byte = [&data, offset](size_t forward) {
+            return offset + forward < data.size() ? static_cast<unsigned char>(data[offset + forward]) : 0;
+        };
+
+        auto first = byte(0);
+
+        //fast path for ASCII
+        if(first < 0x80) 
+            return first == 0x20 || (first >= 0x9 && first <= 0xd);
+
+        switch(first) {
+        case 0xc2:
+            return byte(1) == 0x85 || byte(1) == 0xa0;
+        case 0xe1:
+            return (byte(1) == 0x9a && byte(2) == 0x80) || (byte(1) == 0xa0 && byte(2) == 0x8e);
+        case 0xe2:
+            if(byte(1) == 0x80) {
+                auto c = byte(2);
+                return (c >= 0x80 && c <= 0x8d) || c == 0xa8 || c == 0xa9 || c == 0xaf;
+            }
+            
+            return byte(1) == 0x81 && (byte(2) == 0x9f || byte(2) == 0xa0);
+        case 0xe3:
+            return byte(1) == 0x80 && byte(2) == 0x80;
+        case 0xef:
+            return byte(1) == 0xbb && byte(2) == 0xbf;
+        }
+
+        return false;
+    }
+
 }
@@ -0,0 +1,3160 @@
+#pragma once
+
+#include "config.hpp"
+#include "batch.hpp"
+#include "concepts.hpp"
+#include "fields.hpp"
+#include "location.hpp"
+#include "source.hpp"
+#include "tape.hpp"
+#include "target.hpp"
+#include "tmp.hpp"
+#include "txt-helper.hpp"
+#include "types.hpp"
+#include "utf.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /// Presentation style of a YAML scalar
+    enum class YamlScalarStyle {
+        Plain,
+        SingleQuoted,
+        DoubleQuoted,
+        Literal,
+        Folded
+    };
+
+    /// Type of a YAML event
+    enum class YamlEventType {
+        StreamStart,
+        StreamEnd,
+        DocumentStart,
+        DocumentEnd,
+        MappingStart,
+        MappingEnd,
+        SequenceStart,
+        SequenceEnd,
+        Scalar,
+        Alias
+    };
+
+}
+
+namespace CPP_SERIALIZER_NAMESPACE::internal {
+
+    /// Character classes of the YAML structural index. Bit 0 marks structural characters,
+    /// bit 1 backslashes and bit 2 double quotes. Used for the bytes of the last block that
+    /// do not fill a word.
+    inline constexpr auto YamlCharacterClasses = [] {
+        auto classes = std::array<std::uint8_t, 256>{};
+
+        for(auto c : std::string_view{"\n:#'[]{},"})
+            classes[static_cast<unsigned char>(c)] = 1;
+
+        classes['"']  = 1 | 4;
+        classes['\\'] = 2;
+
+        return classes;
+    }();
+
+    /// Loads 8 bytes so that the first byte is the lowest byte of the word.
+    inline std::uint64_t LoadLittleEndian(const unsigned char *data) noexcept {
+        auto word = std::uint64_t{};
+        std::memcpy(&word, data, 8);
+
+        if constexpr(std::endian::native == std::endian::big) {
+            auto swapped = std::uint64_t{};
+            for(int i = 0; i < 8; i++)
+                swapped |= ((word >> (56 - 8 * i)) & 0xff) << (8 * i);
+
+            word = swapped;
+        }
+
+        return word;
+    }
+
+    /**
+     * @brief Classifies 8 bytes at once, each class becomes an 8 bit mask with bit i
+     * set for byte i. Bytes equal to a character are found exactly using SWAR: the high
+     * bit of a byte of x is set only if the byte is zero, without the borrows between
+     * bytes of the usual subtraction test. Masks are gathered from the high bits with a
+     * single multiplication.
+     */
+    struct YamlWordClasses {
+        std::uint64_t structural;
+        std::uint64_t backslash;
+        std::uint64_t quote;
+
+        static YamlWordClasses Classify(std::uint64_t word) noexcept {
+            constexpr auto ones  = std::uint64_t{0x0101010101010101};
+            constexpr auto lows  = std::uint64_t{0x7f7f7f7f7f7f7f7f};
+            constexpr auto highs = std::uint64_t{0x8080808080808080};
+
+            //high bit of each byte of the given word that equals c
+            auto equal = [](std::uint64_t bytes, unsigned char c) {
+                auto x = bytes ^ (ones * c);
+
+                return ~(((x & lows) + lows) | x) & highs;
+            };
+
+            //bit i of the result is the high bit of byte i
+            auto gather = [](std::uint64_t bits) {
+                return ((bits >> 7) * std::uint64_t{0x0102040810204080}) >> 56;
+            };
+
+            //characters that differ in a single bit are compared together with that bit
+            //cleared: [ and {, ] and }, # and '
+            auto brackets = word & (ones * 0xdf);
+            auto hashes   = word & (ones * 0xfb);
+
+            auto quote = equal(word, '"');
+            auto structural =
+                equal(word, '\n') | equal(word, ':') | equal(word, ',') | equal(hashes, '#') |
+                equal(brackets, '[') | equal(brackets, ']') | quote;
+
+            return {gather(structural), gather(equal(word, '\\')), gather(quote)};
+        }
+    };
+
+    /**
+     * @brief Returns the mask of characters that are escaped by a backslash in a 64 byte
+     * block. Only odd length runs of backslashes escape the character that follows them,
+     * runs are found using carries of an addition instead of a loop.
+     * @param backslash Mask of backslashes in the block
+     * @param carry Set if the first character of the next block is escaped, should be zero
+     *        for the first block.
+     */
+    constexpr inline std::uint64_t FindEscaped(std::uint64_t backslash, std::uint64_t &carry) noexcept {
+        constexpr auto even = std::uint64_t{0x5555555555555555};
+
+        //an escaped backslash does not start a run
+        backslash &= ~carry;
+
+        auto follows   = (backslash << 1) | carry;
+        auto oddstarts = backslash & ~even & ~follows;
+        auto sequences = oddstarts + backslash;
+
+        carry = sequences < oddstarts;
+
+        return (even ^ (sequences << 1)) & follows;
+    }
+
+    /**
+     * @brief Stage one of the YAML parser, finds the positions of structural characters.
+     * Source is classified in blocks of 64 bytes, each class becomes a 64 bit mask. Bytes
+     * are classified 8 at a time, see YamlWordClasses. Double
+     * quotes escaped by a backslash are removed using bit arithmetic, see FindEscaped, thus
+     * the closing quote of a double quoted scalar is the next quote in the index. Structural
+     * characters are only candidates: a : is only an indicator when followed by white
+     * space and a quote only starts a scalar at the beginning of a node. These are decided
+     * by the parser. Every line break is in the index, thus lines are found without
+     * scanning the source again. The last position is the size of the source.
+     * Index can be built incrementally: Extend indexes the next part of the source and
+     * Discard drops positions that are no longer needed, keeping the memory use bounded
+     * regardless of the source size.
+     */
+    struct YamlIndex {
+        /// Positions in the current window of the index.
+        std::vector<size_t> Positions;
+
+        /// Number of positions that are discarded before the window.
+        size_t Base = 0;
+
+        /// Starts indexing the given source, memory of the previous index is reused.
+        void Reset(std::string_view source_) {
+            source  = source_;
+            indexed = 0;
+            carry   = 0;
+            Base    = 0;
+            Positions.clear();
+        }
+
+        /// Builds the index of the whole source at once.
+        void Build(std::string_view source_) {
+            Reset(source_);
+            Extend(source.size());
+        }
+
+        /// Checks if the whole source is indexed, including the final position.
+        bool IsComplete() const {
+            return indexed > source.size();
+        }
+
+        /// Indexes at least the given number of bytes that follow the indexed part. The
+        /// size of the source is added after the last block.
+        void Extend(size_t bytes) {
+            if(IsComplete())
+                return;
+
+            auto data = reinterpret_cast<const unsigned char *>(source.data());
+            auto size = source.size();
+            auto end  = size - indexed <= bytes ? size : indexed + (bytes + 63) / 64 * 64;
+
+            for(auto block = indexed; block < end; block += 64) {
+                auto count = std::min<size_t>(64, size - block);
+
+                auto structural = std::uint64_t{0};
+                auto backslash  = std::uint64_t{0};
+                auto quote      = std::uint64_t{0};
+
+                auto i = size_t{0};
+
+                for(; i + 8 <= count; i += 8) {
+                    auto classes = YamlWordClasses::Classify(LoadLittleEndian(data + block + i));
+
+                    structural |= classes.structural << i;
+                    backslash  |= classes.backslash << i;
+                    quote      |= classes.quote << i;
+                }
+
+                for(; i < count; i++) {
+                    auto c = std::uint64_t{YamlCharacterClasses[data[block + i]]};
+
+                    structural |= (c & 1) << i;
+                    backslash  |= ((c >> 1) & 1) << i;
+                    quote      |= (c >> 2) << i;
+                }
+
+                structural &= ~(quote & FindEscaped(backslash, carry));
+
+                auto offset = Positions.size();
+                Positions.resize(offset + static_cast<size_t>(std::popcount(structural)));
+
+                for(auto out = Positions.data() + offset; structural; structural &= structural - 1)
+                    *out++ = block + static_cast<size_t>(std::countr_zero(structural));
+            }
+
+            indexed = end;
+
+            if(indexed == size) {
+                Positions.push_back(size);
+                indexed++;
+            }
+        }
+
+        /// Discards the positions before the given position number.
+        void Discard(size_t count) {
+            Positions.erase(Positions.begin(), Positions.begin() + static_cast<std::ptrdiff_t>(count - Base));
+            Base = count;
+        }
+
+        /// Returns the position with the given number, the index is extended as needed.
+        /// Positions before keep may be discarded to keep the window small.
+        size_t At(size_t j, size_t keep) {
+            while(j - Base >= Positions.size()) {
+                if(keep - Base > Positions.size() / 2)
+                    Discard(keep);
+
+                Extend(64 * 1024);
+            }
+
+            return Positions[j - Base];
+        }
+
+    private:
+        std::string_view source;
+        size_t indexed = 0;
+        std::uint64_t carry = 0;
+    };
+
+    /// An event of a YAML stream.
+    struct YamlEvent {
+        YamlEventType type = YamlEventType::StreamStart;
+
+        /// Value of a scalar, refers either to the source or to the parser. It is valid
+        /// until the next event is obtained. Name of the anchor for aliases.
+        std::string_view value;
+
+        /// Anchor of a scalar or of the start of a collection, empty if the node has no
+        /// anchor. Refers to the source.
+        std::string_view anchor;
+
+        YamlScalarStyle style = YamlScalarStyle::Plain;
+
+        /// Byte offset, line and character offset of the start of the node
+        size_t offset    = 0;
+        size_t line      = 1;
+        size_t character = 1;
+    };
+
+    /**
+     * @brief Stage two of the YAML parser, a state machine over the structural index.
+     * Produces events one at a time. Open collections are kept in an explicit stack, thus
+     * nesting depth does not affect the call stack. Block mappings, block sequences, flow
+     * collections, plain, quoted, literal and folded scalars and multiple documents are
+     * supported. Tags are skipped and all scalars are reported as strings as in the
+     * failsafe schema. Scalars that need no transformation are views into the source.
+     * Anchors are reported with the node they belong to and aliases as alias events,
+     * they are not resolved by the parser. Explicit keys, complex keys and anchors or
+     * aliases as mapping keys are not supported. Source is
+     * indexed in windows as the parser advances, thus memory used by the parser does not
+     * depend on the source size, only on the nesting depth and the longest scalar that
+     * needs to be transformed.
+     */
+    class YamlParser {
+    public:
+        /**
+         * @brief Creates a parser for the given source.
+         * @param line_ Line number of the start of the source, used when the source is a
+         *        part of a larger document that starts at a line.
+         * @param offset_ Byte offset of the source, added to the offsets of events.
+         */
+        explicit YamlParser(std::string_view source_, size_t line_ = 1, size_t offset_ = 0) :
+            source(source_), line(line_), baseoffset(offset_)
+        {
+            index.Reset(source);
+        }
+
+        YamlParser(const YamlParser &) = delete;
+        YamlParser &operator=(const YamlParser &) = delete;
+
+        /**
+         * @brief Obtains the next event.
+         * @return false after the stream end event is returned.
+         * @throws std::runtime_error if the source is not valid YAML.
+         */
+        bool Next(YamlEvent &event) {
+            while(head == pending.size()) {
+                if(phase == Phase::Done)
+                    return false;
+
+                pending.clear();
+                head = 0;
+                step();
+            }
+
+            event = pending[head++];
+
+            return true;
+        }
+
+    private:
+        enum class Phase {
+            StreamStart,
+            DocumentStart,
+            Root,
+            Body,
+            Done
+        };
+
+        enum class Kind {
+            BlockMap,
+            BlockSequence,
+            FlowMap,
+            FlowSequence
+        };
+
+        /// Next item expected by a collection
+        enum class Expect {
+            Key,
+            Value,
+            Entry,
+            Separator
+        };
+
+        struct Frame {
+            Kind kind;
+            Expect expect;
+            std::ptrdiff_t indent;
+        };
+
+        /// Result of scanning a single line of a plain scalar
+        struct PlainLine {
+            /// End of the scalar without trailing white space
+            size_t end;
+            /// Position where the scan stopped: line break, comment, : indicator or end
+            size_t stop;
+        };
+
+        bool isspace(size_t p) const {
+            return p < source.size() && (source[p] == ' ' || source[p] == '\t' || source[p] == '\r');
+        }
+
+        /// Checks if the position is the end of the source or followed by white space
+        bool isseparated(size_t p) const {
+            return p >= source.size() || isspace(p) || source[p] == '\n';
+        }
+
+        bool isflowindicator(size_t p) const {
+            if(p >= source.size())
+                return false;
+
+            auto c = source[p];
+            return c == ',' || c == '[' || c == ']' || c == '{' || c == '}';
+        }
+
+        bool isentry(size_t p) const {
+            return p < source.size() && source[p] == '-' && isseparated(p + 1);
+        }
+
+        size_t skipspaces(size_t p) const {
+            while(isspace(p))
+                p++;
+
+            return p;
+        }
+
+        /// Returns the position with the given number from the index, positions before the
+        /// cursor are not needed anymore.
+        size_t at(size_t j) {
+            return index.At(j, cursor);
+        }
+
+        /// Moves the index cursor to the given position, counting the passed lines.
+        void advance(size_t p) {
+            while(at(cursor) < p) {
+                if(source[at(cursor)] == '\n') {
+                    line++;
+                    linestart = at(cursor) + 1;
+                }
+
+                cursor++;
+            }
+        }
+
+        /// Returns the position of the line break that ends the line, or the end of source.
+        size_t lineend(size_t p) {
+            advance(p);
+
+            auto j = cursor;
+            while(at(j) < source.size() && source[at(j)] != '\n')
+                j++;
+
+            return at(j);
+        }
+
+        /// Skips white space, comments and empty lines. Returns the position of the next
+        /// content or the end of the source.
+        size_t nextcontent(size_t p) {
+            while(true) {
+                p = skipspaces(p);
+
+                if(p >= source.size())
+                    break;
+
+                if(source[p] == '#')
+                    p = lineend(p);
+                else if(source[p] == '\n')
+                    p++;
+                else
+                    break;
+            }
+
+            advance(p);
+
+            return p;
+        }
+
+        /// Column of a position that the cursor is advanced to.
+        std::ptrdiff_t column(size_t p) const {
+            return static_cast<std::ptrdiff_t>(p - linestart);
+        }
+
+        bool ismarker(size_t p) const {
+            if(p != linestart || source.size() - p < 3)
+                return false;
+
+            auto marker = source.substr(p, 3);
+            return (marker == "---" || marker == "...") && isseparated(p + 3);
+        }
+
+        YamlEvent mark(size_t p) {
+            advance(p);
+
+            auto event = YamlEvent{};
+            event.offset    = baseoffset + p;
+            event.line      = line;
+            event.character = 1 + UTF8CodePoints(source.substr(linestart, p - linestart));
+
+            return event;
+        }
+
+        void push(YamlEventType type, size_t p) {
+            auto event = mark(std::min(p, source.size()));
+            event.type = type;
+
+            if(type == YamlEventType::MappingStart || type == YamlEventType::SequenceStart)
+                event.anchor = std::exchange(anchor, {});
+
+            pending.push_back(event);
+        }
+
+        void pushscalar(YamlEvent event, std::string_view value, YamlScalarStyle style) {
+            event.type   = YamlEventType::Scalar;
+            event.value  = value;
+            event.style  = style;
+            event.anchor = std::exchange(anchor, {});
+
+            pending.push_back(event);
+        }
+
+        /// Reads the name of an anchor or an alias that starts after the indicator at p,
+        /// after is set to the position after the name.
+        std::string_view anchorname(size_t p, size_t &after) {
+            auto q = p + 1;
+            while(!isseparated(q) && !isflowindicator(q))
+                q++;
+
+            if(q == p + 1)
+                fail(source[p] == '&' ? "Expected an anchor name" : "Expected an alias name", p);
+
+            after = q;
+
+            return source.substr(p + 1, q - p - 1);
+        }
+
+        /// Reads the tags and the anchor of a node starting at p, returns the position after
+        /// them. Tags are skipped, scalars are always strings.
+        size_t properties(size_t p, bool flow) {
+            while(p < source.size() && (source[p] == '!' || source[p] == '&')) {
+                if(source[p] == '&') {
+                    if(!anchor.empty())
+                        fail("A node cannot have more than one anchor", p);
+
+                    advance(p);
+                    anchorline = line;
+                    anchor = anchorname(p, p);
+                }
+                else {
+                    while(!isseparated(p) && !(flow && isflowindicator(p)))
+                        p++;
+                }
+
+                p = flow ? nextcontent(p) : skipspaces(p);
+            }
+
+            return p;
+        }
+
+        /// Parses an alias starting at p in block or flow context.
+        void alias(size_t p) {
+            if(!anchor.empty())
+                fail("An alias cannot have an anchor", p);
+
+            auto event = mark(p);
+            event.type  = YamlEventType::Alias;
+            event.value = anchorname(p, pos);
+
+            pending.push_back(event);
+        }
+
+        [[noreturn]] void fail(const std::string &message, size_t p) {
+            auto event = mark(std::min(p, source.size()));
+
+            throw std::runtime_error(
+                message + " on line " + std::to_string(event.line) + ", character " + std::to_string(event.character)
+            );
+        }
+
+        void step() {
+            switch(phase) {
+            case Phase::StreamStart:
+                push(YamlEventType::StreamStart, 0);
+                phase = Phase::DocumentStart;
+                break;
+
+            case Phase::DocumentStart:
+                startdocument();
+                break;
+
+            case Phase::Root:
+                phase = Phase::Body;
+                expectnode(-1, false, compactroot);
+                break;
+
+            case Phase::Body:
+                if(stack.empty())
+                    enddocument();
+                else
+                    stepframe();
+                break;
+
+            case Phase::Done:
+                break;
+            }
+        }
+
+        void startdocument() {
+            auto p = nextcontent(pos);
+
+            //directives are skipped
+            while(p < source.size() && p == linestart && source[p] == '%')
+                p = nextcontent(lineend(p));
+
+            if(p >= source.size()) {
+                push(YamlEventType::StreamEnd, p);
+                phase = Phase::Done;
+                return;
+            }
+
+            //document end without a document
+            if(ismarker(p) && source[p] == '.') {
+                pos = p + 3;
+                return;
+            }
+
+            push(YamlEventType::DocumentStart, p);
+
+            compactroot = !ismarker(p);
+            pos   = compactroot ? p : p + 3;
+            phase = Phase::Root;
+        }
+
+        void enddocument() {
+            auto p = nextcontent(pos);
+
+            if(p < source.size() && !ismarker(p))
+                fail("Unexpected content after the end of the document", p);
+
+            push(YamlEventType::DocumentEnd, p);
+
+            pos   = p < source.size() && source[p] == '.' ? p + 3 : p;
+            phase = Phase::DocumentStart;
+        }
+
+        /**
+         * Parses the node that follows an indicator. If the rest of the line is empty, the
+         * node is on the following lines and should be indented more than the parent.
+         * @param seqatparent Allows a block sequence at the indentation of the parent,
+         *        used for mapping values.
+         * @param compact Allows block collections to start on the current line.
+         */
+        void expectnode(std::ptrdiff_t parentindent, bool seqatparent, bool compact) {
+            auto q = skipspaces(pos);
+            auto empty = mark(q);
+
+            q = properties(q, false);
+
+            auto p = q;
+
+            if(q >= source.size() || source[q] == '\n' || source[q] == '#') {
+                p = nextcontent(q);
+
+                auto nested =
+                    p < source.size() && !ismarker(p) &&
+                    (column(p) > parentindent || (seqatparent && column(p) == parentindent && isentry(p)));
+
+                if(!nested) {
+                    pushscalar(empty, {}, YamlScalarStyle::Plain);
+                    pos = q;
+                    return;
+                }
+
+                compact = true;
+            }
+
+            node(p, parentindent, compact);
+        }
+
+        void node(size_t p, std::ptrdiff_t parentindent, bool compact) {
+            p = properties(p, false);
+
+            if(p >= source.size() || source[p] == '\n' || source[p] == '#')
+                fail("Expected a node after the properties", p);
+
+            auto start = mark(p);
+            auto indent = column(p);
+            auto c = source[p];
+
+            if(isentry(p)) {
+                if(!compact)
+                    fail("Block sequence entries are not allowed in this context", p);
+
+                stack.push_back({Kind::BlockSequence, Expect::Entry, indent});
+                push(YamlEventType::SequenceStart, p);
+                pos = p;
+                return;
+            }
+
+            switch(c) {
+            case '[':
+            case '{':
+                stack.push_back({c == '[' ? Kind::FlowSequence : Kind::FlowMap, c == '[' ? Expect::Entry : Expect::Key, indent});
+                push(c == '[' ? YamlEventType::SequenceStart : YamlEventType::MappingStart, p);
+                pos = p + 1;
+                return;
+
+            case '|':
+            case '>':
+                blockscalar(p, parentindent);
+                return;
+
+            case '*': {
+                alias(p);
+
+                auto k = skipspaces(pos);
+
+                if(k < source.size() && source[k] == ':' && isseparated(k + 1))
+                    fail("Aliases as mapping keys are not supported", p);
+
+                if(k < source.size() && source[k] != '\n' && source[k] != '#')
+                    fail("Unexpected characters after the alias", k);
+
+                return;
+            }
+
+            case ']':
+            case '}':
+            case ',':
+            case '@':
+            case '`':
+                fail(std::string("Unexpected character '") + c + "'", p);
+
+            case '?':
+                if(isseparated(p + 1))
+                    fail("Explicit keys are not supported", p);
+                break;
+            }
+
+            auto style = YamlScalarStyle::Plain;
+            auto value = std::string_view{};
+            auto after = size_t{0};
+            auto scanned = PlainLine{};
+
+            if(c == '"' || c == '\'') {
+                style = c == '"' ? YamlScalarStyle::DoubleQuoted : YamlScalarStyle::SingleQuoted;
+                value = quoted(p, after);
+            }
+            else {
+                scanned = plainline(p, false);
+                value = source.substr(p, scanned.end - p);
+                after = scanned.stop;
+            }
+
+            auto k = skipspaces(after);
+
+            //scalar followed by : is the first key of a block mapping
+            if(k < source.size() && source[k] == ':' && isseparated(k + 1)) {
+                if(!compact)
+                    fail("Mapping values are not allowed in this context", k);
+
+                //properties on the line of the first key belong to the key
+                if(!anchor.empty() && anchorline == line)
+                    fail("Anchors on mapping keys are not supported", p);
+
+                stack.push_back({Kind::BlockMap, Expect::Value, indent});
+                push(YamlEventType::MappingStart, p);
+                pushscalar(start, value, style);
+                pos = k + 1;
+                return;
+            }
+
+            if(style == YamlScalarStyle::Plain)
+                value = plainlines(p, scanned, parentindent, after);
+            else if(k < source.size() && source[k] != '\n' && source[k] != '#')
+                fail("Unexpected characters after the scalar", k);
+
+            pushscalar(start, value, style);
+            pos = after;
+        }
+
+        void stepframe() {
+            auto &frame = stack.back();
+
+            switch(frame.kind) {
+            case Kind::BlockMap:
+                if(frame.expect == Expect::Value) {
+                    frame.expect = Expect::Key;
+                    expectnode(frame.indent, true, false);
+                }
+                else {
+                    blockkey();
+                }
+                break;
+
+            case Kind::BlockSequence:
+                blockentry();
+                break;
+
+            case Kind::FlowSequence:
+                flowentry();
+                break;
+
+            case Kind::FlowMap:
+                flowmap();
+                break;
+            }
+        }
+
+        void blockkey() {
+            auto indent = stack.back().indent;
+            auto p = nextcontent(pos);
+
+            if(p >= source.size() || ismarker(p) || column(p) < indent) {
+                stack.pop_back();
+                push(YamlEventType::MappingEnd, p);
+                pos = p;
+                return;
+            }
+
+            if(column(p) > indent)
+                fail("Bad indentation of a mapping entry", p);
+
+            auto c = source[p];
+
+            if(c == '&' || c == '*')
+                fail("Anchors and aliases on mapping keys are not supported", p);
+
+            if(isentry(p) || c == '[' || c == '{' || c == '|' || c == '>' || c == '!')
+                fail("Expected a mapping key", p);
+
+            if(c == '?' && isseparated(p + 1))
+                fail("Explicit keys are not supported", p);
+
+            auto start = mark(p);
+            auto style = YamlScalarStyle::Plain;
+            auto value = std::string_view{};
+            auto after = size_t{0};
+
+            if(c == '"' || c == '\'') {
+                style = c == '"' ? YamlScalarStyle::DoubleQuoted : YamlScalarStyle::SingleQuoted;
+                value = quoted(p, after);
+            }
+            else {
+                auto scanned = plainline(p, false);
+                value = source.substr(p, scanned.end - p);
+                after = scanned.stop;
+            }
+
+            auto k = skipspaces(after);
+
+            if(k >= source.size() || source[k] != ':' || !isseparated(k + 1))
+                fail("Could not find expected ':' after the mapping key", k);
+
+            stack.back().expect = Expect::Value;
+            pushscalar(start, value, style);
+            pos = k + 1;
+        }
+
+        void blockentry() {
+            auto indent = stack.back().indent;
+            auto p = nextcontent(pos);
+
+            if(
+                p >= source.size() || ismarker(p) || column(p) < indent ||
+                (column(p) == indent && !isentry(p))
+            ) {
+                stack.pop_back();
+                push(YamlEventType::SequenceEnd, p);
+                pos = p;
+                return;
+            }
+
+            if(column(p) > indent)
+                fail("Bad indentation of a sequence entry", p);
+
+            pos = p + 1;
+            expectnode(indent, false, true);
+        }
+
+        void flowentry() {
+            auto &frame = stack.back();
+            auto p = nextcontent(pos);
+
+            if(p >= source.size())
+                fail("Unterminated flow sequence", p);
+
+            auto c = source[p];
+
+            if(frame.expect == Expect::Separator) {
+                if(c == ',') {
+                    frame.expect = Expect::Entry;
+                    pos = p + 1;
+                    return;
+                }
+
+                if(c != ']')
+                    fail("Expected ',' or ']' in the flow sequence", p);
+            }
+
+            if(c == ']') {
+                stack.pop_back();
+                push(YamlEventType::SequenceEnd, p);
+                pos = p + 1;
+                return;
+            }
+
+            frame.expect = Expect::Separator;
+            flownode(p);
+        }
+
+        void flowmap() {
+            auto &frame = stack.back();
+            auto p = nextcontent(pos);
+
+            if(p >= source.size())
+                fail("Unterminated flow mapping", p);
+
+            auto c = source[p];
+
+            switch(frame.expect) {
+            case Expect::Separator:
+                if(c == ',') {
+                    frame.expect = Expect::Key;
+                    pos = p + 1;
+                    return;
+                }
+
+                if(c != '}')
+                    fail("Expected ',' or '}' in the flow mapping", p);
+
+                [[fallthrough]];
+
+            case Expect::Key:
+            case Expect::Entry:
+                if(c == '}') {
+                    stack.pop_back();
+                    push(YamlEventType::MappingEnd, p);
+                    pos = p + 1;
+                    return;
+                }
+
+                if(c == ',' || c == '[' || c == '{')
+                    fail("Expected a mapping key", p);
+
+                frame.expect = Expect::Value;
+                flowscalar(p);
+                return;
+
+            case Expect::Value:
+                frame.expect = Expect::Separator;
+
+                //key without a value
+                if(c != ':') {
+                    pushscalar(mark(p), {}, YamlScalarStyle::Plain);
+                    pos = p;
+                    return;
+                }
+
+                auto empty = mark(p + 1);
+                auto q = nextcontent(p + 1);
+
+                if(q < source.size() && (source[q] == ',' || source[q] == '}')) {
+                    pushscalar(empty, {}, YamlScalarStyle::Plain);
+                    pos = q;
+                    return;
+                }
+
+                if(q >= source.size())
+                    fail("Unterminated flow mapping", q);
+
+                flownode(q);
+                return;
+            }
+        }
+
+        void flownode(size_t p) {
+            p = properties(p, true);
+
+            if(p >= source.size())
+                fail("Unterminated flow collection", p);
+
+            auto c = source[p];
+
+            if(c == '[' || c == '{') {
+                stack.push_back({c == '[' ? Kind::FlowSequence : Kind::FlowMap, c == '[' ? Expect::Entry : Expect::Key, column(p)});
+                push(c == '[' ? YamlEventType::SequenceStart : YamlEventType::MappingStart, p);
+                pos = p + 1;
+                return;
+            }
+
+            if(c == '*')
+                alias(p);
+            else
+                flowscalar(p);
+
+            auto k = skipspaces(pos);
+            if(k < source.size() && source[k] == ':' && (isseparated(k + 1) || isflowindicator(k + 1)))
+                fail("Single pair mappings in flow sequences are not supported", k);
+        }
+
+        void flowscalar(size_t p) {
+            auto c = source[p];
+
+            if(c == '*' || c == '&')
+                fail("Anchors and aliases on mapping keys are not supported", p);
+
+            if(c == ']' || c == '}' || c == ',')
+                fail(std::string("Unexpected character '") + c + "'", p);
+
+            auto start = mark(p);
+
+            if(c == '"' || c == '\'') {
+                auto value = quoted(p, pos);
+                pushscalar(start, value, c == '"' ? YamlScalarStyle::DoubleQuoted : YamlScalarStyle::SingleQuoted);
+                return;
+            }
+
+            auto scanned = plainline(p, true);
+            pushscalar(start, source.substr(p, scanned.end - p), YamlScalarStyle::Plain);
+            pos = scanned.stop;
+        }
+
+        /// Scans a plain scalar until the end of the line, a comment or a : indicator. In
+        /// flow context flow indicators also end the scalar.
+        PlainLine plainline(size_t p, bool flow) {
+            advance(p);
+
+            auto stop = source.size();
+
+            for(auto j = cursor; at(j) < source.size(); j++) {
+                auto q = at(j);
+                auto c = source[q];
+
+                if(
+                    c == '\n' ||
+                    (c == ':' && (isseparated(q + 1) || (flow && isflowindicator(q + 1)))) ||
+                    (c == '#' && q > p && isspace(q - 1)) ||
+                    (flow && (c == ',' || c == '[' || c == ']' || c == '{' || c == '}'))
+                ) {
+                    stop = q;
+                    break;
+                }
+            }
+
+            auto end = stop;
+            while(end > p && isspace(end - 1))
+                end--;
+
+            return {end, stop};
+        }
+
+        /**
+         * Continues a plain scalar in block context on the following lines that are more
+         * indented than the parent. Lines are folded: a single line break becomes a space
+         * and empty lines become line breaks.
+         * @param first The first line of the scalar starting at p
+         * @param after Set to the position after the scalar
+         */
+        std::string_view plainlines(size_t p, PlainLine first, std::ptrdiff_t parentindent, size_t &after) {
+            auto value = source.substr(p, first.end - p);
+            auto next  = first.stop;
+            auto empty = size_t{0};
+            auto folded = false;
+
+            after = first.stop;
+
+            while(next < source.size() && source[next] == '\n') {
+                auto s = next + 1;
+                auto r = skipspaces(s);
+
+                if(r < source.size() && source[r] == '\n') {
+                    empty++;
+                    next = r;
+                    continue;
+                }
+
+                auto indent = static_cast<std::ptrdiff_t>(r - s);
+
+                if(
+                    r >= source.size() || indent <= parentindent || source[r] == '#' ||
+                    (r == s && source.size() - r >= 3 && (source.substr(r, 3) == "---" || source.substr(r, 3) == "...") && isseparated(r + 3))
+                )
+                    break;
+
+                auto scanned = plainline(r, false);
+
+                if(source[scanned.stop] == ':' && scanned.stop < source.size())
+                    fail("Mapping values are not allowed in multi-line plain scalars", scanned.stop);
+
+                if(!folded) {
+                    scratch.assign(value);
+                    folded = true;
+                }
+
+                if(empty)
+                    scratch.append(empty, '\n');
+                else
+                    scratch += ' ';
+
+                scratch.append(source.substr(r, scanned.end - r));
+
+                empty = 0;
+                after = next = scanned.stop;
+            }
+
+            return folded ? std::string_view{scratch} : value;
+        }
+
+        /// Parses a quoted scalar starting at p, after is set to the position after the
+        /// closing quote.
+        std::string_view quoted(size_t p, size_t &after) {
+            auto doubled = source[p] == '"';
+
+            advance(p + 1);
+
+            auto j = cursor;
+            auto escapedquote = false;
+
+            while(true) {
+                auto q = at(j);
+
+                if(q >= source.size())
+                    fail(doubled ? "Unterminated double quoted scalar" : "Unterminated single quoted scalar", p);
+
+                if(source[q] == source[p]) {
+                    if(doubled || q + 1 >= source.size() || source[q + 1] != '\'')
+                        break;
+
+                    //'' is an escaped single quote
+                    escapedquote = true;
+                    j += 2;
+                    continue;
+                }
+
+                j++;
+            }
+
+            auto close = static_cast<size_t>(at(j));
+            auto raw   = source.substr(p + 1, close - p - 1);
+
+            after = close + 1;
+
+            auto special = doubled ? std::string_view{"\\\n"} : std::string_view{"\n"};
+            if(!escapedquote && raw.find_first_of(special) == std::string_view::npos)
+                return raw;
+
+            scratch.clear();
+
+            //length of the text that should not be trimmed by folding, such as escaped spaces
+            auto keep = size_t{0};
+
+            for(size_t i = 0; i < raw.size();) {
+                auto c = raw[i];
+
+                if(c == '\n') {
+                    while(scratch.size() > keep && (scratch.back() == ' ' || scratch.back() == '\t' || scratch.back() == '\r'))
+                        scratch.pop_back();
+
+                    auto breaks = size_t{0};
+
+                    while(i < raw.size() && raw[i] == '\n') {
+                        breaks++;
+                        i++;
+
+                        while(i < raw.size() && (raw[i] == ' ' || raw[i] == '\t' || raw[i] == '\r'))
+                            i++;
+                    }
+
+                    if(breaks == 1)
+                        scratch += ' ';
+                    else
+                        scratch.append(breaks - 1, '\n');
+                }
+                else if(!doubled && c == '\'') {
+                    scratch += '\'';
+                    i += 2;
+                }
+                else if(doubled && c == '\\') {
+                    i = escape(raw, i + 1, p + 1);
+                    keep = scratch.size();
+                }
+                else {
+                    scratch += c;
+                    i++;
+                }
+            }
+
+            return scratch;
+        }
+
+        /// Decodes the escape sequence that starts after the backslash at i, returns the
+        /// position after the sequence.
+        size_t escape(std::string_view raw, size_t i, size_t base) {
+            if(i >= raw.size())
+                fail("Invalid escape sequence", base + i);
+
+            auto c = raw[i];
+
+            //escaped line break joins lines without a space
+            if(c == '\n' || c == '\r') {
+                while(i < raw.size() && (raw[i] == '\n' || raw[i] == '\r'))
+                    i++;
+
+                while(i < raw.size() && (raw[i] == ' ' || raw[i] == '\t'))
+                    i++;
+
+                return i;
+            }
+
+            auto simple = [&](char32_t cp) {
+                char buffer[4];
+                scratch.append(buffer, UTF8Encode(cp, buffer));
+                return i + 1;
+            };
+
+            switch(c) {
+            case '0':  return simple(0);
+            case 'a':  return simple('\a');
+            case 'b':  return simple('\b');
+            case 't':
+            case '\t': return simple('\t');
+            case 'n':  return simple('\n');
+            case 'v':  return simple('\v');
+            case 'f':  return simple('\f');
+            case 'r':  return simple('\r');
+            case 'e':  return simple(0x1b);
+            case ' ':  return simple(' ');
+            case '"':  return simple('"');
+            case '/':  return simple('/');
+            case '\\': return simple('\\');
+            case 'N':  return simple(0x85);
+            case '_':  return simple(0xa0);
+            case 'L':  return simple(0x2028);
+            case 'P':  return simple(0x2029);
+            case 'x':
+            case 'u':
+            case 'U': {
+                auto digits = c == 'x' ? 2 : c == 'u' ? 4 : 8;
+                auto cp = char32_t{0};
+
+                for(int d = 1; d <= digits; d++) {
+                    auto h = i + static_cast<size_t>(d) < raw.size() ? HexValue(raw[i + static_cast<size_t>(d)]) : -1;
+                    if(h == -1)
+                        fail("Invalid escape sequence", base + i - 1);
+
+                    cp = (cp << 4) | static_cast<char32_t>(h);
+                }
+
+                char buffer[4];
+                scratch.append(buffer, UTF8Encode(cp, buffer));
+
+                return i + static_cast<size_t>(digits) + 1;
+            }
+            default:
+                fail("Invalid escape sequence", base + i - 1);
+            }
+        }
+
+        /// Parses a literal or folded block scalar, lines are found using memchr.
+        void blockscalar(size_t p, std::ptrdiff_t parentindent) {
+            auto start   = mark(p);
+            auto literal = source[p] == '|';
+            auto chomp   = char{0};
+            auto indent  = size_t{0};
+            auto i       = p + 1;
+
+            for(int k = 0; k < 2 && i < source.size(); k++) {
+                if(source[i] == '+' || source[i] == '-')
+                    chomp = source[i++];
+                else if(source[i] >= '1' && source[i] <= '9')
+                    indent = static_cast<size_t>(std::max<std::ptrdiff_t>(parentindent, 0)) + static_cast<size_t>(source[i++] - '0');
+            }
+
+            i = skipspaces(i);
+            if(i < source.size() && source[i] == '#')
+                i = lineend(i);
+
+            if(i < source.size() && source[i] != '\n')
+                fail("Invalid block scalar header", i);
+
+            scratch.clear();
+
+            auto s       = std::min(i + 1, source.size());
+            auto end     = s;
+            auto empty   = size_t{0};
+            auto started = false;
+            auto normal  = false;
+
+            while(s < source.size()) {
+                auto newline = static_cast<const char *>(std::memchr(source.data() + s, '\n', source.size() - s));
+                auto e = newline ? static_cast<size_t>(newline - source.data()) : source.size();
+
+                auto r = s;
+                while(r < e && source[r] == ' ')
+                    r++;
+
+                auto blank = r == e || (r + 1 == e && source[r] == '\r');
+
+                if(!blank) {
+                    auto column = r - s;
+
+                    if(
+                        (indent == 0 && static_cast<std::ptrdiff_t>(column) <= parentindent) ||
+                        (indent != 0 && column < indent) ||
+                        (column == 0 && e - s >= 3 && (source.substr(s, 3) == "---" || source.substr(s, 3) == "...") && isseparated(s + 3))
+                    )
+                        break;
+
+                    if(indent == 0)
+                        indent = column;
+
+                    auto textend = e > s && source[e - 1] == '\r' ? e - 1 : e;
+                    auto text = source.substr(s + indent, textend - s - indent);
+
+                    if(literal) {
+                        scratch.append(started ? empty + 1 : empty, '\n');
+                    }
+                    else {
+                        auto more = !text.empty() && (text.front() == ' ' || text.front() == '\t');
+
+                        if(!started)
+                            scratch.append(empty, '\n');
+                        else if(normal && !more)
+                            empty ? scratch.append(empty, '\n') : scratch.append(1, ' ');
+                        else
+                            scratch.append(empty + 1, '\n');
+
+                        normal = !more;
+                    }
+
+                    scratch.append(text);
+                    started = true;
+                    empty   = 0;
+                }
+                else {
+                    empty++;
+                }
+
+                end = newline ? e + 1 : source.size();
+                s   = end;
+            }
+
+            if(started && chomp == '+')
+                scratch.append(empty + 1, '\n');
+            else if(started && chomp != '-')
+                scratch += '\n';
+            else if(chomp == '+')
+                scratch.append(empty, '\n');
+
+            pushscalar(start, scratch, literal ? YamlScalarStyle::Literal : YamlScalarStyle::Folded);
+            pos = end;
+        }
+
+        std::string_view source;
+        YamlIndex index;
+
+        /// Index of the first structural character that is not passed
+        size_t cursor = 0;
+
+        /// Line of the cursor and the byte offset where it starts
+        size_t line      = 1;
+        size_t linestart = 0;
+
+        /// Offset of the source in the document
+        size_t baseoffset = 0;
+
+        /// Position where parsing continues
+        size_t pos = 0;
+
+        Phase phase = Phase::StreamStart;
+        bool compactroot = true;
+
+        /// Anchor of the next node and the line it is on
+        std::string_view anchor;
+        size_t anchorline = 0;
+
+        std::vector<Frame> stack;
+        std::vector<YamlEvent> pending;
+        size_t head = 0;
+
+        /// Buffer of scalars that are transformed while parsing
+        std::string scratch;
+    };
+
+    /// Range of a document in a YAML stream, see SplitYamlDocuments.
+    struct YamlDocumentRange {
+        size_t begin;
+        size_t end;
+
+        /// Line number of the beginning of the range
+        size_t line;
+    };
+
+    /**
+     * @brief Finds the ranges of the documents in a YAML stream without parsing them.
+     * Stream is split before each --- marker and after each ... marker at the start of a
+     * line. The structural index is used to skip over quoted scalars, thus markers within
+     * multi-line quoted scalars do not split the stream. Block scalars are tracked so that
+     * quotes in their contents are not mistaken for the start of a quoted scalar. Ranges
+     * that only contain comments, directives or white space are skipped, directives are
+     * included in the range of the following document. Each range can be parsed separately
+     * with a parser that starts at the line and offset of the range.
+     */
+    inline std::vector<YamlDocumentRange> SplitYamlDocuments(std::string_view source) {
+        auto documents = std::vector<YamlDocumentRange>{};
+        auto size = source.size();
+
+        auto index = YamlIndex{};
+        index.Reset(source);
+
+        //number of the next structural position and the line it is on
+        auto j = size_t{0};
+        auto line = size_t{1};
+
+        auto seek = [&](size_t p) {
+            while(index.At(j, j) < p) {
+                if(source[index.At(j, j)] == '\n')
+                    line++;
+
+                j++;
+            }
+        };
+
+        auto lineend = [&](size_t p) {
+            seek(p);
+
+            auto k = j;
+            while(index.At(k, j) < size && source[index.At(k, j)] != '\n')
+                k++;
+
+            return index.At(k, j);
+        };
+
+        auto isspace = [&](size_t p) {
+            return p < size && (source[p] == ' ' || source[p] == '\t' || source[p] == '\r');
+        };
+
+        auto isseparated = [&](size_t p) {
+            return p >= size || isspace(p) || source[p] == '\n';
+        };
+
+        auto ismarker = [&](size_t p, char c) {
+            return
+                size - p >= 3 && source[p] == c && source[p + 1] == c && source[p + 2] == c &&
+                isseparated(p + 3);
+        };
+
+        //position after the closing quote of the quoted scalar starting at p
+        auto closequote = [&](size_t p) {
+            seek(p + 1);
+
+            while(true) {
+                auto q = index.At(j, j);
+
+                if(q >= size)
+                    return size;
+
+                if(source[q] == source[p]) {
+                    if(source[p] == '\'' && q + 1 < size && source[q + 1] == '\'') {
+                        seek(q + 2);
+                        continue;
+                    }
+
+                    return q + 1;
+                }
+
+                seek(q + 1);
+            }
+        };
+
+        auto begin     = size_t{0};
+        auto beginline = size_t{1};
+        auto content   = false;
+
+        //start of the directives before the next document
+        auto directive     = size;
+        auto directiveline = size_t{0};
+
+        auto opendocument = [&](size_t s) {
+            begin     = directive < size ? directive : s;
+            beginline = directive < size ? directiveline : line;
+            content   = true;
+            directive = size;
+        };
+
+        auto closedocument = [&](size_t end) {
+            if(content)
+                documents.push_back({begin, end, beginline});
+
+            content = false;
+        };
+
+        auto flow    = 0;
+        auto inblock = false;
+        auto blockparent = std::ptrdiff_t{-1};
+
+        for(size_t s = 0; s < size;) {
+            seek(s);
+
+            auto r = s;
+            while(r < size && source[r] == ' ')
+                r++;
+
+            auto indent = static_cast<std::ptrdiff_t>(r - s);
+            auto blank  = r >= size || source[r] == '\n' || (source[r] == '\r' && (r + 1 >= size || source[r + 1] == '\n'));
+            auto marker = ismarker(s, '-') || ismarker(s, '.');
+
+            if(inblock) {
+                if(!marker && (blank || indent > blockparent)) {
+                    s = lineend(s) + 1;
+                    continue;
+                }
+
+                inblock = false;
+            }
+
+            auto p = r;
+            auto start = true;
+            auto headerline = false;
+
+            if(ismarker(s, '-')) {
+                closedocument(s);
+                opendocument(s);
+
+                headerline = true;
+                flow       = 0;
+                p = s + 3;
+            }
+            else if(ismarker(s, '.')) {
+                auto end = lineend(s);
+                end = end < size ? end + 1 : end;
+
+                closedocument(end);
+
+                flow = 0;
+                s = end;
+                continue;
+            }
+            else if(!content && source[s] == '%') {
+                if(directive == size) {
+                    directive     = s;
+                    directiveline = line;
+                }
+
+                s = lineend(s) + 1;
+                continue;
+            }
+
+            //scans the rest of the line
+            while(true) {
+                while(isspace(p))
+                    p++;
+
+                if(p >= size || source[p] == '\n')
+                    break;
+
+                auto c = source[p];
+
+                if(c == '#') {
+                    p = lineend(p);
+                    break;
+                }
+
+                if(!content)
+                    opendocument(s);
+
+                if(start) {
+                    if((c == '-' || c == '?' || c == ':') && isseparated(p + 1)) {
+                        p++;
+                        continue;
+                    }
+
+                    if(c == '\'' || c == '"') {
+                        p = closequote(p);
+                        start = false;
+                        continue;
+                    }
+
+                    if((c == '|' || c == '>') && flow == 0) {
+                        inblock = true;
+                        blockparent = headerline || p == r ? -1 : indent;
+                        p = lineend(p);
+                        break;
+                    }
+
+                    if(c == '[' || c == '{') {
+                        flow++;
+                        p++;
+                        continue;
+                    }
+
+                    if(c == '&' || c == '!') {
+                        while(!isseparated(p) && !(flow && (source[p] == ',' || source[p] == '[' || source[p] == ']' || source[p] == '{' || source[p] == '}')))
+                            p++;
+
+                        continue;
+                    }
+                }
+
+                if(flow && (c == ',' || c == ']' || c == '}')) {
+                    if(c != ',')
+                        flow--;
+
+                    start = c == ',';
+                    p++;
+                    continue;
+                }
+
+                //plain scalar, continues until the next indicator on this line
+                start = false;
+                seek(p);
+
+                auto q = index.At(j, j);
+                auto d = q < size ? source[q] : '\n';
+
+                if(d == '\n') {
+                    p = q;
+                    break;
+                }
+
+                if(d == ':' && (isseparated(q + 1) || (flow && (source[q + 1] == ',' || source[q + 1] == ']' || source[q + 1] == '}')))) {
+                    p = q + 1;
+                    start = true;
+                }
+                else if(d == '#' && isspace(q - 1)) {
+                    p = q;
+                }
+                else if(flow && (d == ',' || d == '[' || d == ']' || d == '{' || d == '}')) {
+                    p = q;
+
+                    if(d == '[' || d == '{') {
+                        flow++;
+                        p++;
+                        start = true;
+                    }
+                }
+                else {
+                    p = q + 1;
+                }
+            }
+
+            s = p + 1;
+        }
+
+        closedocument(size);
+
+        return documents;
+    }
+
+    /**
+     * @brief Limits of the alias expansion of a YAML document.
+     * Aliases share the anchored node, thus they cost little to parse, however a document
+     * can expand to an exponential number of nodes when it is traversed, such as with the
+     * billion laughs attack. Each alias is charged with the number of nodes and scalar
+     * bytes of the node it refers to, including the aliases in that node. 0 disables a
+     * limit.
+     */
+    struct YamlBudget {
+        size_t nodes = size_t{1} << 20;
+        size_t bytes = size_t{1} << 26;
+    };
+
+    /// Size of a YAML document or a part of it after aliases are expanded.
+    struct YamlExpansion {
+        size_t nodes = 0;
+        size_t bytes = 0;
+
+        YamlExpansion operator-(const YamlExpansion &other) const {
+            return {nodes - other.nodes, bytes - other.bytes};
+        }
+    };
+
+    /// Charges an alias to the budget, see YamlBudget.
+    inline void ChargeYamlAlias(YamlExpansion &used, const YamlExpansion &size, const YamlBudget &budget, const YamlEvent &event) {
+        used.nodes += size.nodes;
+        used.bytes += size.bytes;
+
+        if((budget.nodes && used.nodes > budget.nodes) || (budget.bytes && used.bytes > budget.bytes)) {
+            throw std::runtime_error(
+                "Aliases expand beyond the budget of the document on line " + std::to_string(event.line) +
+                ", character " + std::to_string(event.character)
+            );
+        }
+    }
+
+    /**
+     * @brief Builds a single YAML document from the events of the parser into the target.
+     * Mappings become maps, sequences become sequences and scalars are converted by the
+     * data parser. Key locations are recorded in the map that contains the key and node
+     * locations are stored in their data. An empty source results in an empty string.
+     * Anchored nodes are built into shared data, the node and its aliases share it, see
+     * Data::SetShared, thus memory and time do not depend on the number of aliases. Merge
+     * keys (<<) add the keys of the merged mappings that the mapping does not have, the
+     * values share the values of the merged mappings.
+     * @tparam duplicatekeys_ Mixed time option to allow duplicate keys, the last value
+     *         is kept.
+     * @param settings Mixed time settings containing the duplicate keys option.
+     * @param resource Resource name that is stored in the locations.
+     * @param budget Limits of the alias expansion.
+     * @throws std::runtime_error if the source is not valid YAML, contains more than one
+     *         document, has duplicate keys while they are not allowed, refers to an
+     *         unknown anchor or its aliases exceed the budget.
+     */
+    template<YesNoRuntime duplicatekeys_, DataConcept DataType>
+    void BuildYaml(
+        YamlParser &parser, DataType &target, const std::array<bool, 1> &settings,
+        const std::optional<std::string> &resource, const YamlBudget &budget = {}
+    ) {
+        using DataTraits   = DataType::DataTraits;
+        using LocationType = DataTraits::LocationType;
+        using KeyType      = DataTraits::KeyType;
+        using ParserType   = DataTraits::DataParserType;
+
+        //mixed time options
+        const bool duplicatekeys = GetMixedTimeOption<duplicatekeys_, 0>(settings);
+
+        struct Merge {
+            std::shared_ptr<DataType> data;
+            size_t line;
+            size_t character;
+        };
+
+        struct Level {
+            DataType *data;
+            bool map;
+            bool haskey;
+            KeyType key;
+            LocationType keylocation;
+
+            /// Line and character of the key for error messages
+            size_t keyline;
+            size_t keychar;
+
+            /// Anchor of the collection, its shared data and the size of the document
+            /// before the collection
+            std::string_view anchor;
+            std::shared_ptr<DataType> shared;
+            YamlExpansion start;
+
+            /// Current key is a merge key and the values of the merge keys
+            bool merging;
+            std::vector<Merge> merges;
+        };
+
+        struct Anchor {
+            std::shared_ptr<const DataType> data;
+            YamlExpansion size;
+        };
+
+        auto makelocation = [&](const YamlEvent &event) {
+            auto location = LocationType{event.offset, event.line, event.character};
+
+            if constexpr(LocationType::HasResourceName())
+                location.ResourceName = resource;
+
+            return location;
+        };
+
+        auto converter = ParserType{};
+        auto stack = std::vector<Level>{};
+        auto anchors = std::unordered_map<std::string_view, Anchor>{};
+        auto documents = size_t{0};
+        auto event = YamlEvent{};
+
+        //size of the document with aliases expanded and the part charged to aliases
+        auto size = YamlExpansion{};
+        auto aliased = YamlExpansion{};
+
+        target.SetData(KeyType{});
+
+        //returns the data that the next node is stored into
+        auto place = [&]() -> DataType & {
+            if(stack.empty())
+                return target;
+
+            auto &top = stack.back();
+
+            if(!top.map)
+                return top.data->GetSequence().emplace_back();
+
+            top.haskey = false;
+
+            if(top.merging) {
+                top.merging = false;
+                top.merges.push_back({std::make_shared<DataType>(target.get_allocator()), top.keyline, top.keychar});
+
+                return *top.merges.back().data;
+            }
+
+            auto [it, inserted] = top.data->GetMap().try_emplace(std::move(top.key));
+
+            if(!inserted && !duplicatekeys) {
+                throw std::runtime_error(
+                    "Duplicate key '" + std::string(it->first) + "' on line " +
+                    std::to_string(top.keyline) + ", character " + std::to_string(top.keychar)
+                );
+            }
+
+            top.data->SetKeyLocation(it->first, std::move(top.keylocation));
+
+            return it->second;
+        };
+
+        //anchored nodes are built into shared data that the node refers to
+        auto share = [&](DataType &node) -> std::shared_ptr<DataType> {
+            if(event.anchor.empty())
+                return nullptr;
+
+            auto shared = std::make_shared<DataType>(target.get_allocator());
+            node.SetShared(shared);
+            node.SetLocation(makelocation(event));
+
+            return shared;
+        };
+
+        //adds the keys of a merged mapping that the mapping does not have
+        auto mergemap = [&](Level &level, const std::shared_ptr<const DataType> &owner, const DataType &source) {
+            auto &map = level.data->GetMap();
+
+            for(const auto &[key, child] : source.GetMap()) {
+                if(map.find(key) != map.end())
+                    continue;
+
+                auto &value = map[key];
+                value.SetShared(std::shared_ptr<const DataType>(owner, &child));
+                value.SetLocation(child.GetLocation());
+
+                if(auto location = source.GetKeyLocation(key))
+                    level.data->SetKeyLocation(key, *location);
+            }
+        };
+
+        //merges are applied in order after the keys of the mapping, thus the keys of the
+        //mapping and the earlier merges take precedence
+        auto merge = [&](Level &level) {
+            for(auto &[data, line, character] : level.merges) {
+                auto &source = data->Resolve();
+
+                if(source.IsMap()) {
+                    mergemap(level, data, source);
+                    continue;
+                }
+
+                auto valid = source.IsSequence();
+
+                if(valid) {
+                    for(const auto &item : source.GetSequence()) {
+                        auto &entry = item.Resolve();
+                        valid = valid && entry.IsMap();
+
+                        if(valid)
+                            mergemap(level, std::shared_ptr<const DataType>(data, &item), entry);
+                    }
+                }
+
+                if(!valid) {
+                    throw std::runtime_error(
+                        "Merge key should have a mapping or a sequence of mappings on line " +
+                        std::to_string(line) + ", character " + std::to_string(character)
+                    );
+                }
+            }
+        };
+
+        while(parser.Next(event)) {
+            switch(event.type) {
+            case YamlEventType::DocumentStart:
+                if(documents++)
+                    throw std::runtime_error("Source contains more than one document on line " + std::to_string(event.line));
+                break;
+
+            case YamlEventType::MappingStart:
+            case YamlEventType::SequenceStart: {
+                auto &placed = place();
+                auto shared = share(placed);
+                auto &node = shared ? *shared : placed;
+                auto map = event.type == YamlEventType::MappingStart;
+
+                if(map)
+                    node.EmplaceMap();
+                else
+                    node.EmplaceSequence();
+
+                node.SetLocation(makelocation(event));
+                stack.push_back({&node, map, false, {}, {}, 0, 0, event.anchor, std::move(shared), size, false, {}});
+                size.nodes++;
+                break;
+            }
+
+            case YamlEventType::MappingEnd:
+            case YamlEventType::SequenceEnd: {
+                auto &top = stack.back();
+
+                if(!top.merges.empty())
+                    merge(top);
+
+                if(top.shared)
+                    anchors[top.anchor] = {std::move(top.shared), size - top.start};
+
+                stack.pop_back();
+                break;
+            }
+
+            case YamlEventType::Scalar: {
+                size.bytes += event.value.size();
+
+                if(!stack.empty() && stack.back().map && !stack.back().haskey) {
+                    auto &top = stack.back();
+                    top.merging = event.value == "<<" && event.style == YamlScalarStyle::Plain;
+                    top.key = KeyType(event.value);
+                    top.keylocation = makelocation(event);
+                    top.keyline = event.line;
+                    top.keychar = event.character;
+                    top.haskey = true;
+                    break;
+                }
+
+                auto &placed = place();
+                auto shared = share(placed);
+                auto &node = shared ? *shared : placed;
+                auto context = Context<LocationType>{makelocation(event), {}};
+
+                if constexpr(InPlaceDataParserConcept<ParserType, LocationType, DataType>) {
+                    converter(context, event.value, node);
+                }
+                else {
+                    auto [location, data] = converter(context, event.value);
+                    node.SetData(std::move(data));
+                    node.SetLocation(std::move(location));
+                }
+
+                size.nodes++;
+
+                if(shared)
+                    anchors[event.anchor] = {std::move(shared), {1, event.value.size()}};
+                break;
+            }
+
+            case YamlEventType::Alias: {
+                auto it = anchors.find(event.value);
+
+                if(it == anchors.end()) {
+                    throw std::runtime_error(
+                        "Unknown anchor '" + std::string(event.value) + "' on line " +
+                        std::to_string(event.line) + ", character " + std::to_string(event.character)
+                    );
+                }
+
+                auto &[data, expansion] = it->second;
+
+                ChargeYamlAlias(aliased, expansion, budget, event);
+                size.nodes += expansion.nodes;
+                size.bytes += expansion.bytes;
+
+                auto &node = place();
+                node.SetShared(data);
+                node.SetLocation(makelocation(event));
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+    }
+
+    /// Parses a single YAML document from the reader into the target, see BuildYaml.
+    template<YesNoRuntime duplicatekeys_, SourceConcept SourceType, DataConcept DataType>
+    void ParseYaml(SourceType &reader, DataType &target, const std::array<bool, 1> &settings, const YamlBudget &budget = {}) {
+        auto raw = reader.Read(std::numeric_limits<size_t>::max());
+        auto parser = YamlParser(std::string_view{raw});
+
+        BuildYaml<duplicatekeys_>(parser, target, settings, reader.GetResourceName(), budget);
+    }
+
+    /**
+     * @brief Builds a single YAML document from the events of the parser into the tape.
+     * Scalars are stored as strings and node locations are stored in the tape. An empty
+     * source results in an empty string. Aliases copy the anchored node, thus their
+     * expansion is limited by the budget. Values of merge keys (<<) are built into
+     * separate tapes unless they are aliases, the keys that the mapping does not have are
+     * copied from them when the mapping ends.
+     * @tparam duplicatekeys_ Mixed time option to allow duplicate keys, tapes keep every
+     *         value and Find returns the last one.
+     * @param settings Mixed time settings containing the duplicate keys option.
+     * @param resource Resource name that is stored in the locations.
+     * @param budget Limits of the alias expansion.
+     * @throws std::runtime_error see BuildYaml.
+     */
+    template<YesNoRuntime duplicatekeys_, LocationConcept LocationType>
+    void BuildYamlTape(
+        YamlParser &parser, Tape<LocationType> &target, const std::array<bool, 1> &settings,
+        const std::optional<std::string> &resource, const YamlBudget &budget = {}
+    ) {
+        using TapeType = Tape<LocationType>;
+        using Cursor   = TapeCursor<LocationType>;
+
+        //mixed time options
+        const bool duplicatekeys = GetMixedTimeOption<duplicatekeys_, 0>(settings);
+
+        struct Merge {
+            Cursor node;
+            size_t line;
+            size_t character;
+        };
+
+        struct Level {
+            TapeType *tape;
+            std::uint32_t index;
+            bool map;
+            bool haskey;
+
+            /// Line and character of the collection for error messages
+            size_t line;
+            size_t character;
+
+            /// Anchor of the collection and the size of the document before the collection
+            std::string_view anchor;
+            YamlExpansion start;
+
+            /// Collection is the value of a merge key of its parent
+            bool mergevalue;
+
+            /// Current key is a merge key and the values of the merge keys
+            bool merging;
+            size_t mergeline;
+            size_t mergechar;
+            std::vector<Merge> merges;
+        };
+
+        struct Anchor {
+            Cursor node;
+            YamlExpansion size;
+        };
+
+        auto makelocation = [&](const YamlEvent &event) {
+            auto location = LocationType{event.offset, event.line, event.character};
+
+            if constexpr(LocationType::HasResourceName())
+                location.ResourceName = resource;
+
+            return location;
+        };
+
+        //values of merge keys, deque keeps the cursors to them valid
+        auto scratch = std::deque<TapeType>{};
+        auto stack = std::vector<Level>{};
+        auto anchors = std::unordered_map<std::string_view, Anchor>{};
+        auto documents = size_t{0};
+        auto event = YamlEvent{};
+
+        //size of the document with aliases expanded and the part charged to aliases
+        auto size = YamlExpansion{};
+        auto aliased = YamlExpansion{};
+
+        target.Clear();
+
+        //checks if the next node is the value of a merge key
+        auto merging = [&] {
+            return !stack.empty() && stack.back().merging;
+        };
+
+        //returns the tape that the next node is added to, values of merge keys start a
+        //tape of their own
+        auto place = [&]() -> TapeType & {
+            if(stack.empty())
+                return target;
+
+            auto &top = stack.back();
+            top.haskey = false;
+
+            if(top.merging)
+                return scratch.emplace_back();
+
+            return *top.tape;
+        };
+
+        //records a node placed by place as the value of the merge key of the top level
+        auto addmerge = [&](Cursor node) {
+            auto &top = stack.back();
+
+            top.merges.push_back({node, top.mergeline, top.mergechar});
+            top.merging = false;
+        };
+
+        //copies the keys of a merged mapping that the mapping does not have
+        auto mergemap = [&](TapeType &tape, std::unordered_set<std::string> &keys, Cursor source) {
+            for(auto child : source) {
+                if(!keys.emplace(child.GetKey()).second)
+                    continue;
+
+                tape.Key(child.GetKey());
+                tape.Copy(child, child.GetLocation());
+            }
+        };
+
+        //merges are applied in order after the keys of the mapping, thus the keys of the
+        //mapping and the earlier merges take precedence
+        auto merge = [&](Level &level) {
+            auto &tape = *level.tape;
+            auto keys = std::unordered_set<std::string>{};
+
+            //mapping is not ended yet, thus its children are counted instead of iterated
+            //to its end
+            auto mapping = Cursor{&tape, level.index};
+            auto child = mapping.begin();
+            for(size_t i = 0; i < mapping.size(); i++, ++child)
+                keys.emplace((*child).GetKey());
+
+            for(auto &[node, line, character] : level.merges) {
+                if(node.IsMap()) {
+                    mergemap(tape, keys, node);
+                    continue;
+                }
+
+                auto valid = node.IsSequence();
+
+                if(valid) {
+                    for(auto item : node) {
+                        valid = valid && item.IsMap();
+
+                        if(valid)
+                            mergemap(tape, keys, item);
+                    }
+                }
+
+                if(!valid) {
+                    throw std::runtime_error(
+                        "Merge key should have a mapping or a sequence of mappings on line " +
+                        std::to_string(line) + ", character " + std::to_string(character)
+                    );
+                }
+            }
+        };
+
+        while(parser.Next(event)) {
+            switch(event.type) {
+            case YamlEventType::DocumentStart:
+                if(documents++)
+                    throw std::runtime_error("Source contains more than one document on line " + std::to_string(event.line));
+                break;
+
+            case YamlEventType::MappingStart:
+            case YamlEventType::SequenceStart: {
+                auto mergevalue = merging();
+                auto &tape = place();
+                auto map = event.type == YamlEventType::MappingStart;
+                auto index = static_cast<std::uint32_t>(tape.GetNodeCount());
+
+                if(map)
+                    tape.BeginMap(makelocation(event));
+                else
+                    tape.BeginSequence(makelocation(event));
+
+                stack.push_back({
+                    &tape, index, map, false, event.line, event.character, event.anchor, size,
+                    mergevalue, false, 0, 0, {}
+                });
+                size.nodes++;
+                break;
+            }
+
+            case YamlEventType::MappingEnd:
+            case YamlEventType::SequenceEnd: {
+                auto &top = stack.back();
+                auto &tape = *top.tape;
+                auto node = Cursor{&tape, top.index};
+
+                if(!top.merges.empty())
+                    merge(top);
+
+                tape.End();
+
+                if(!duplicatekeys) {
+                    if(auto key = node.FindDuplicateKey()) {
+                        throw std::runtime_error(
+                            "Duplicate key '" + std::string(*key) + "' in the mapping on line " +
+                            std::to_string(top.line) + ", character " + std::to_string(top.character)
+                        );
+                    }
+                }
+
+                if(!top.anchor.empty())
+                    anchors.insert_or_assign(top.anchor, Anchor{node, size - top.start});
+
+                auto mergevalue = top.mergevalue;
+                stack.pop_back();
+
+                if(mergevalue)
+                    addmerge(node);
+                break;
+            }
+
+            case YamlEventType::Scalar: {
+                size.bytes += event.value.size();
+
+                if(!stack.empty() && stack.back().map && !stack.back().haskey) {
+                    auto &top = stack.back();
+                    top.merging = event.value == "<<" && event.style == YamlScalarStyle::Plain;
+                    top.mergeline = event.line;
+                    top.mergechar = event.character;
+                    top.haskey = true;
+
+                    if(!top.merging)
+                        top.tape->Key(event.value);
+                    break;
+                }
+
+                auto mergevalue = merging();
+                auto &tape = place();
+                auto node = Cursor{&tape, static_cast<std::uint32_t>(tape.GetNodeCount())};
+
+                tape.Value(event.value, makelocation(event));
+                size.nodes++;
+
+                if(!event.anchor.empty())
+                    anchors.insert_or_assign(event.anchor, Anchor{node, {1, event.value.size()}});
+
+                if(mergevalue)
+                    addmerge(node);
+                break;
+            }
+
+            case YamlEventType::Alias: {
+                auto it = anchors.find(event.value);
+
+                if(it == anchors.end()) {
+                    throw std::runtime_error(
+                        "Unknown anchor '" + std::string(event.value) + "' on line " +
+                        std::to_string(event.line) + ", character " + std::to_string(event.character)
+                    );
+                }
+
+                auto &[node, expansion] = it->second;
+
+                ChargeYamlAlias(aliased, expansion, budget, event);
+                size.nodes += expansion.nodes;
+                size.bytes += expansion.bytes;
+
+                //merged aliases are read in place
+                if(merging()) {
+                    stack.back().haskey = false;
+                    addmerge(node);
+                    break;
+                }
+
+                place().Copy(node, makelocation(event));
+                break;
+            }
+
+            default:
+                break;
+            }
+        }
+
+        if(target.IsEmpty())
+            target.Value({});
+    }
+
+    /// Parses a single YAML document from the reader into the tape, see BuildYamlTape.
+    template<YesNoRuntime duplicatekeys_, SourceConcept SourceType, LocationConcept LocationType>
+    void ParseYamlTape(SourceType &reader, Tape<LocationType> &target, const std::array<bool, 1> &settings, const YamlBudget &budget = {}) {
+        auto raw = reader.Read(std::numeric_limits<size_t>::max());
+        auto parser = YamlParser(std::string_view{raw});
+
+        BuildYamlTape<duplicatekeys_>(parser, target, settings, reader.GetResourceName(), budget);
+    }
+
+    /**
+     * @brief Parses each document of a YAML stream concurrently.
+     * Stream is split using SplitYamlDocuments and the documents are distributed among
+     * the workers, see RunWorkers. Each document is parsed by its own parser starting at
+     * the line and offset of the document, thus locations are the same as a sequential
+     * parse would produce. Errors are stored in the result of the document.
+     * @param budget Limits of the alias expansion of each document.
+     * @param prepare Called with the number of documents before parsing starts.
+     * @param store Called from the worker threads with the index and the result of each
+     *        document as it is completed.
+     */
+    template<YesNoRuntime duplicatekeys_, DataConcept DataType, SourceConcept SourceType, class P_, class F_>
+    void ParseYamlDocuments(
+        SourceType &reader, const std::array<bool, 1> &settings, const YamlBudget &budget,
+        size_t threads, P_ &&prepare, F_ &&store
+    ) {
+        auto raw = reader.Read(std::numeric_limits<size_t>::max());
+        auto resource = reader.GetResourceName();
+        auto source = std::string_view{raw};
+
+        auto ranges = SplitYamlDocuments(source);
+        prepare(ranges.size());
+
+        RunWorkers(ranges.size(), threads, [&](size_t id, WorkStealingScheduler &scheduler) {
+            while(auto index = scheduler.Next(id)) {
+                auto &range = ranges[*index];
+                auto result = BatchResult<DataType>{};
+
+                try {
+                    auto parser = YamlParser(source.substr(range.begin, range.end - range.begin), range.line, range.begin);
+                    BuildYaml<duplicatekeys_>(parser, result.data, settings, resource, budget);
+                }
+                catch(...) {
+                    result.error = std::current_exception();
+                }
+
+                store(*index, std::move(result));
+            }
+        });
+    }
+
+    /**
+     * @brief Loads a YAML document directly into a structure from the events of a parser.
+     * No data nodes are built: scalars are converted into the members they are stored in
+     * and mapping keys are matched to fields using the perfect hash of the field table of
+     * the structure, see FieldTable. Structures are loaded from mappings, containers with
+     * emplace_back from sequences, map containers with string keys from mappings, and
+     * strings, booleans and numbers from scalars. Booleans and numbers follow the core
+     * schema, thus they are read from plain scalars only and quoted scalars are strings.
+     * A null scalar resets optionals and leaves structures and containers unchanged.
+     * Fields that are not present in the document keep their values. Keys that do not
+     * correspond to a field are recorded with their locations and their values are
+     * skipped. Recursion depth depends on the nesting of the types, not on the document.
+     * Events of anchored nodes are recorded and aliases are loaded by replaying them, thus
+     * only anchored nodes are kept in memory. Merge keys (<<) load the keys of the merged
+     * mappings that are not in the mapping itself.
+     * @tparam duplicatekeys_ Mixed time option to allow duplicate keys, the last value
+     *         is kept.
+     */
+    template<YesNoRuntime duplicatekeys_, LocationConcept LocationType>
+    class YamlStructLoader {
+    public:
+        /**
+         * @param settings Mixed time settings containing the duplicate keys option.
+         * @param budget Limits of the alias expansion.
+         * @param resource Resource name that is stored in the locations.
+         * @param unknown Keys that do not correspond to a field are added to this list.
+         */
+        YamlStructLoader(
+            YamlParser &parser_, const std::array<bool, 1> &settings, const YamlBudget &budget_,
+            const std::optional<std::string> &resource_, std::vector<UnknownKey<LocationType>> &unknown_
+        ) :
+            parser(parser_), budget(budget_), resource(resource_), unknown(unknown_),
+            duplicatekeys(GetMixedTimeOption<duplicatekeys_, 0>(settings))
+        { }
+
+        /**
+         * @brief Loads the single document of the stream into the target.
+         * @throws std::runtime_error if the source is not valid YAML, contains more than one
+         *         document, a node does not match the type it is loaded into, has duplicate
+         *         keys while they are not allowed, refers to an unknown anchor or its
+         *         aliases exceed the budget.
+         */
+        template<class T_>
+        void Load(T_ &target) {
+            auto documents = size_t{0};
+
+            while(read(true)) {
+                switch(event.type) {
+                case YamlEventType::DocumentStart:
+                    if(documents++)
+                        throw std::runtime_error("Source contains more than one document on line " + std::to_string(event.line));
+                    break;
+
+                case YamlEventType::MappingStart:
+                case YamlEventType::SequenceStart:
+                case YamlEventType::Scalar:
+                    value(target);
+                    break;
+
+                default:
+                    break;
+                }
+            }
+        }
+
+    private:
+        /// Loads the node that starts with the current event, current event is the last
+        /// event of the node afterwards.
+        template<class T_>
+        void value(T_ &target) {
+            if constexpr(FieldDescribedConcept<T_>) {
+                constexpr auto count = std::remove_cvref_t<decltype(StructFields<T_>)>::Size;
+
+                if(isnull())
+                    return;
+
+                expect(YamlEventType::MappingStart, "a mapping");
+
+                //fields that are loaded from the mapping itself or from a merged mapping
+                auto state = std::array<Origin, count>{};
+                fields(target, state, Origin::Explicit);
+            }
+            else if constexpr(IsInstantiationV<T_, std::optional>) {
+                if(isnull())
+                    target.reset();
+                else
+                    value(target.emplace());
+            }
+            else if constexpr(std::is_same_v<T_, bool>) {
+                expectplain("a boolean");
+
+                auto scalar = event.value;
+
+                if(scalar == "true" || scalar == "True" || scalar == "TRUE")
+                    target = true;
+                else if(scalar == "false" || scalar == "False" || scalar == "FALSE")
+                    target = false;
+                else
+                    invalid("boolean");
+            }
+            else if constexpr(std::is_arithmetic_v<T_>) {
+                expectplain("a number");
+                number(target);
+            }
+            else if constexpr(std::is_assignable_v<T_ &, std::string_view>) {
+                expect(YamlEventType::Scalar, "a scalar");
+                target = event.value;
+            }
+            else if constexpr(requires { target.try_emplace(typename T_::key_type(std::string_view{})); }) {
+                if(isnull())
+                    return;
+
+                expect(YamlEventType::MappingStart, "a mapping");
+                target.clear();
+
+                //keys that are loaded from merged mappings
+                auto merged = std::vector<typename T_::key_type>{};
+                entries(target, merged, Origin::Explicit);
+            }
+            else if constexpr(requires { target.emplace_back(); target.clear(); }) {
+                if(isnull())
+                    return;
+
+                expect(YamlEventType::SequenceStart, "a sequence");
+                target.clear();
+
+                while(next().type != YamlEventType::SequenceEnd)
+                    value(target.emplace_back());
+            }
+            else {
+                static_assert(sizeof(T_) == 0, "Type cannot be loaded from YAML, describe it with a field table");
+            }
+        }
+
+        /// Source of a field or an entry
+        enum class Origin : std::uint8_t {
+            None,
+            Merged,
+            Explicit
+        };
+
+        /// Loads the fields of a structure from the mapping that starts with the current
+        /// event. Merged values do not replace the values that are already loaded, explicit
+        /// values replace merged ones.
+        template<class T_, class S_>
+        void fields(T_ &target, S_ &state, Origin origin) {
+            constexpr auto &table = StructFields<T_>;
+
+            while(next().type != YamlEventType::MappingEnd) {
+                if(ismergekey()) {
+                    next();
+                    merge([&] { fields(target, state, Origin::Merged); });
+                    continue;
+                }
+
+                auto index = table.Find(event.value);
+
+                if(index == table.Size) {
+                    unknownkey();
+                    next();
+                    skip();
+                    continue;
+                }
+
+                if(origin == Origin::Merged && state[index] != Origin::None) {
+                    next();
+                    skip();
+                    continue;
+                }
+
+                if(state[index] == Origin::Explicit && !duplicatekeys)
+                    duplicate(event.value);
+
+                state[index] = origin;
+                next();
+
+                table.Visit(index, [&](const auto &field) {
+                    value(target.*field.Pointer);
+                });
+            }
+        }
+
+        /// Loads the entries of a map container, see fields.
+        template<class T_>
+        void entries(T_ &target, std::vector<typename T_::key_type> &merged, Origin origin) {
+            while(next().type != YamlEventType::MappingEnd) {
+                if(ismergekey()) {
+                    next();
+                    merge([&] { entries(target, merged, Origin::Merged); });
+                    continue;
+                }
+
+                auto [it, inserted] = target.try_emplace(typename T_::key_type(event.value));
+
+                if(!inserted) {
+                    auto previous = std::find(merged.begin(), merged.end(), it->first);
+
+                    if(origin == Origin::Merged) {
+                        next();
+                        skip();
+                        continue;
+                    }
+
+                    if(previous != merged.end())
+                        merged.erase(previous);
+                    else if(!duplicatekeys)
+                        duplicate(event.value);
+                }
+                else if(origin == Origin::Merged) {
+                    merged.push_back(it->first);
+                }
+
+                next();
+                value(it->second);
+            }
+        }
+
+        /// Calls load for the mapping or for each mapping of the sequence that is the value
+        /// of a merge key.
+        template<class F_>
+        void merge(F_ &&load) {
+            if(event.type == YamlEventType::MappingStart) {
+                load();
+                return;
+            }
+
+            expect(YamlEventType::SequenceStart, "a mapping or a sequence of mappings to merge");
+
+            while(next().type != YamlEventType::SequenceEnd) {
+                expect(YamlEventType::MappingStart, "a mapping to merge");
+                load();
+            }
+        }
+
+        template<class T_>
+        void number(T_ &target) {
+            auto digits = event.value;
+            auto base = 10;
+
+            if constexpr(std::is_floating_point_v<T_>) {
+                if(digits == ".inf" || digits == ".Inf" || digits == ".INF" || digits == "+.inf" || digits == "+.Inf" || digits == "+.INF") {
+                    target = std::numeric_limits<T_>::infinity();
+                    return;
+                }
+
+                if(digits == "-.inf" || digits == "-.Inf" || digits == "-.INF") {
+                    target = -std::numeric_limits<T_>::infinity();
+                    return;
+                }
+
+                if(digits == ".nan" || digits == ".NaN" || digits == ".NAN") {
+                    target = std::numeric_limits<T_>::quiet_NaN();
+                    return;
+                }
+            }
+            else {
+                if(digits.starts_with("0x")) {
+                    digits.remove_prefix(2);
+                    base = 16;
+                }
+                else if(digits.starts_with("0o")) {
+                    digits.remove_prefix(2);
+                    base = 8;
+                }
+            }
+
+            if(base == 10 && digits.starts_with('+'))
+                digits.remove_prefix(1);
+
+            auto result = std::from_chars_result{};
+
+            if constexpr(std::is_floating_point_v<T_>)
+                result = std::from_chars(digits.data(), digits.data() + digits.size(), target);
+            else
+                result = std::from_chars(digits.data(), digits.data() + digits.size(), target, base);
+
+            if(digits.empty() || digits.starts_with('-') != event.value.starts_with('-') ||
+               result.ptr != digits.data() + digits.size())
+                invalid("number");
+
+            if(result.ec == std::errc::result_out_of_range) {
+                throw std::runtime_error(
+                    "Number '" + std::string(event.value) + "' is out of range on line " +
+                    std::to_string(event.line) + ", character " + std::to_string(event.character)
+                );
+            }
+
+            if(result.ec != std::errc{})
+                invalid("number");
+        }
+
+        /// Skips the node that starts with the current event. Aliases in the node are not
+        /// expanded.
+        void skip() {
+            for(auto nesting = size_t{0}; ; next(false)) {
+                if(event.type == YamlEventType::MappingStart || event.type == YamlEventType::SequenceStart)
+                    nesting++;
+                else if(event.type == YamlEventType::MappingEnd || event.type == YamlEventType::SequenceEnd)
+                    nesting--;
+
+                if(nesting == 0)
+                    return;
+            }
+        }
+
+        const YamlEvent &next(bool expand = true) {
+            if(!read(expand))
+                throw std::runtime_error("Unexpected end of stream");
+
+            return event;
+        }
+
+        /// Reads the next event from the replayed aliases or from the parser. Aliases are
+        /// replaced by the events of their anchored nodes if expand is set.
+        bool read(bool expand) {
+            while(true) {
+                if(!replays.empty()) {
+                    auto &replay = replays.back();
+
+                    if(replay.begin == replay.end) {
+                        replays.pop_back();
+                        continue;
+                    }
+
+                    auto &recorded = tape[replay.begin++];
+                    event = recorded.event;
+                    event.value = std::string_view{text}.substr(recorded.offset, event.value.size());
+
+                    if(event.type != YamlEventType::Alias || !expand)
+                        return true;
+
+                    //anchor is resolved when the alias is recorded
+                    replays.push_back(recorded.range);
+                    continue;
+                }
+
+                if(!parser.Next(event))
+                    return false;
+
+                record();
+
+                if(event.type != YamlEventType::Alias || !expand)
+                    return true;
+
+                auto anchor = find();
+                ChargeYamlAlias(aliased, anchor.size, budget, event);
+                replays.push_back(anchor.range);
+            }
+        }
+
+        struct Range {
+            size_t begin;
+            size_t end;
+        };
+
+        struct Anchor {
+            Range range;
+            YamlExpansion size;
+        };
+
+        Anchor find() const {
+            auto it = anchors.find(event.value);
+
+            if(it == anchors.end()) {
+                throw std::runtime_error(
+                    "Unknown anchor '" + std::string(event.value) + "' on line " +
+                    std::to_string(event.line) + ", character " + std::to_string(event.character)
+                );
+            }
+
+            return it->second;
+        }
+
+        /// Records the events of anchored nodes and measures their expansion.
+        void record() {
+            auto type = event.type;
+            auto start = type == YamlEventType::MappingStart || type == YamlEventType::SequenceStart;
+
+            if(!event.anchor.empty() && (start || type == YamlEventType::Scalar))
+                recordings.push_back({event.anchor, tape.size(), depth, size});
+
+            if(type == YamlEventType::Alias) {
+                auto anchor = find();
+                size.nodes += anchor.size.nodes;
+                size.bytes += anchor.size.bytes;
+
+                if(!recordings.empty())
+                    tape.push_back({event, text.size(), anchor.range});
+            }
+            else {
+                if(start || type == YamlEventType::Scalar)
+                    size.nodes++;
+
+                size.bytes += event.value.size();
+
+                if(!recordings.empty())
+                    tape.push_back({event, text.size(), {}});
+            }
+
+            if(recordings.empty())
+                return;
+
+            text.append(event.value);
+
+            if(start)
+                depth++;
+            else if(type == YamlEventType::MappingEnd || type == YamlEventType::SequenceEnd)
+                depth--;
+
+            //anchored node is complete when the depth returns to its start
+            while(!recordings.empty() && recordings.back().depth == depth) {
+                auto &recording = recordings.back();
+                anchors[recording.anchor] = {{recording.begin, tape.size()}, size - recording.size};
+                recordings.pop_back();
+            }
+        }
+
+        bool ismergekey() const {
+            return event.value == "<<" && event.style == YamlScalarStyle::Plain;
+        }
+
+        /// Records an unknown key, keys of replayed nodes are recorded once.
+        void unknownkey() {
+            if(!replays.empty()) {
+                if(std::find(replayedkeys.begin(), replayedkeys.end(), event.offset) != replayedkeys.end())
+                    return;
+
+                replayedkeys.push_back(event.offset);
+            }
+
+            auto location = LocationType{event.offset, event.line, event.character};
+
+            if constexpr(LocationType::HasResourceName())
+                location.ResourceName = resource;
+
+            unknown.push_back({std::string(event.value), std::move(location)});
+        }
+
+        bool isnull() const {
+            auto scalar = event.value;
+
+            return event.type == YamlEventType::Scalar && event.style == YamlScalarStyle::Plain &&
+                (scalar.empty() || scalar == "~" || scalar == "null" || scalar == "Null" || scalar == "NULL");
+        }
+
+        void expect(YamlEventType type, const char *what) const {
+            if(event.type != type) {
+                throw std::runtime_error(
+                    std::string("Expected ") + what + " on line " + std::to_string(event.line) +
+                    ", character " + std::to_string(event.character)
+                );
+            }
+        }
+
+        /// Booleans and numbers are plain scalars, quoted and block scalars are strings in
+        /// the core schema.
+        void expectplain(const char *what) const {
+            expect(YamlEventType::Scalar, what);
+
+            if(event.style != YamlScalarStyle::Plain) {
+                throw std::runtime_error(
+                    std::string("Expected ") + what + " on line " + std::to_string(event.line) +
+                    ", character " + std::to_string(event.character) + ", found a string"
+                );
+            }
+        }
+
+        [[noreturn]] void invalid(const char *what) const {
+            throw std::runtime_error(
+                std::string("Invalid ") + what + " '" + std::string(event.value) + "' on line " +
+                std::to_string(event.line) + ", character " + std::to_string(event.character)
+            );
+        }
+
+        [[noreturn]] void duplicate(std::string_view key) const {
+            throw std::runtime_error(
+                "Duplicate key '" + std::string(key) + "' on line " +
+                std::to_string(event.line) + ", character " + std::to_string(event.character)
+            );
+        }
+
+        /// An event of an anchored node, its value is stored in the text buffer. Aliases
+        /// store the range of their anchored node.
+        struct Recorded {
+            YamlEvent event;
+            size_t offset;
+            Range range;
+        };
+
+        /// An anchored node whose events are being recorded
+        struct Recording {
+            std::string_view anchor;
+            size_t begin;
+            size_t depth;
+            YamlExpansion size;
+        };
+
+        YamlParser &parser;
+        const YamlBudget &budget;
+        const std::optional<std::string> &resource;
+        std::vector<UnknownKey<LocationType>> &unknown;
+        bool duplicatekeys;
+
+        YamlEvent event;
+
+        /// Recorded events of the anchored nodes and the values of their scalars
+        std::vector<Recorded> tape;
+        std::string text;
+
+        std::unordered_map<std::string_view, Anchor> anchors;
+        std::vector<Recording> recordings;
+
+        /// Ranges of the tape that are being replayed, the innermost alias is the last
+        std::vector<Range> replays;
+
+        /// Offsets of the unknown keys that are recorded while replaying
+        std::vector<size_t> replayedkeys;
+
+        /// Nesting depth of the recorded events, size of the document with aliases
+        /// expanded and the part charged to aliases
+        size_t depth = 0;
+        YamlExpansion size;
+        YamlExpansion aliased;
+    };
+
+    /// Loads a single YAML document from the reader into the target, see YamlStructLoader.
+    template<YesNoRuntime duplicatekeys_, LocationConcept LocationType, SourceConcept SourceType, class T_>
+    void LoadYaml(
+        SourceType &reader, T_ &target, const std::array<bool, 1> &settings, const YamlBudget &budget,
+        std::vector<UnknownKey<LocationType>> &unknown
+    ) {
+        auto raw = reader.Read(std::numeric_limits<size_t>::max());
+        auto resource = reader.GetResourceName();
+        auto parser = YamlParser(std::string_view{raw});
+
+        YamlStructLoader<duplicatekeys_, LocationType>(parser, settings, budget, resource, unknown).Load(target);
+    }
+
+    /// Spaces used to write indentation without building strings.
+    inline constexpr std::string_view YamlIndentation =
+        "                                                                "
+        "                                                                ";
+
+    /**
+     * @brief Chooses the style that a scalar is emitted in.
+     * Scalars are plain unless they start with an indicator, have white space at either
+     * end, contain ": " or " #" or could be read as a document marker; these are single
+     * quoted. Scalars with control characters are double quoted with escapes. Most
+     * scalars contain none of the characters that need attention, thus the scan tests 8
+     * bytes at a time using word arithmetic and only examines the bytes of a word that
+     * contains a candidate.
+     */
+    constexpr inline YamlScalarStyle ChooseYamlScalarStyle(std::string_view value) noexcept {
+        if(value.empty())
+            return YamlScalarStyle::SingleQuoted;
+
+        auto style = YamlScalarStyle::Plain;
+
+        auto isblank = [](char c) { return c == ' ' || c == '\t'; };
+        auto separated = [&](size_t i) { return i >= value.size() || isblank(value[i]); };
+
+        switch(value.front()) {
+        case '-':
+        case '?':
+        case ':':
+            if(separated(1) || value.starts_with("---"))
+                style = YamlScalarStyle::SingleQuoted;
+            break;
+
+        case '.':
+            if(value.starts_with("..."))
+                style = YamlScalarStyle::SingleQuoted;
+            break;
+
+        case ',': case '[': case ']': case '{': case '}': case '#': case '&': case '*':
+        case '!': case '|': case '>': case '\'': case '"': case '%': case '@': case '`':
+        case ' ': case '\t':
+            style = YamlScalarStyle::SingleQuoted;
+            break;
+        }
+
+        if(isblank(value.back()))
+            style = YamlScalarStyle::SingleQuoted;
+
+        constexpr auto ones  = std::uint64_t{0x0101010101010101};
+        constexpr auto highs = std::uint64_t{0x8080808080808080};
+
+        //checks if any byte of the word is a control character, : or #
+        auto candidate = [&](std::uint64_t word) {
+            auto less  = (word - ones * 0x20) & ~word;
+            auto colon = word ^ (ones * ':');
+            auto hash  = word ^ (ones * '#');
+            auto del   = word ^ (ones * 0x7f);
+
+            return ((less | ((colon - ones) & ~colon) | ((hash - ones) & ~hash) | ((del - ones) & ~del)) & highs) != 0;
+        };
+
+        //examines the bytes in the given range, returns true if double quotes are needed
+        auto examine = [&](size_t from, size_t to) {
+            for(auto i = from; i < to; i++) {
+                auto c = static_cast<unsigned char>(value[i]);
+
+                if(c < 0x20 || c == 0x7f)
+                    return true;
+
+                if((c == ':' && separated(i + 1)) || (c == '#' && i > 0 && isblank(value[i - 1])))
+                    style = YamlScalarStyle::SingleQuoted;
+            }
+
+            return false;
+        };
+
+        auto size = value.size();
+
+        //short scalars are examined directly
+        if(size < 8 || std::is_constant_evaluated())
+            return examine(0, size) ? YamlScalarStyle::DoubleQuoted : style;
+
+        auto i = size_t{0};
+
+        for(; i + 8 <= size; i += 8) {
+            auto word = std::uint64_t{};
+            std::memcpy(&word, value.data() + i, 8);
+
+            if(candidate(word) && examine(i, i + 8))
+                return YamlScalarStyle::DoubleQuoted;
+        }
+
+        //last word overlaps with the previous one, only new bytes are examined
+        if(i < size) {
+            auto word = std::uint64_t{};
+            std::memcpy(&word, value.data() + size - 8, 8);
+
+            if(candidate(word) && examine(i, size))
+                return YamlScalarStyle::DoubleQuoted;
+        }
+
+        return style;
+    }
+
+    /**
+     * @brief Writes YAML documents from data to the target.
+     * Maps and sequences are written in block style with two spaces of indentation, maps
+     * and sequences within sequences start on the line of their entry. Empty collections
+     * are written in flow style. Indentation is written from YamlIndentation and all
+     * writes are combined by a CoalescingTarget.
+     */
+    template<DataConcept DataType, TargetConcept TargetType>
+    class yamlemitter {
+    public:
+        using DataTraits = DataType::DataTraits;
+
+        explicit yamlemitter(TargetType &target_) : target(target_) { }
+
+        void Emit(const DataType &data) {
+            node(data, 0, false);
+            target.Flush();
+        }
+
+    private:
+        void indent(size_t width) {
+            while(width > YamlIndentation.size()) {
+                target.Put(YamlIndentation);
+                width -= YamlIndentation.size();
+            }
+
+            target.Put(YamlIndentation.substr(0, width));
+        }
+
+        enum class Kind {
+            Scalar,
+            Map,
+            Sequence,
+            Empty
+        };
+
+        /// Returns the kind of the node, empty collections are written in flow style.
+        static Kind kindof(const DataType &data) {
+            if constexpr(DataTraits::HasMap()) {
+                if(data.IsMap())
+                    return data.GetMap().empty() ? Kind::Empty : Kind::Map;
+            }
+
+            if constexpr(DataTraits::HasSequence()) {
+                if(data.IsSequence())
+                    return data.GetSequence().empty() ? Kind::Empty : Kind::Sequence;
+            }
+
+            return Kind::Scalar;
+        }
+
+        /// Writes the node, the line is already indented. Compact nodes start right
+        /// after an entry indicator.
+        void node(const DataType &data, size_t width, bool compact) {
+            nodeof(data, kindof(data), width, compact);
+        }
+
+        void nodeof(const DataType &data, Kind kind, size_t width, bool compact) {
+            switch(kind) {
+            case Kind::Map:
+                if constexpr(DataTraits::HasMap())
+                    map(data, width, compact);
+                break;
+
+            case Kind::Sequence:
+                if constexpr(DataTraits::HasSequence())
+                    sequence(data, width, compact);
+                break;
+
+            case Kind::Empty:
+                target.Put(emptyof(data));
+                break;
+
+            case Kind::Scalar:
+                scalar(data);
+                target.Put('\n');
+                break;
+            }
+        }
+
+        /// Flow style representation of an empty collection.
+        static std::string_view emptyof(const DataType &data) {
+            if constexpr(DataTraits::HasMap()) {
+                if(data.IsMap())
+                    return "{}\n";
+            }
+
+            return "[]\n";
+        }
+
+        void map(const DataType &data, size_t width, bool compact) {
+            auto first = true;
+
+            for(auto &[key, value] : data.GetMap()) {
+                if(!first || !compact)
+                    indent(width);
+
+                first = false;
+
+                //a plain << key would be read back as a merge key
+                if(std::string_view{key} == "<<")
+                    target.Put("'<<'");
+                else
+                    text(std::string_view{key});
+
+                auto kind = kindof(value);
+
+                if(kind == Kind::Map || kind == Kind::Sequence) {
+                    target.Put(":\n");
+                    nodeof(value, kind, width + 2, false);
+                }
+                else {
+                    target.Put(": ");
+                    nodeof(value, kind, width + 2, false);
+                }
+            }
+        }
+
+        void sequence(const DataType &data, size_t width, bool compact) {
+            auto first = true;
+
+            for(auto &item : data.GetSequence()) {
+                if(!first || !compact)
+                    indent(width);
+
+                first = false;
+
+                target.Put("- ");
+                node(item, width + 2, true);
+            }
+        }
+
+        void scalar(const DataType &data) {
+            //emitters may return a reference to the stored value
+            decltype(auto) value = converter(data.GetData());
+            text(std::string_view{value});
+        }
+
+        void text(std::string_view value) {
+            switch(ChooseYamlScalarStyle(value)) {
+            case YamlScalarStyle::Plain:
+                target.Put(value);
+                break;
+
+            case YamlScalarStyle::DoubleQuoted:
+                doublequoted(value);
+                break;
+
+            default:
+                target.Put('\'');
+
+                for(auto quote = value.find('\''); quote != std::string_view::npos; quote = value.find('\'')) {
+                    target.Put(value.substr(0, quote + 1));
+                    target.Put('\'');
+                    value.remove_prefix(quote + 1);
+                }
+
+                target.Put(value);
+                target.Put('\'');
+                break;
+            }
+        }
+
+        void doublequoted(std::string_view value) {
+            static constexpr char hex[] = "0123456789ABCDEF";
+
+            target.Put('"');
+
+            auto start = size_t{0};
+
+            for(size_t i = 0; i < value.size(); i++) {
+                auto c = static_cast<unsigned char>(value[i]);
+                auto escape = char{0};
+
+                switch(c) {
+                case '\0': escape = '0';  break;
+                case '\a': escape = 'a';  break;
+                case '\b': escape = 'b';  break;
+                case '\t': escape = 't';  break;
+                case '\n': escape = 'n';  break;
+                case '\v': escape = 'v';  break;
+                case '\f': escape = 'f';  break;
+                case '\r': escape = 'r';  break;
+                case 0x1b: escape = 'e';  break;
+                case '"':  escape = '"';  break;
+                case '\\': escape = '\\'; break;
+                default:
+                    if(c >= 0x20 && c != 0x7f)
+                        continue;
+                }
+
+                target.Put(value.substr(start, i - start));
+                target.Put('\\');
+
+                if(escape) {
+                    target.Put(escape);
+                }
+                else {
+                    target.Put('x');
+                    target.Put(hex[c >> 4]);
+                    target.Put(hex[c & 15]);
+                }
+
+                start = i + 1;
+            }
+
+            target.Put(value.substr(start));
+            target.Put('"');
+        }
+
+        CoalescingTarget<TargetType> target;
+        typename DataTraits::DataEmitterType converter{};
+    };
+
+    /// Writes the given data as a YAML document to the target, see yamlemitter.
+    template<DataConcept DataType, TargetConcept TargetType>
+    void EmitYaml(const DataType &data, TargetType &target) {
+        yamlemitter<DataType, TargetType>(target).Emit(data);
+    }
+
+}
@@ -0,0 +1,538 @@
+#pragma once
+
+#include "config.hpp"
+
+#include "batch.hpp"
+#include "concepts.hpp"
+#include "data.hpp"
+#include "fields.hpp"
+#include "location.hpp"
+#include "ordered-map.hpp"
+#include "small-vector.hpp"
+#include "source.hpp"
+#include "tape.hpp"
+#include "target.hpp"
+#include "txt-helper.hpp"
+#include "types.hpp"
+#include "yaml-helper.hpp"
+
+#include <array>
+#include <concepts>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "macros.hpp"
+
+namespace CPP_SERIALIZER_NAMESPACE {
+
+    /**
+     * @brief Data traits for YAML documents.
+     * Mappings are stored as maps in document order with the key locations next to the
+     * entries, sequences as SmallVector without inline capacity, as the element type is
+     * incomplete here. All scalars are stored as strings, as in the failsafe schema.
+     */
+    template<LocationConcept LocationType_>
+    struct YamlDataTraits {
+        using StorageType = std::string;
+
+        using NumberType = void;
+        using IntegerType = void;
+        using RealType = void;
+        using StringType = std::string;
+        using NullType = void;
+        using BoolType = void;
+        using IndexType = size_t;
+        using SequenceType = SmallVector<Data<YamlDataTraits>, 0>;
+        using KeyType = std::string;
+        using MapType = LocatedHashMap<std::string, Data<YamlDataTraits>, LocationType_>;
+
+        using DataParserType = internal::SimpleTextDataConverter<LocationType_>;
+        using DataEmitterType = internal::SimpleTextDataConverter<LocationType_>;
+        using LocationType = LocationType_;
+    };
+
+    struct SimpleYamlSettings {
+        constexpr static auto DuplicateKeys = YesNoRuntime::No;
+
+        using DataTraits = YamlDataTraits<LineLocation>;
+        using DataType   = Data<DataTraits>;
+    };
+
+    template<class Location = LineLocation>
+    struct RuntimeYamlSettings {
+        constexpr static auto DuplicateKeys = YesNoRuntime::Runtime;
+
+        using DataTraits = YamlDataTraits<Location>;
+        using DataType   = Data<DataTraits>;
+    };
+
+    /**
+     * @brief Pull style reader of YAML events.
+     * Events are obtained one at a time using Next without building any data, thus
+     * large documents can be validated or searched. Each event has a context with the
+     * location of the event and the path of its node. Path is updated in place: mapping
+     * keys are kept in a single buffer and path entries are reused, thus after the
+     * deepest node is reached, reading events does not allocate memory except for
+     * scalars that need to be unescaped or folded. Memory use depends on the nesting
+     * depth and scalar sizes, not on the document size, when the source returns views to
+     * its buffer, such as Source<std::string_view> over a memory mapped file; other
+     * sources are read to the end before parsing.
+     * Path of a node contains an entry for the node itself: its key in its mapping or
+     * its index in its sequence. Mapping keys are reported as scalar events marked with
+     * IsKey, their path is the path of the mapping. End events have the same path as
+     * the matching start events. Aliases are reported as alias events, they are not
+     * resolved.
+     */
+    template<LocationConcept LocationType_ = LineLocation>
+    class YamlEventReader {
+    public:
+        using LocationType = LocationType_;
+
+        /**
+         * @brief Creates a reader for the given source, reading starts with Next.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source. Source
+         *        should outlive the reader.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        explicit YamlEventReader(Source_ &source) :
+            YamlEventReader(std::in_place, make_source<AutoTranslateSource>(source))
+        { }
+
+        YamlEventReader(const YamlEventReader &) = delete;
+        YamlEventReader &operator=(const YamlEventReader &) = delete;
+
+        /**
+         * @brief Reads the next event.
+         * @return false after the stream end event.
+         * @throws std::runtime_error if the source is not valid YAML.
+         */
+        bool Next() {
+            //node of the previous event is complete
+            if(closing) {
+                closing = false;
+                levels.pop_back();
+                finishchild();
+            }
+            else if((event.type == YamlEventType::Scalar || event.type == YamlEventType::Alias) && !key) {
+                finishchild();
+            }
+
+            if(!parser.Next(event))
+                return false;
+
+            key = false;
+
+            switch(event.type) {
+            case YamlEventType::Scalar:
+                if(!levels.empty() && levels.back().map && !levels.back().haskey) {
+                    setkey();
+                    break;
+                }
+
+                startchild();
+                break;
+
+            case YamlEventType::Alias:
+                startchild();
+                break;
+
+            case YamlEventType::MappingStart:
+            case YamlEventType::SequenceStart:
+                startchild();
+                levels.push_back({event.type == YamlEventType::MappingStart, false, 0, keys.size(), 0});
+                break;
+
+            case YamlEventType::MappingEnd:
+            case YamlEventType::SequenceEnd:
+                closing = true;
+                break;
+
+            default:
+                break;
+            }
+
+            context.location = LocationType{event.offset, event.line, event.character};
+
+            if constexpr(LocationType::HasResourceName())
+                context.location.ResourceName = resource;
+
+            return true;
+        }
+
+        /// Type of the current event.
+        YamlEventType GetType() const {
+            return event.type;
+        }
+
+        /// Value of the current scalar event or the anchor name of the current alias
+        /// event. It is only valid until the next event.
+        std::string_view GetValue() const {
+            return event.value;
+        }
+
+        /// Anchor of the current scalar or collection start event, empty if the node has
+        /// no anchor.
+        std::string_view GetAnchor() const {
+            return event.anchor;
+        }
+
+        /// Style of the current scalar event.
+        YamlScalarStyle GetStyle() const {
+            return event.style;
+        }
+
+        /// Checks if the current scalar event is a mapping key.
+        bool IsKey() const {
+            return key;
+        }
+
+        /// Location and path of the current event. Path entries are only valid until the
+        /// next event.
+        const Context<LocationType> &GetContext() const {
+            return context;
+        }
+
+    private:
+        struct Level {
+            bool map;
+            bool haskey;
+            int index;
+
+            /// Range of the current key of a mapping in the key buffer
+            size_t keyoffset;
+            size_t keysize;
+        };
+
+        template<class SourceType>
+        YamlEventReader(std::in_place_t, SourceType reader) :
+            buffer(readall(reader)),
+            parser(viewof(reader)),
+            resource(reader.GetResourceName())
+        { }
+
+        template<class SourceType>
+        std::string readall(SourceType &reader) {
+            if constexpr(std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>)
+                return {};
+            else
+                return reader.Read(std::numeric_limits<size_t>::max());
+        }
+
+        template<class SourceType>
+        std::string_view viewof(SourceType &reader) {
+            if constexpr(std::is_same_v<decltype(reader.Read(size_t{})), std::string_view>)
+                return reader.Read(std::numeric_limits<size_t>::max());
+            else
+                return buffer;
+        }
+
+        /// Adds the path entry of a node that starts in the current collection.
+        void startchild() {
+            if(levels.empty())
+                return;
+
+            auto &level = levels.back();
+
+            if(level.map)
+                context.path.entries.emplace_back(Path::Map, std::string_view{keys}.substr(level.keyoffset, level.keysize));
+            else
+                context.path.entries.emplace_back(Path::Sequence, level.index);
+        }
+
+        /// Removes the path entry of the node that is complete and moves to the next one.
+        void finishchild() {
+            if(levels.empty())
+                return;
+
+            auto &level = levels.back();
+            context.path.entries.pop_back();
+
+            if(level.map) {
+                level.haskey = false;
+                keys.resize(level.keyoffset);
+            }
+            else {
+                level.index++;
+            }
+        }
+
+        /// Stores the key of the current mapping, views of the outer keys are updated if
+        /// the buffer is reallocated.
+        void setkey() {
+            auto &level = levels.back();
+            auto capacity = keys.capacity();
+
+            keys.append(event.value);
+            level.keysize = event.value.size();
+            level.haskey  = true;
+            key = true;
+
+            if(keys.capacity() != capacity) {
+                for(size_t i = 0; i < context.path.entries.size(); i++) {
+                    if(levels[i].map)
+                        context.path.entries[i].entry = std::string_view{keys}.substr(levels[i].keyoffset, levels[i].keysize);
+                }
+            }
+        }
+
+        /// Owns the source if it cannot be viewed directly
+        std::string buffer;
+        internal::YamlParser parser;
+        std::optional<std::string> resource;
+
+        internal::YamlEvent event;
+        Context<LocationType> context;
+        std::vector<Level> levels;
+
+        /// Keys of the open mappings, one after another
+        std::string keys;
+
+        bool key = false;
+        bool closing = false;
+    };
+
+    CPPSER_DEFINE_MIXTIME_STRUCT(YamlTransport, DuplicateKeys, duplicatekeys, false)
+
+    /**
+     * @brief YAML transport.
+     * Parsing is done in two stages. First stage builds an index of the structural
+     * characters of the whole source using 64 bit masks, see internal::YamlIndex. Second
+     * stage is a state machine that walks the index to produce events, see
+     * internal::YamlParser, thus most of the source is not examined character by
+     * character twice. Block and flow collections, all scalar styles, anchors, aliases,
+     * merge keys and multiple documents in a stream are supported; explicit keys are
+     * not. Aliases share the anchored node instead of copying it, see Data::SetShared;
+     * their expansion is limited by the alias budgets.
+     * @tparam Settings_ Transport settings, see SimpleYamlSettings.
+     */
+    template<YamlSettingsConcept Settings_ = SimpleYamlSettings>
+    class YamlTransport :
+        public internal::YamlTransport_duplicatekeys_helper<Settings_::DuplicateKeys>
+    {
+    public:
+        using Settings     = Settings_;
+        using DataType     = Settings::DataType;
+        using DataTraits   = Settings::DataTraits;
+        using StorageType  = DataType::StorageType;
+        using LocationType = DataTraits::LocationType;
+
+        /**
+         * @brief Sets the number of nodes that the aliases of a document may expand to.
+         * Each alias is charged with the size of the node it refers to including its
+         * aliases, thus documents that expand exponentially are rejected. 0 removes the
+         * limit.
+         */
+        void SetAliasNodeBudget(size_t value) { budget.nodes = value; }
+        size_t GetAliasNodeBudget() const { return budget.nodes; }
+
+        /// Sets the number of scalar bytes that the aliases of a document may expand to,
+        /// see SetAliasNodeBudget.
+        void SetAliasByteBudget(size_t value) { budget.bytes = value; }
+        size_t GetAliasByteBudget() const { return budget.bytes; }
+
+        /**
+         * @brief Parses a single document from the given source into the given data target.
+         * Existing contents of the data are replaced.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source. Streams are
+         *        read to the end before parsing.
+         * @param data Data target, this variable will be filled with the parsed document.
+         * @throws std::runtime_error if the source is not valid YAML, contains more than
+         *         one document, has duplicate keys while they are not allowed or its
+         *         aliases exceed the budget.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        void Parse(Source_ &source, DataType &data) {
+            auto reader = make_source<AutoTranslateSource>(source);
+
+            auto settings = std::array<bool, 1>{};
+            CPPSER_READ_IF_RUNTIME(DuplicateKeys, 0);
+
+            DispatchMixedTime<Settings::DuplicateKeys>(
+                settings,
+                [&]<YesNoRuntime duplicatekeys_>() {
+                    internal::ParseYaml<duplicatekeys_>(reader, data, settings, budget);
+                }
+            );
+        }
+
+        /**
+         * @brief Parses a single document from the given source.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source.
+         * @return Parsed document.
+         * @throws std::runtime_error see Parse(source, data).
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        DataType Parse(Source_ &source) {
+            DataType data;
+            Parse<AutoTranslateSource>(source, data);
+            return data;
+        }
+
+        /**
+         * @brief Parses a single document from the given source into the given tape.
+         * Existing contents of the tape are replaced. Tapes store the document in a few
+         * contiguous buffers, see Tape. Aliases are copied instead of shared, their
+         * expansion is limited by the alias budgets.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source. Streams are
+         *        read to the end before parsing.
+         * @param tape Tape target, this variable will be filled with the parsed document.
+         * @throws std::runtime_error see Parse(source, data).
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        void ParseTape(Source_ &source, Tape<LocationType> &tape) {
+            auto reader = make_source<AutoTranslateSource>(source);
+
+            auto settings = std::array<bool, 1>{};
+            CPPSER_READ_IF_RUNTIME(DuplicateKeys, 0);
+
+            DispatchMixedTime<Settings::DuplicateKeys>(
+                settings,
+                [&]<YesNoRuntime duplicatekeys_>() {
+                    internal::ParseYamlTape<duplicatekeys_>(reader, tape, settings, budget);
+                }
+            );
+        }
+
+        /**
+         * @brief Parses a single document from the given source into a tape.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source.
+         * @return Parsed document.
+         * @throws std::runtime_error see Parse(source, data).
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        Tape<LocationType> ParseTape(Source_ &source) {
+            Tape<LocationType> tape;
+            ParseTape<AutoTranslateSource>(source, tape);
+            return tape;
+        }
+
+        /**
+         * @brief Loads a single document directly into the given object without building
+         * data. Structures are described by field tables, see StructFields and
+         * internal::YamlStructLoader for the supported types. Members that are not in the
+         * document keep their values.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source. Streams are
+         *        read to the end before loading.
+         * @param object Object to load the document into.
+         * @return Keys that do not correspond to a field of their structure with their
+         *         locations, in document order.
+         * @throws std::runtime_error if the source is not valid YAML, contains more than one
+         *         document, a node does not match the type of its member, has duplicate
+         *         keys while they are not allowed or its aliases exceed the budget.
+         */
+        template<bool AutoTranslateSource = true, class Source_, class T_>
+        std::vector<UnknownKey<LocationType>> Load(Source_ &source, T_ &object) {
+            auto reader = make_source<AutoTranslateSource>(source);
+            auto unknown = std::vector<UnknownKey<LocationType>>{};
+
+            auto settings = std::array<bool, 1>{};
+            CPPSER_READ_IF_RUNTIME(DuplicateKeys, 0);
+
+            DispatchMixedTime<Settings::DuplicateKeys>(
+                settings,
+                [&]<YesNoRuntime duplicatekeys_>() {
+                    internal::LoadYaml<duplicatekeys_>(reader, object, settings, budget, unknown);
+                }
+            );
+
+            return unknown;
+        }
+
+        /**
+         * @brief Parses every document of a multi-document stream using multiple threads.
+         * Stream is first split at document markers that are not within quoted or block
+         * scalars, then documents are parsed concurrently. Locations contain the resource
+         * name of the source and the offsets and line numbers within the whole stream.
+         * @tparam AutoTranslateSource See TextTransport::Parse
+         * @param source Data source, anything that can be turned into a Source. Streams are
+         *        read to the end before parsing.
+         * @param threads Number of worker threads, 0 uses hardware concurrency.
+         * @return Results in the order of the documents. Errors are stored in the result of
+         *         the document that contains them, see BatchResult.
+         */
+        template<bool AutoTranslateSource = true, class Source_>
+        std::vector<BatchResult<DataType>> ParseDocuments(Source_ &source, size_t threads = 0) {
+            auto results = std::vector<BatchResult<DataType>>{};
+
+            parsedocuments<AutoTranslateSource>(
+                source, threads,
+                [&](size_t count) { results.resize(count); },
+                [&](size_t index, BatchResult<DataType> &&result) { results[index] = std::move(result); }
+            );
+
+            return results;
+        }
+
+        /**
+         * @brief Parses every document of a multi-document stream using multiple threads and
+         * passes each document to the callback as soon as it is parsed.
+         * Documents are not held after the callback returns. Callback is called from the
+         * worker threads, but never concurrently.
+         * @param callback Called with the index of the document in the stream and its
+         *        result, see BatchResult. Documents are passed in the order they complete.
+         * @param threads Number of worker threads, 0 uses hardware concurrency.
+         */
+        template<bool AutoTranslateSource = true, class Source_, class F_>
+        requires std::invocable<F_ &, size_t, BatchResult<DataType> &&>
+        void ParseDocuments(Source_ &source, F_ &&callback, size_t threads = 0) {
+            auto mutex = std::mutex{};
+
+            parsedocuments<AutoTranslateSource>(
+                source, threads,
+                [](size_t) { },
+                [&](size_t index, BatchResult<DataType> &&result) {
+                    std::lock_guard lock(mutex);
+                    callback(index, std::move(result));
+                }
+            );
+        }
+
+        /**
+         * @brief Emits the given document to the given target.
+         * Collections are written in block style, scalars are quoted only when they would
+         * not be read back as the same string, see internal::ChooseYamlScalarStyle.
+         */
+        template<class T_>
+        void Emit(const DataType &data, T_ &target) {
+            auto writer = make_target(target);
+
+            internal::EmitYaml(data, writer);
+        }
+
+    private:
+        template<bool AutoTranslateSource, class Source_, class P_, class F_>
+        void parsedocuments(Source_ &source, size_t threads, P_ &&prepare, F_ &&store) {
+            auto reader = make_source<AutoTranslateSource>(source);
+
+            auto settings = std::array<bool, 1>{};
+            CPPSER_READ_IF_RUNTIME(DuplicateKeys, 0);
+
+            DispatchMixedTime<Settings::DuplicateKeys>(
+                settings,
+                [&]<YesNoRuntime duplicatekeys_>() {
+                    internal::ParseYamlDocuments<duplicatekeys_, DataType>(reader, settings, budget, threads, prepare, store);
+                }
+            );
+        }
+
+        internal::YamlBudget budget;
+    };
+
+    inline YamlTransport<> YamlTransportSimple;
+    using RuntimeYamlTransport = YamlTransport<RuntimeYamlSettings<>>;
+
+}
+
+#include "unmacro.hpp"
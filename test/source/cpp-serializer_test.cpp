@@ -1,16 +1,93 @@
 #include <cpp-serializer/utf.hpp>
+#include <cpp-serializer/tmp.hpp>
 #include <cpp-serializer/location.hpp>
 #include <cpp-serializer/data.hpp>
+#include <cpp-serializer/ordered-map.hpp>
+#include <cpp-serializer/small-vector.hpp>
+#include <cpp-serializer/tape.hpp>
 #include <cpp-serializer/txt.hpp>
+#include <cpp-serializer/batch.hpp>
+#include <cpp-serializer/ini.hpp>
+#include <cpp-serializer/snapshot.hpp>
+#include <cpp-serializer/yaml.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory_resource>
+#include <variant>
+#include <new>
+#include <optional>
+#include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace std::literals;
 using namespace CPP_SERIALIZER_NAMESPACE;
 
+//counts heap allocations to verify allocation free code paths. Every form of the global
+//allocation functions is replaced so that all memory is obtained from and returned to
+//malloc, mixing with the default forms is reported by sanitizers.
+static std::atomic<size_t> allocationcount{0};
+
+namespace {
+    void *countedallocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) noexcept {
+        ++allocationcount;
+        size = size ? size : 1;
+
+        if(alignment <= alignof(std::max_align_t))
+            return std::malloc(size);
+
+        //aligned_alloc requires the size to be a multiple of the alignment
+        return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    }
+
+    void *countedallocateorthrow(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+        if(auto ptr = countedallocate(size, alignment))
+            return ptr;
+
+        throw std::bad_alloc{};
+    }
+}
+
+void *operator new(std::size_t size) { return countedallocateorthrow(size); }
+void *operator new[](std::size_t size) { return countedallocateorthrow(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    return countedallocateorthrow(size, static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return countedallocateorthrow(size, static_cast<std::size_t>(alignment));
+}
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return countedallocate(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return countedallocate(size); }
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedallocate(size, static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedallocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { std::free(ptr); }
+
 TEST_CASE("UTF8Bytes", "[helpers][utf]") {
     auto str = "aÂᴬ𝐴"s;
     REQUIRE(UTF8Bytes(str[0]) == 1);
@@ -19,6 +96,297 @@ TEST_CASE("UTF8Bytes", "[helpers][utf]") {
     REQUIRE(UTF8Bytes(str[6]) == 4);
 }
 
+TEST_CASE("DispatchMixedTime", "[helpers][tmp]") {
+    auto settings = std::array<bool, 3>{true, false, true};
+    auto func = []<YesNoRuntime a, YesNoRuntime b, YesNoRuntime c>() {
+        return std::array{a, b, c};
+    };
+
+    auto ret = DispatchMixedTime<YesNoRuntime::Runtime, YesNoRuntime::Runtime, YesNoRuntime::No>(settings, func);
+    REQUIRE(ret == std::array{YesNoRuntime::Yes, YesNoRuntime::No, YesNoRuntime::No});
+
+    ret = DispatchMixedTime<YesNoRuntime::No, YesNoRuntime::Yes, YesNoRuntime::Runtime>(settings, func);
+    REQUIRE(ret == std::array{YesNoRuntime::No, YesNoRuntime::Yes, YesNoRuntime::Yes});
+}
+
+template<class Map_>
+struct MapTextDataTraits : TextDataTraits<NoLocation> {
+    using KeyType = std::string;
+    using MapType = Map_;
+};
+
+/// Exposes map storage that Data does not yet provide an accessor for
+template<class Map_>
+struct MapData : Data<MapTextDataTraits<Map_>> {
+    void SetMap(const Map_ &map) { this->data = map; }
+};
+
+TEST_CASE("OrderedHashMap", "[Data][Map]") {
+    static_assert(MapConcept<OrderedHashMap<std::string, std::string>, std::string, std::string>);
+    static_assert(MapConcept<std::map<std::string, std::string>, std::string, std::string>);
+
+    OrderedHashMap<std::string, int> map;
+    REQUIRE(map.find("missing") == map.end());
+    REQUIRE(map.erase("missing") == 0);
+
+    for(int i = 0; i < 5000; i++)
+        map["key" + std::to_string(i)] = i;
+
+    REQUIRE(map.size() == 5000);
+    REQUIRE(map.at("key1234") == 1234);
+    REQUIRE_THROWS_AS(map.at("key5000"), std::out_of_range);
+    REQUIRE_FALSE(map.insert({"key10", -1}).second);
+    REQUIRE(map["key10"] == 10);
+
+    for(int i = 0; i < 5000; i += 2)
+        REQUIRE(map.erase("key" + std::to_string(i)) == 1);
+
+    REQUIRE(map.size() == 2500);
+
+    int expected = 1;
+    for(auto &[key, value] : map) {
+        REQUIRE(value == expected);
+        REQUIRE(key == "key" + std::to_string(expected));
+        expected += 2;
+    }
+
+    for(int i = 0; i < 5000; i++)
+        REQUIRE(map.contains("key" + std::to_string(i)) == (i % 2 == 1));
+
+    for(auto it = map.begin(); it != map.end(); )
+        it = it->second % 4 == 1 ? map.erase(it) : std::next(it);
+
+    REQUIRE(map.size() == 1250);
+    REQUIRE(std::next(map.begin())->second == 7);
+    REQUIRE(map.at("key4999") == 4999);
+    REQUIRE_FALSE(map.contains("key4997"));
+
+    map.clear();
+    REQUIRE(map.empty());
+    REQUIRE_FALSE(map.contains("key1"));
+
+    //moved from map is empty and can be reused after erases
+    for(int i = 0; i < 10; i++)
+        map["key" + std::to_string(i)] = i;
+
+    map.erase("key3");
+    auto moved = std::move(map);
+    REQUIRE(moved.size() == 9);
+    REQUIRE(map.empty());
+
+    map["reused"] = 1;
+    REQUIRE(map.size() == 1);
+
+    moved.erase("key4");
+    map = std::move(moved);
+    REQUIRE(map.size() == 8);
+    REQUIRE(moved.empty());
+
+    moved["again"] = 2;
+    REQUIRE(moved.at("again") == 2);
+
+    LocatedHashMap<std::string, int, int> located;
+    for(int i = 0; i < 100; i++)
+        located.GetMetadata(located.try_emplace("key" + std::to_string(i), i).first) = -i;
+
+    for(int i = 0; i < 90; i++)
+        located.erase("key" + std::to_string(i));
+
+    auto copy = located;
+    REQUIRE(copy == located);
+    REQUIRE(copy.GetMetadata(copy.find("key95")) == -95);
+
+    MapData<OrderedHashMap<std::string, std::string>> data;
+    REQUIRE_FALSE(data.KeyExists("name"));
+
+    data.SetMap({{"name", "value"}});
+    REQUIRE(data.KeyExists("name"));
+    REQUIRE_FALSE(data.KeyExists("other"));
+}
+
+TEST_CASE("SmallVector", "[Data][Sequence]") {
+    using Vector = SmallVector<std::string>;
+
+    static_assert(SequenceConcept<Vector, size_t, std::string>);
+    static_assert(SequenceConcept<std::vector<std::string>, size_t, std::string>);
+    static_assert(Vector::InlineCapacity == 8);
+
+    auto longstr = [](int i) { return std::to_string(i) + " a string that does not fit in small buffer"; };
+
+    Vector vec;
+    auto before = allocationcount.load();
+    for(int i = 0; i < 8; i++)
+        vec.emplace_back(size_t{3}, 'a');
+    auto allocations = allocationcount.load() - before;
+
+    REQUIRE(allocations == 0);
+    REQUIRE(vec.size() == 8);
+    REQUIRE(vec.capacity() == 8);
+
+    vec.clear();
+    for(int i = 0; i < 20; i++)
+        vec.push_back(longstr(i));
+
+    REQUIRE(vec.size() == 20);
+    REQUIRE(vec.capacity() >= 20);
+    REQUIRE(vec[19] == longstr(19));
+
+    vec.erase(vec.begin(), vec.begin() + 15);
+    vec.insert(vec.begin() + 1, longstr(100));
+    vec.insert(vec.begin(), vec.back());
+    vec.erase(vec.end() - 1);
+
+    REQUIRE(vec == Vector{longstr(19), longstr(15), longstr(100), longstr(16), longstr(17), longstr(18)});
+
+    vec.shrink_to_fit();
+    REQUIRE(vec.capacity() == 8);
+    REQUIRE(vec[2] == longstr(100));
+
+    Vector copy = vec;
+    Vector moved = std::move(vec);
+    REQUIRE(copy == moved);
+    REQUIRE(vec.empty());
+
+    vec = std::move(moved);
+    REQUIRE(vec == copy);
+
+    vec.resize(2);
+    REQUIRE(vec == Vector{longstr(19), longstr(15)});
+    vec.resize(3);
+    REQUIRE(vec[2].empty());
+    REQUIRE_THROWS_AS(vec.at(3), std::out_of_range);
+
+    //moving between different memory resources moves the elements one by one
+    using PmrVector = SmallVector<std::string, 2, std::pmr::polymorphic_allocator<std::string>>;
+    static_assert(std::is_nothrow_move_assignable_v<Vector>);
+    static_assert(!std::is_nothrow_move_assignable_v<PmrVector>);
+
+    std::pmr::monotonic_buffer_resource resource;
+    PmrVector pmrsource(&resource), pmrtarget;
+    for(int i = 0; i < 4; i++)
+        pmrsource.emplace_back(longstr(i));
+
+    pmrtarget = std::move(pmrsource);
+    REQUIRE(pmrtarget.size() == 4);
+    REQUIRE(pmrtarget[3] == longstr(3));
+    REQUIRE(pmrtarget.get_allocator().resource() == std::pmr::get_default_resource());
+
+    //value is copied before the elements are destroyed
+    vec = Vector{longstr(1), longstr(2)};
+    vec.assign(3, vec[0]);
+    REQUIRE(vec == Vector{longstr(1), longstr(1), longstr(1)});
+    vec.assign(20, vec.back());
+    REQUIRE(vec.size() == 20);
+    REQUIRE(vec[19] == longstr(1));
+
+    //without inline capacity elements are allocated and the element type can be incomplete
+    using HeapVector = SmallVector<std::string, 0>;
+    static_assert(std::is_nothrow_move_constructible_v<YamlDataTraits<LineLocation>::SequenceType>);
+
+    HeapVector heap{longstr(1), longstr(2)};
+    HeapVector heapmoved = std::move(heap);
+    REQUIRE(heap.empty());
+    REQUIRE(heap.capacity() == 0);
+    REQUIRE(heapmoved[1] == longstr(2));
+    heapmoved.clear();
+    heapmoved.shrink_to_fit();
+    REQUIRE(heapmoved.capacity() == 0);
+}
+
+namespace {
+    /// Copies throw once the limit is reached, live instances are counted.
+    struct ThrowingCopy {
+        static inline int live = 0;
+        static inline int limit = 0;
+
+        ThrowingCopy() { live++; }
+        ThrowingCopy(const ThrowingCopy &) {
+            if(--limit < 0)
+                throw std::runtime_error("copy");
+
+            live++;
+        }
+        ~ThrowingCopy() { live--; }
+    };
+}
+
+TEST_CASE("SmallVector exception safety", "[Data][Sequence]") {
+    using Vector = SmallVector<ThrowingCopy, 2>;
+
+    {
+        ThrowingCopy::limit = 5;
+        Vector vec(5);
+        REQUIRE(ThrowingCopy::live == 5);
+
+        ThrowingCopy::limit = 3;
+        REQUIRE_THROWS_AS(Vector(vec), std::runtime_error);
+        REQUIRE(ThrowingCopy::live == 5);
+
+        Vector target;
+        ThrowingCopy::limit = 3;
+        REQUIRE_THROWS_AS(target = vec, std::runtime_error);
+        REQUIRE(target.size() == 3);
+        REQUIRE(ThrowingCopy::live == 8);
+    }
+
+    REQUIRE(ThrowingCopy::live == 0);
+}
+
+TEST_CASE("Tape", "[Data][Tape]") {
+    Tape<LineLocation> tape;
+
+    tape.BeginMap({1, 1});
+        tape.Key("name");
+        tape.Value("cpp-serializer", {1, 7});
+        tape.Key("list");
+        tape.BeginSequence({2, 1});
+            tape.Value("1", {3, 3});
+            tape.BeginSequence({4, 3});
+                tape.Value("nested", {4, 5});
+            tape.End();
+            tape.Null({5, 3});
+        tape.End();
+        tape.Key("empty");
+        tape.BeginMap({6, 8});
+        tape.End();
+    tape.End();
+
+    auto root = tape.Root();
+    REQUIRE(root.IsMap());
+    REQUIRE(root.size() == 3);
+    REQUIRE(root.KeyExists("list"));
+    REQUIRE_FALSE(root.KeyExists("missing"));
+
+    auto name = root.Find("name");
+    REQUIRE(name);
+    REQUIRE(name->GetData() == "cpp-serializer");
+    REQUIRE(name->GetLocation().LineOffset == 1); REQUIRE(name->GetLocation().CharOffset == 7);
+
+    auto list = *root.Find("list");
+    REQUIRE(list.IsSequence());
+    REQUIRE(list.size() == 3);
+    REQUIRE(list[0].GetData() == "1");
+    REQUIRE(list[1].size() == 1);
+    REQUIRE(list[1][0].GetData() == "nested");
+    REQUIRE(list[2].IsNull());
+    REQUIRE(list[2].GetLocation().LineOffset == 5);
+
+    std::vector<std::string_view> keys;
+    for(auto child : root)
+        keys.push_back(child.GetKey());
+
+    REQUIRE(keys == std::vector<std::string_view>{"name", "list", "empty"});
+    REQUIRE(root[2].IsMap());
+    REQUIRE(root[2].empty());
+    REQUIRE(root[2].begin() == root[2].end());
+    REQUIRE(tape.GetNodeCount() == 8);
+
+    tape.Clear();
+    tape.BeginSequence();
+    tape.End();
+    REQUIRE(tape.Root().empty());
+}
+
 TEST_CASE("Test text reader string", "[Parse][Text][Source<string_view>]") {
     TextTransport<>::DataType data;
     TextTransportSimple.Parse("Hello", data);
@@ -90,6 +458,141 @@ TEST_CASE("Test text reader string", "[Parse][Text][RuntimeSettings]") {
     REQUIRE(data.GetData() == "Hello world");
 }
 
+TEST_CASE("Data accessors", "[Data]") {
+    TextTransport<>::DataType data;
+
+    auto text = std::string(100, 'a');
+    auto buffer = text.data();
+
+    data.SetData(std::move(text));
+    REQUIRE(data.GetData().data() == buffer);
+    REQUIRE(&data.GetData() == &data.GetData());
+
+    auto taken = data.TakeData();
+    REQUIRE(taken.data() == buffer);
+    REQUIRE_THROWS(data.GetData());
+
+    data.EmplaceData(3, 'b');
+    REQUIRE(data.GetData() == "bbb");
+
+    data.SetData(std::move(taken));
+    auto moved = std::move(data).GetData();
+    REQUIRE(moved.data() == buffer);
+
+    RuntimeTextTransportSkipList transport;
+    RuntimeTextTransportSkipList::DataType parsed;
+    std::string source = "abc\n\nâbc\nabc and a line long enough to leave the small buffer";
+    transport.Parse(source, parsed);
+
+    auto before = allocationcount.load();
+    auto loc = parsed.GetLocation(9);
+    auto &location = parsed.GetLocation();
+    auto allocations = allocationcount.load() - before;
+
+    REQUIRE(allocations == 0);
+    REQUIRE(loc.LineOffset == 4); REQUIRE(loc.CharOffset == 1);
+    REQUIRE(location.SkipList.size() > 0);
+}
+
+TEST_CASE("Memory usage", "[Data][Location][Memory]") {
+    auto longname = std::string(100, 'r');
+
+    REQUIRE(LineLocation{}.GetMemoryUsage().Total() == 0);
+    REQUIRE(GlobalLocation{1, 1, "short"}.GetMemoryUsage().Total() == 0);
+    REQUIRE(GlobalLocation{1, 1, longname}.GetMemoryUsage().Locations > longname.size());
+
+    GlobalInnerLocation inner{0, 1, 1, longname};
+    inner.SkipList[5] = GlobalLocation{1, 6, longname};
+    auto innerusage = inner.GetMemoryUsage();
+    REQUIRE(innerusage.Locations > longname.size());
+    REQUIRE(innerusage.SkipLists > longname.size() + sizeof(GlobalLocation));
+
+    TextTransport<>::DataType small;
+    TextTransportSimple.Parse("abc", small);
+    REQUIRE(small.GetMemoryUsage().Total() == 0);
+
+    ParseStatisticsCollector collector;
+    RuntimeTextTransportSkipList transport;
+    RuntimeTextTransportSkipList::DataType parsed;
+    std::string source = "abc\n\nâbc\nabc and a line long enough to leave the small buffer";
+    transport.Parse(source, parsed);
+    REQUIRE(collector.Get().Parses == 0);
+
+    transport.SetStatisticsCollector(&collector);
+    transport.Parse(source, parsed);
+    transport.Parse(source, parsed);
+
+    auto usage = parsed.GetMemoryUsage();
+    REQUIRE(usage.Payload > parsed.GetData().size());
+    REQUIRE(usage.SkipLists >= parsed.GetLocation().SkipList.size() * sizeof(std::pair<size_t, GlobalLocation>));
+    REQUIRE(usage.Containers == 0);
+    REQUIRE(usage.Locations == 0);
+
+    auto stats = collector.Get();
+    REQUIRE(stats.Parses == 2);
+    REQUIRE(stats.PeakScratchSize > source.size());
+    REQUIRE(stats.SkipListEntries == 2 * parsed.GetLocation().SkipList.size());
+
+    //batch workers record to the collector of the transport
+    collector.Reset();
+    auto sources = std::vector<std::string>(16, source);
+    auto results = ParseBatch(transport, sources, 4);
+    REQUIRE(collector.Get().Parses == 16);
+    REQUIRE(collector.Get().SkipListEntries == 16 * parsed.GetLocation().SkipList.size());
+
+    MapData<OrderedHashMap<std::string, std::string>> map;
+    map.SetMap({{"name", longname}});
+    REQUIRE(map.GetMemoryUsage().Containers > longname.size() + sizeof(std::pair<std::string, std::string>));
+}
+
+TEST_CASE("Test text reader arena", "[Parse][Text][SkipList][Allocation]") {
+    pmr::RuntimeTextTransportSkipList transport;
+    pmr::RuntimeTextTransportSkipList::ScratchType scratch;
+
+    std::string source = "abc\n\nâbc\nabc and a line long enough to leave the small buffer";
+    pmr::RuntimeTextTransportSkipList::DataType warmup;
+    transport.Parse(source, warmup, scratch);
+
+    std::array<std::byte, 16 * 1024> buffer;
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+
+    auto before = allocationcount.load();
+    {
+        pmr::RuntimeTextTransportSkipList::DataType data(&arena);
+        transport.Parse(source, data, scratch);
+
+        REQUIRE(data.GetData() == "abc\nâbc abc and a line long enough to leave the small buffer");
+        REQUIRE(data.GetData().get_allocator().resource() == &arena);
+        REQUIRE(data.GetLocation().SkipList.get_allocator().resource() == &arena);
+
+        auto loc = data.GetLocation(9);
+        REQUIRE(loc.LineOffset == 4); REQUIRE(loc.CharOffset == 1);
+    }
+    auto allocations = allocationcount.load() - before;
+
+    REQUIRE(allocations == 0);
+
+    Path path(&arena);
+    path.entries.emplace_back(Path::Map, "key"sv);
+    path.entries.back().attributes.emplace("name", "a value long enough to leave the small buffer");
+    REQUIRE(path.entries.back().attributes.get_allocator().resource() == &arena);
+}
+
+TEST_CASE("Test text reader view", "[Parse][Text][View]") {
+    ViewTextTransport transport;
+    ViewTextTransport::DataType data;
+
+    std::string source = "Hello\nWorld";
+    transport.Parse(source, data);
+    REQUIRE(data.GetData() == "Hello\nWorld");
+    REQUIRE(data.GetData().data() == source.data());
+
+    std::string target;
+    transport.SetWrapWidth(3);
+    transport.Emit(data, target);
+    REQUIRE(target == "Hello\n\nWorld");
+}
+
 TEST_CASE("Test text reader skiplist", "[Parse][Text][SkipList]") {
     RuntimeTextTransportSkipList transport;
     RuntimeTextTransportSkipList::DataType data;
@@ -168,6 +671,202 @@ TEST_CASE("Test text reader skiplist", "[Parse][Text][SkipList]") {
     REQUIRE(loc.LineOffset == 3); REQUIRE(loc.CharOffset == 1);
 }
 
+TEST_CASE("Test text reader reuse", "[Parse][Text][SkipList][Allocation]") {
+    RuntimeTextTransportSkipList transport;
+    RuntimeTextTransportSkipList::DataType data;
+    RuntimeTextTransportSkipList::ScratchType scratch;
+
+    std::string source = "a \xc2\xa0lâd\t c\xc2\xa0 g\n x \nZ and a line long enough to leave the small buffer";
+    std::string shorter = "abc\n\nâbc\nabc";
+
+    auto parseall = [&] {
+        transport.Parse(source, data, scratch);
+        transport.Parse(shorter, data, scratch);
+        transport.Parse(source, data, scratch);
+    };
+
+    SECTION("Folding and glue") {
+        parseall();
+
+        auto before = allocationcount.load();
+        parseall();
+        auto allocations = allocationcount.load() - before;
+
+        REQUIRE(allocations == 0);
+        REQUIRE(data.GetData() == "a lâd\tc\xc2\xa0g x Z and a line long enough to leave the small buffer");
+
+        auto loc = data.GetLocation(12);
+        REQUIRE(loc.LineOffset == 2); REQUIRE(loc.CharOffset == 2);
+    }
+
+    SECTION("Escape") {
+        transport.SetFolding(false);
+        transport.SetGlue(false);
+        transport.SetEscape(true);
+        source = "tab\\there and a line long enough to leave the small buffer";
+        parseall();
+
+        auto before = allocationcount.load();
+        parseall();
+        auto allocations = allocationcount.load() - before;
+
+        REQUIRE(allocations == 0);
+        REQUIRE(data.GetData() == "tab\there and a line long enough to leave the small buffer");
+
+        auto loc = data.GetLocation(4);
+        REQUIRE(loc.LineOffset == 1); REQUIRE(loc.CharOffset == 6);
+    }
+}
+
+TEST_CASE("Test text reader lazy", "[Parse][Text][SkipList][Lazy]") {
+    //only traits that allow lazy nodes store them
+    static_assert(RuntimeTextTransportSkipList::DataType::DataTraits::HasLazy());
+    static_assert(!YamlTransport<>::DataType::DataTraits::HasLazy());
+    static_assert(!IniTransport<>::DataType::DataTraits::HasLazy());
+
+    RuntimeTextTransportSkipList transport;
+    RuntimeTextTransportSkipList::DataType data;
+
+    std::string_view source = "a \xc2\xa0lâd\t c\xc2\xa0 g\n x \nZ";
+
+    auto before = allocationcount.load();
+    transport.ParseLazy(source, data);
+    auto allocations = allocationcount.load() - before;
+
+    REQUIRE(allocations == 0);
+    REQUIRE(data.GetLocation().ByteOffset == 0);
+    REQUIRE(data.GetLocation().LineOffset == 1);
+
+    //options are captured at parse time
+    transport.SetFolding(false);
+
+    const auto &constdata = data;
+    REQUIRE(constdata.GetData() == "a lâd\tc\xc2\xa0g x Z");
+
+    auto loc = data.GetLocation(12);
+    REQUIRE(loc.LineOffset == 2); REQUIRE(loc.CharOffset == 2);
+
+    auto copy = RuntimeTextTransportSkipList::DataType{};
+    transport.ParseLazy(source, copy);
+    copy = RuntimeTextTransportSkipList::DataType(copy);
+    REQUIRE(copy.TakeData() == "a \xc2\xa0lâd\t c\xc2\xa0 g  x  Z");
+}
+
+TEST_CASE("Test text escapes", "[Parse][Emit][Text][Escape]") {
+    RuntimeTextTransportSkipList transport;
+    RuntimeTextTransportSkipList::DataType data;
+
+    transport.SetEscape(true);
+    transport.SetFolding(false);
+    transport.SetGlue(false);
+
+    std::string source = "a\\tb\\u00e9c\nd\\\\e\\qf";
+    transport.Parse(source, data);
+    REQUIRE(data.GetData() == "a\tb\xc3\xa9" "c\nd\\e\\qf");
+
+    auto loc = data.GetLocation(1);
+    REQUIRE(loc.LineOffset == 1); REQUIRE(loc.CharOffset == 2);
+
+    loc = data.GetLocation(2);
+    REQUIRE(loc.LineOffset == 1); REQUIRE(loc.CharOffset == 4);
+
+    loc = data.GetLocation(5);
+    REQUIRE(loc.LineOffset == 1); REQUIRE(loc.CharOffset == 11);
+
+    loc = data.GetLocation(7);
+    REQUIRE(loc.LineOffset == 2); REQUIRE(loc.CharOffset == 1);
+
+    loc = data.GetLocation(9);
+    REQUIRE(loc.LineOffset == 2); REQUIRE(loc.CharOffset == 4);
+
+    //same locations through per character parsing
+    transport.SetGlue(true);
+    transport.Parse(source, data);
+    REQUIRE(data.GetData() == "a\tb\xc3\xa9" "c d\\e\\qf");
+
+    loc = data.GetLocation(5);
+    REQUIRE(loc.LineOffset == 1); REQUIRE(loc.CharOffset == 11);
+
+    loc = data.GetLocation(9);
+    REQUIRE(loc.LineOffset == 2); REQUIRE(loc.CharOffset == 4);
+
+    std::string target;
+    transport.Emit(data, target);
+    REQUIRE(target == "a\\tb\xc3\xa9" "c d\\\\e\\\\qf");
+}
+
+namespace {
+    /// Settings written before Escape was added
+    struct LegacyTextSettings {
+        constexpr static auto SkipList = YesNoRuntime::No;
+        constexpr static auto Folding = YesNoRuntime::No;
+        constexpr static auto Glue = YesNoRuntime::No;
+        constexpr static auto WordWrap = YesNoRuntime::No;
+
+        using DataTraits = TextDataTraits<NoLocation>;
+        using DataType   = Data<DataTraits>;
+    };
+}
+
+TEST_CASE("Test text escape round trip", "[Parse][Emit][Text][Escape]") {
+    static_assert(TextSettingsConcept<LegacyTextSettings>);
+    static_assert(TextTransport<LegacyTextSettings>::Escape == YesNoRuntime::No);
+
+    RuntimeTextTransportSkipList transport;
+    RuntimeTextTransportSkipList::DataType data;
+
+    transport.SetEscape(true);
+    transport.SetFolding(false);
+    transport.SetGlue(false);
+    transport.SetWordWrap(false);
+
+    //every decoded escape is written back in the same form, except line feeds which are
+    //written as line breaks
+    std::string source = "line\\none\\0two\\tthree\\\\four\\rfive\\u0001";
+    transport.Parse(source, data);
+    REQUIRE(data.GetData() == std::string("line\none\0two\tthree\\four\rfive\x01", 29));
+
+    std::string target;
+    transport.Emit(data, target);
+    REQUIRE(target == "line\none\\0two\\tthree\\\\four\\rfive\\u0001");
+
+    auto reparsed = data;
+    transport.Parse(target, reparsed);
+    REQUIRE(reparsed.GetData() == data.GetData());
+
+    //line breaks of the source are normalized as in per character parsing
+    std::string crlf = "a\r\nb\\tc\rd";
+    transport.Parse(crlf, data);
+    REQUIRE(data.GetData() == "a\nb\tc\nd");
+
+    auto loc = data.GetLocation(4);
+    REQUIRE(loc.LineOffset == 2); REQUIRE(loc.CharOffset == 4);
+
+    loc = data.GetLocation(6);
+    REQUIRE(loc.LineOffset == 3); REQUIRE(loc.CharOffset == 1);
+
+    target.clear();
+    transport.Emit(data, target);
+    REQUIRE(target == "a\nb\\tc\nd");
+
+    std::string reflowed;
+    transport.SetReflowWindow(3);
+    transport.Reflow(crlf, reflowed);
+    REQUIRE(reflowed == target);
+
+    //paragraphs stay on separate lines when glued lines are escaped again
+    transport.SetGlue(true);
+    reflowed.clear();
+    std::string paragraphs = "first\nparagraph\n\nsecond\\tparagraph\n\nthird";
+    transport.Reflow(paragraphs, reflowed);
+    REQUIRE(reflowed == "first paragraph\nsecond\\tparagraph\nthird");
+
+    TextTransport<LegacyTextSettings> legacy;
+    TextTransport<LegacyTextSettings>::DataType legacydata;
+    legacy.Parse(source, legacydata);
+    REQUIRE(legacydata.GetData() == source);
+}
+
 TEST_CASE("Test text emit simple", "[Emit][Text]") {
     std::string target;
     TextTransport<>::DataType data;
@@ -202,6 +901,1197 @@ TEST_CASE("Test text emit word wrap", "[Emit][Text][WordWrap]") {
     REQUIRE(ss.str() == "# I\n\n\n# S if");
 }
 
+TEST_CASE("Test text emit word wrap unicode", "[Emit][Text][WordWrap]") {
+    std::string target;
+    RuntimeTextTransport::DataType data;
+    RuntimeTextTransport transport;
+
+
+    transport.SetWrapWidth(5);
+
+    data.SetData("H\xc3\xa9llo w\xc3\xb6rld\xc2\xa0" "ab"); //c2a0 is non-breaking space
+    transport.Emit(data, target);
+    REQUIRE(target == "H\xc3\xa9llo\nw\xc3\xb6rld\nab");
+
+    //words longer than wrap width are not broken
+    transport.SetWrapWidth(4);
+
+    target = "";
+    data.SetData("abcdefgh ij\n\nkl mn");
+    transport.Emit(data, target);
+    REQUIRE(target == "abcdefgh\nij\n\n\nkl\nmn");
+}
+
+TEST_CASE("Test text emit parallel word wrap", "[Emit][Text][WordWrap][Parallel]") {
+    RuntimeTextTransport::DataType data;
+    RuntimeTextTransport transport;
+
+    std::string source;
+    for(int i = 0; i < 20000; i++) {
+        source += "Lorem ipsum dolor sit amet, consectetur \xc3\xa2" "dipiscing elit.";
+        source += i % 3 ? "\n" : "\n\n";
+    }
+    data.SetData(source);
+
+    transport.SetWrapWidth(17);
+
+    std::string expected;
+    transport.Emit(data, expected);
+
+    transport.SetEmitThreads(4);
+
+    std::string target;
+    transport.Emit(data, target);
+    REQUIRE(target == expected);
+}
+
+TEST_CASE("Test text reflow", "[Parse][Emit][Text][Reflow]") {
+    RuntimeTextTransport transport;
+
+    std::string source;
+    for(int i = 0; i < 2000; i++) {
+        source += "Lorem  ipsum dolor\nsit amet,\tconsectetur.";
+        source += i % 3 ? "\n" : "\n\n";
+    }
+
+    transport.SetWrapWidth(13);
+    transport.SetReflowWindow(100);
+
+    std::string expected;
+    transport.Emit(transport.Parse(source), expected);
+
+    std::stringstream ss{source}, target;
+    transport.Reflow(ss, target);
+    REQUIRE(target.str() == expected);
+
+    transport.SetFolding(false);
+    transport.SetGlue(false);
+    transport.SetReflowThreaded(true);
+
+    expected = "";
+    transport.Emit(transport.Parse(source), expected);
+    
+    std::string threaded;
+    transport.Reflow(source, threaded);
+    REQUIRE(threaded == expected);
+}
+
+TEST_CASE("Test batch parse", "[Parse][Text][Batch]") {
+    RuntimeTextTransportSkipList transport;
+
+    std::vector<std::string> sources;
+    for(int i = 0; i < 200; i++)
+        sources.push_back("line " + std::to_string(i) + "\n  next\n\nparagraph" + std::string(static_cast<size_t>(i), 'x'));
+
+    for(size_t threads : {size_t{1}, size_t{4}, size_t{0}}) {
+        auto results = ParseBatch(transport, sources, threads);
+        REQUIRE(results.size() == sources.size());
+
+        for(size_t i = 0; i < sources.size(); i++) {
+            RuntimeTextTransportSkipList::DataType expected;
+            transport.Parse(sources[i], expected);
+
+            REQUIRE(results[i].Succeeded());
+            REQUIRE(results[i].data.GetData() == expected.GetData());
+            REQUIRE(results[i].data.GetLocation(8).LineOffset == expected.GetLocation(8).LineOffset);
+        }
+    }
+
+    std::stringstream stream("from stream");
+    std::vector<std::variant<std::string, std::filesystem::path, std::istream*>> mixed = {
+        "from buffer"s, std::filesystem::path("/nonexistent/cpp-serializer/file.txt"), &stream
+    };
+
+    auto results = ParseBatch(transport, mixed, 2);
+    REQUIRE(results[0].Succeeded());
+    REQUIRE(results[0].data.GetData() == "from buffer");
+    REQUIRE_FALSE(results[1].Succeeded());
+    REQUIRE_THROWS_AS(std::rethrow_exception(results[1].error), std::runtime_error);
+    REQUIRE(results[2].Succeeded());
+    REQUIRE(results[2].data.GetData() == "from stream");
+
+    //files are opened by the workers
+    auto directory = std::filesystem::temp_directory_path() / ("cpp-serializer-batch-" + std::to_string(std::random_device{}()));
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::filesystem::path> paths;
+    for(size_t i = 0; i < 20; i++) {
+        paths.push_back(directory / ("file" + std::to_string(i) + ".txt"));
+        std::ofstream(paths.back(), std::ios::binary) << sources[i];
+    }
+
+    auto fileresults = ParseBatch(transport, paths, 4);
+    std::filesystem::remove_all(directory);
+
+    REQUIRE(fileresults.size() == paths.size());
+    for(size_t i = 0; i < paths.size(); i++) {
+        REQUIRE(fileresults[i].Succeeded());
+        REQUIRE(fileresults[i].data.GetData() == transport.Parse(sources[i]).GetData());
+    }
+
+    //an exception in a worker thread is rethrown on the calling thread after joining
+    std::atomic<size_t> processed{0};
+    REQUIRE_THROWS_AS(
+        internal::RunWorkers(100, 4, [&](size_t id, internal::WorkStealingScheduler &scheduler) {
+            if(id == 2)
+                throw std::runtime_error("worker");
+
+            while(scheduler.Next(id))
+                processed++;
+        }),
+        std::runtime_error
+    );
+    REQUIRE(processed.load() == 100);
+}
+
+TEST_CASE("Snapshot", "[Data][Snapshot]") {
+    using DataType = RuntimeTextTransport::DataType;
+    using Map      = SnapshotMap<std::string, DataType>;
+
+    RuntimeTextTransport transport;
+    
+    auto parse = [&](const std::string &text) {
+        return transport.Parse(text);
+    };
+
+    auto entries = std::vector<std::pair<std::string, DataType>>{};
+    for(int i = 0; i < 100; i++)
+        entries.emplace_back("key" + std::to_string(i), parse("value " + std::to_string(i)));
+
+    auto first = Map{}.Reload(entries);
+    REQUIRE(first.size() == 100);
+    REQUIRE(first.Find("key42")->GetData() == "value 42");
+    REQUIRE(first.Find("key100") == nullptr);
+
+    SECTION("Reload shares unchanged data") {
+        entries[3].second = parse("changed");
+        entries.pop_back();
+        entries.emplace_back("added", parse("new"));
+
+        auto second = first.Reload(entries);
+
+        REQUIRE(second.size() == 100);
+        REQUIRE(second.Find("key42") == first.Find("key42"));
+        REQUIRE(second.Find("key3") != first.Find("key3"));
+        REQUIRE(second.Find("key3")->GetData() == "changed");
+        REQUIRE(first.Find("key3")->GetData() == "value 3");
+        REQUIRE_FALSE(second.KeyExists("key99"));
+        REQUIRE(first.KeyExists("key99"));
+        REQUIRE(second.Find("added")->GetData() == "new");
+
+        auto count = size_t{0};
+        second.ForEach([&](const std::string &, const DataType &) { count++; });
+        REQUIRE(count == 100);
+    }
+
+    SECTION("Hash collisions") {
+        struct ConstantHash {
+            size_t operator()(int) const { return 7; }
+        };
+
+        auto map = SnapshotMap<int, DataType, ConstantHash>{};
+        for(int i = 0; i < 10; i++)
+            map = map.Set(i, parse(std::to_string(i)));
+
+        auto erased = map.Erase(3).Erase(5);
+        REQUIRE(erased.size() == 8);
+        REQUIRE(map.size() == 10);
+        REQUIRE_FALSE(erased.KeyExists(3));
+        REQUIRE(erased.Find(9)->GetData() == "9");
+        REQUIRE(map.Find(3)->GetData() == "3");
+    }
+
+    SECTION("Concurrent readers") {
+        auto shared = SharedSnapshot<Map>(std::make_shared<const Map>(first.Set("key1", parse("value 0"))));
+        auto stop   = std::atomic<bool>{false};
+        auto errors = std::atomic<size_t>{0};
+
+        auto readers = std::vector<std::thread>{};
+        for(int i = 0; i < 4; i++) {
+            readers.emplace_back([&] {
+                while(!stop) {
+                    //both keys are updated together in every version
+                    auto version = shared.Load();
+                    if(version->Find("key0")->GetData() != version->Find("key1")->GetData())
+                        errors++;
+                }
+            });
+        }
+
+        for(int i = 0; i < 100; i++) {
+            shared.Update([&](const std::shared_ptr<const Map> &current) {
+                auto value = std::to_string(i);
+                return current->Set("key0", parse(value)).Set("key1", parse(value));
+            });
+        }
+
+        stop = true;
+        for(auto &reader : readers)
+            reader.join();
+
+        REQUIRE(errors == 0);
+        REQUIRE(shared.Load()->Find("key1")->GetData() == "99");
+        REQUIRE(shared.Load()->Find("key42") == first.Find("key42"));
+    }
+}
+
+TEST_CASE("Test ini parse", "[Parse][Ini]") {
+    std::string source = 
+        "; global settings\n"
+        "name = cpp-serializer\r\n"
+        "\n"
+        "[server]\n"
+        "  host=localhost\n"
+        "\tport = 8080 ; not a comment by default\n"
+        "flag\n"
+        "[ âccents ]\n"
+        "âkey = \"  quoted ; value  \"\n"
+        "[server]\n"
+        "port = 9090\n";
+
+    RuntimeIniTransport transport;
+    auto data = transport.Parse(source);
+
+    REQUIRE(data.IsMap());
+    REQUIRE(data.GetMap().size() == 3);
+    REQUIRE(data.GetMap().at("name").GetData() == "cpp-serializer");
+
+    auto &server = data.GetMap().at("server");
+    REQUIRE(server.GetMap().at("host").GetData() == "localhost");
+    REQUIRE(server.GetMap().at("port").GetData() == "9090");
+    REQUIRE(server.GetMap().at("flag").GetData() == "");
+    REQUIRE(server.GetLocation().LineOffset == 4);
+
+    auto hostlocation = server.GetKeyLocation("host");
+    REQUIRE(hostlocation);
+    REQUIRE(hostlocation->LineOffset == 5); REQUIRE(hostlocation->CharOffset == 3);
+    REQUIRE(server.GetKeyLocation("port")->LineOffset == 11);
+    REQUIRE(server.GetKeyLocation("unknown") == nullptr);
+
+    auto &accents = data.GetMap().at("âccents");
+    REQUIRE(data.GetKeyLocation("âccents")->CharOffset == 3);
+    REQUIRE(accents.GetMap().at("âkey").GetData() == "  quoted ; value  ");
+
+    auto &value = accents.GetMap().at("âkey");
+    REQUIRE(value.GetLocation().LineOffset == 9); REQUIRE(value.GetLocation().CharOffset == 9);
+
+    transport.SetInlineComments(true);
+    transport.Parse(source, data);
+    REQUIRE(data.GetMap().at("server").GetMap().at("port").GetData() == "9090");
+    REQUIRE(data.GetMap().at("âccents").GetMap().at("âkey").GetData() == "  quoted ; value  ");
+
+    std::string ported = "[a]\nx = 1 ; comment\n";
+    REQUIRE(transport.Parse(ported).GetMap().at("a").GetMap().at("x").GetData() == "1");
+
+    std::string broken = "[section\nkey = value\n";
+    REQUIRE_THROWS_AS(transport.Parse(broken), std::runtime_error);
+}
+
+TEST_CASE("Test ini view parse", "[Parse][Ini][View]") {
+    std::string_view source = "[section]\nkey = value\n";
+
+    ViewIniTransport transport;
+    ViewIniTransport::DataType data;
+
+    transport.Parse(source, data);
+
+    auto &section = data.GetMap().at("section");
+    auto &value   = section.GetMap().at("key").GetData();
+    REQUIRE(value == "value");
+    REQUIRE(value.data() == source.data() + 16);
+    REQUIRE(data.GetMap().begin()->first.data() == source.data() + 1);
+}
+
+TEST_CASE("Test ini emit", "[Emit][Ini]") {
+    std::string source = "global = 1\n[b]\nkey = \" padded\"\nother = x\n[a]\nkey = 2\n";
+    
+    auto data = IniTransportSimple.Parse(source);
+
+    std::string out;
+    IniTransportSimple.Emit(data, out);
+    REQUIRE(out == "global = 1\n\n[b]\nkey = \" padded\"\nother = x\n\n[a]\nkey = 2\n");
+
+    auto again = IniTransportSimple.Parse(out);
+    REQUIRE(again == data);
+
+    data.GetMap().at("a").GetMap().at("key").SetData("line\nbreak");
+    std::string failed;
+    REQUIRE_THROWS_AS(IniTransportSimple.Emit(data, failed), std::invalid_argument);
+
+    //quotes that do not appear in the value are chosen
+    auto quoted = IniTransport<>::DataType{};
+    quoted.EmplaceMap();
+    quoted.GetMap()["double"].SetData("\"a\" ; \"b\""s);
+    quoted.GetMap()["single"].SetData("'x'"s);
+    quoted.GetMap()["plain"].SetData("a\"b"s);
+
+    out.clear();
+    IniTransportSimple.Emit(quoted, out);
+    REQUIRE(out == "double = '\"a\" ; \"b\"'\nsingle = \"'x'\"\nplain = a\"b\n");
+    REQUIRE(IniTransportSimple.Parse(out) == quoted);
+
+    auto rejected = [](std::string key, std::string value) {
+        auto map = IniTransport<>::DataType{};
+        map.EmplaceMap();
+        map.GetMap()[key].SetData(std::move(value));
+
+        std::string target;
+        REQUIRE_THROWS_AS(IniTransportSimple.Emit(map, target), std::invalid_argument);
+    };
+
+    rejected("a=b", "x");
+    rejected("a\nb", "x");
+    rejected("[a", "x");
+    rejected(";a", "x");
+    rejected("#a", "x");
+    rejected(" a", "x");
+    rejected("both", "\"a\" ; 'b'");
+
+    auto section = IniTransport<>::DataType{};
+    section.EmplaceMap();
+    section.GetMap()["a]b"].EmplaceMap();
+    out.clear();
+    REQUIRE_THROWS_AS(IniTransportSimple.Emit(section, out), std::invalid_argument);
+}
+
+TEST_CASE("Test ini events", "[Parse][Ini]") {
+    std::string source = "name = x\n[server]\nhost = localhost\nport = 80\n[client]\nport = 81\n";
+
+    std::vector<std::string> events;
+    auto record = [&](const Context<LineLocation> &context, std::string_view value) {
+        std::string path;
+        for(auto &entry : context.path.entries)
+            path += std::string(std::get<std::string_view>(entry.entry)) + "/";
+
+        events.push_back(path + std::string(value) + "@" + std::to_string(context.location.LineOffset));
+    };
+
+    IniTransportSimple.ParseEvents(source, record);
+    REQUIRE(events == std::vector<std::string>{"name/x@1", "server/host/localhost@3", "server/port/80@4", "client/port/81@6"});
+
+    //stops at the requested value
+    std::string_view port;
+    IniTransportSimple.ParseEvents(source, [&](const Context<LineLocation> &context, std::string_view value) {
+        if(context.path.entries.size() == 2 && std::get<std::string_view>(context.path.entries[1].entry) == "port") {
+            port = value;
+            return false;
+        }
+
+        return true;
+    });
+    REQUIRE(port == "80");
+    REQUIRE(port.data() == source.data() + 42);
+
+    //streams are read in chunks, lines crossing chunks should be intact
+    std::string large;
+    for(int i = 0; i < 3000; i++)
+        large += "[section" + std::to_string(i) + "]\nkey = value" + std::to_string(i) + "\n";
+
+    events.clear();
+    std::istringstream stream(large);
+    IniTransportSimple.ParseEvents(stream, record);
+
+    std::vector<std::string> expected = std::move(events);
+    events.clear();
+    IniTransportSimple.ParseEvents(large, record);
+
+    REQUIRE(expected.size() == 3000);
+    REQUIRE(events == expected);
+    REQUIRE(events.back() == "section2999/key/value2999@6000");
+}
+
+TEST_CASE("Test ini section index", "[Parse][Ini]") {
+    std::string source =
+        "root = 1\n"
+        "[zeta]\n"
+        "a = 1\n"
+        "  [ alpha ]\n"
+        "b = 2\n"
+        "\n"
+        "[zeta]\n"
+        "c = 3";
+
+    RuntimeIniTransport transport;
+    auto index = transport.IndexSections(source);
+
+    REQUIRE(index.GetEntries().size() == 3);
+    REQUIRE(index.GetEntries()[0].Name == "alpha");
+    REQUIRE(index.Find("zeta").size() == 2);
+    REQUIRE_FALSE(index.SectionExists("missing"));
+
+    RuntimeIniTransport::DataType section;
+    REQUIRE(transport.ParseSection(source, index, "zeta", section));
+    REQUIRE(section.GetMap().size() == 2);
+    REQUIRE(section.GetMap().at("a").GetData() == "1");
+    REQUIRE(section.GetMap().at("c").GetData() == "3");
+    REQUIRE(section.GetMap().at("c").GetLocation().LineOffset == 8);
+    REQUIRE(section.GetKeyLocation("a")->LineOffset == 3);
+    REQUIRE(section.GetLocation().LineOffset == 2);
+
+    REQUIRE(transport.ParseSection(source, index, "alpha", section));
+    REQUIRE(section.GetMap().size() == 1);
+    REQUIRE(section.GetLocation().LineOffset == 4); REQUIRE(section.GetLocation().CharOffset == 5);
+    REQUIRE(section.GetMap().at("b").GetLocation().LineOffset == 5);
+
+    //sections parsed through the index match the full parse
+    auto full = transport.Parse(source);
+    REQUIRE(section == full.GetMap().at("alpha"));
+    REQUIRE_FALSE(transport.ParseSection(source, index, "root", section));
+
+    std::stringstream stored;
+    index.Save(stored);
+    auto loaded = IniSectionIndex::Load(stored);
+    REQUIRE(loaded == index);
+
+    std::string changed = source + "\nd = 4\n";
+    REQUIRE_THROWS_AS(transport.ParseSection(changed, loaded, "zeta", section), std::runtime_error);
+
+    std::stringstream invalid("not an index");
+    REQUIRE_THROWS_AS(IniSectionIndex::Load(invalid), std::runtime_error);
+
+    //damaged indexes are rejected while loading
+    auto load = [](const std::string &text) {
+        std::stringstream input(text);
+        return IniSectionIndex::Load(input);
+    };
+
+    auto saved = stored.str();
+    REQUIRE(load(saved) == index);
+    REQUIRE_THROWS_AS(load(saved.substr(0, saved.size() - 10)), std::runtime_error);
+    REQUIRE_THROWS_AS(load("cppser-ini-index 1 50 1000000000000\n9 2 2 16 24 zeta\n"), std::runtime_error);
+    REQUIRE_THROWS_AS(load("cppser-ini-index 1 50 1\n9 2 2 16 60 zeta\n"), std::runtime_error);
+    REQUIRE_THROWS_AS(load("cppser-ini-index 1 50 1\n9 2 2 30 24 zeta\n"), std::runtime_error);
+    REQUIRE_THROWS_AS(load("cppser-ini-index 1 50 1\n90 2 2 16 24 zeta\n"), std::runtime_error);
+    REQUIRE_THROWS_AS(load("cppser-ini-index 1 50 2\n9 2 2 16 24 zeta\n0 1 1 4 8 alpha\n"), std::runtime_error);
+    REQUIRE(load("cppser-ini-index 1 50 1\n9 2 2 16 24 zeta\n").GetEntries().size() == 1);
+}
+
+TEST_CASE("Test yaml parse", "[Parse][Yaml]") {
+    std::string source = 
+        "# configuration\n"
+        "name: cpp-serializer\n"
+        "server:\n"
+        "  host: localhost   # comment\n"
+        "  ports:\n"
+        "  - 80\n"
+        "  - 443\n"
+        "users:\n"
+        "  - name: âlice\n"
+        "    roles: [admin, user]\n"
+        "  - {name: bob, roles: []}\n"
+        "empty:\n"
+        "multi: first\n"
+        "  second\n";
+
+    auto data = YamlTransportSimple.Parse(source);
+
+    REQUIRE(data.IsMap());
+    REQUIRE(data.GetMap().size() == 5);
+    REQUIRE(data.GetMap().at("name").GetData() == "cpp-serializer");
+    REQUIRE(data.GetMap().at("empty").GetData() == "");
+    REQUIRE(data.GetMap().at("multi").GetData() == "first second");
+
+    auto &server = data.GetMap().at("server");
+    REQUIRE(server.GetMap().at("host").GetData() == "localhost");
+
+    auto &ports = server.GetMap().at("ports");
+    REQUIRE(ports.IsSequence());
+    REQUIRE(ports.GetSequence().size() == 2);
+    REQUIRE(ports.GetSequence()[1].GetData() == "443");
+    REQUIRE(ports.GetSequence()[1].GetLocation().LineOffset == 7);
+    REQUIRE(ports.GetSequence()[1].GetLocation().CharOffset == 5);
+
+    auto &users = data.GetMap().at("users").GetSequence();
+    REQUIRE(users.size() == 2);
+    REQUIRE(users[0].GetMap().at("name").GetData() == "âlice");
+    REQUIRE(users[0].GetMap().at("roles").GetSequence()[1].GetData() == "user");
+    REQUIRE(users[0].GetKeyLocation("roles")->LineOffset == 10);
+    REQUIRE(users[0].GetKeyLocation("roles")->CharOffset == 5);
+    REQUIRE(users[1].GetMap().at("name").GetData() == "bob");
+    REQUIRE(users[1].GetMap().at("roles").GetSequence().empty());
+
+    REQUIRE(server.GetKeyLocation("ports")->LineOffset == 5);
+    REQUIRE(data.GetMap().at("users").GetLocation().LineOffset == 9);
+
+    std::string duplicate = "a: 1\nb: 2\na: 3\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(duplicate), std::runtime_error);
+
+    RuntimeYamlTransport transport;
+    transport.SetDuplicateKeys(true);
+    REQUIRE(transport.Parse(duplicate).GetMap().at("a").GetData() == "3");
+
+    std::string indentation = "a:\n  b: 1\n   c: 2\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(indentation), std::runtime_error);
+
+    std::string documents = "--- a\n--- b\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(documents), std::runtime_error);
+
+    std::string unterminated = "a: [1, 2\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(unterminated), std::runtime_error);
+}
+
+TEST_CASE("Test yaml scalars", "[Parse][Yaml]") {
+    std::string source = 
+        "---\n"
+        "plain: a b\n"
+        "single: 'it''s # not a comment'\n"
+        "double: \"tab\\there \\\"quoted\\\" \\u00e2\\x41\"\n"
+        "folded quote: \"first\n"
+        "  second\n"
+        "\n"
+        "  third\"\n"
+        "literal: |\n"
+        "  line 1\n"
+        "    indented\n"
+        "\n"
+        "folded: >-\n"
+        "  one\n"
+        "  two\n"
+        "\n"
+        "  three\n"
+        "keep: |+\n"
+        "  text\n"
+        "\n"
+        "last: !tag value\n"
+        "...\n";
+
+    auto data = YamlTransportSimple.Parse(source);
+    auto &map = data.GetMap();
+
+    REQUIRE(map.at("single").GetData() == "it's # not a comment");
+    REQUIRE(map.at("double").GetData() == "tab\there \"quoted\" âA");
+    REQUIRE(map.at("folded quote").GetData() == "first second\nthird");
+    REQUIRE(map.at("literal").GetData() == "line 1\n  indented\n");
+    REQUIRE(map.at("folded").GetData() == "one two\nthree");
+    REQUIRE(map.at("keep").GetData() == "text\n\n");
+    REQUIRE(map.at("last").GetData() == "value");
+    REQUIRE(map.at("literal").GetLocation().LineOffset == 9);
+
+    std::string colon = "plain: a: b\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(colon), std::runtime_error);
+
+    std::string scalar = "just a scalar";
+    REQUIRE(YamlTransportSimple.Parse(scalar).GetData() == "just a scalar");
+
+    std::string escape = "\"bad \\q\"";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(escape), std::runtime_error);
+}
+
+TEST_CASE("Test yaml events", "[Parse][Yaml]") {
+    std::string source = 
+        "name: test\n"
+        "items:\n"
+        "  - first\n"
+        "  - {key: \"va\\\"lue\", list: [a]}\n"
+        "last:\n";
+
+    auto pathof = [](const Context<LineLocation> &context) {
+        std::string path;
+
+        for(auto &entry : context.path.entries) {
+            if(auto key = std::get_if<std::string_view>(&entry.entry))
+                path += "/" + std::string(*key);
+            else
+                path += "/" + std::to_string(std::get<int>(entry.entry));
+        }
+
+        return path;
+    };
+
+    YamlEventReader reader(source);
+    std::vector<std::string> events;
+
+    while(reader.Next()) {
+        auto path = pathof(reader.GetContext());
+
+        switch(reader.GetType()) {
+        case YamlEventType::MappingStart:  events.push_back("{" + path); break;
+        case YamlEventType::MappingEnd:    events.push_back("}" + path); break;
+        case YamlEventType::SequenceStart: events.push_back("[" + path); break;
+        case YamlEventType::SequenceEnd:   events.push_back("]" + path); break;
+        case YamlEventType::Scalar:
+            events.push_back((reader.IsKey() ? "?" : "=") + path + " " + std::string(reader.GetValue()));
+            break;
+        default:
+            break;
+        }
+
+        if(reader.GetType() == YamlEventType::Scalar && reader.GetValue() == "a") {
+            REQUIRE(reader.GetContext().location.LineOffset == 4);
+            REQUIRE(reader.GetContext().location.CharOffset == 29);
+        }
+    }
+
+    REQUIRE(events == std::vector<std::string>{
+        "{", "? name", "=/name test", "? items", "[/items", "=/items/0 first", "{/items/1",
+        "?/items/1 key", "=/items/1/key va\"lue", "?/items/1 list", "[/items/1/list", "=/items/1/list/0 a",
+        "]/items/1/list", "}/items/1", "]/items", "? last", "=/last ", "}"
+    });
+
+    //streams are read before parsing
+    std::stringstream stream("- [1, 2]\n- 3\n");
+    YamlEventReader<LineLocation> streamreader(stream);
+    std::string last;
+
+    while(streamreader.Next()) {
+        if(streamreader.GetType() == YamlEventType::Scalar)
+            last = pathof(streamreader.GetContext()) + " " + std::string(streamreader.GetValue());
+    }
+
+    REQUIRE(last == "/1 3");
+
+    std::string broken = "a: [1, 2\n";
+    YamlEventReader brokenreader(broken);
+    REQUIRE_THROWS_AS([&] { while(brokenreader.Next()); }(), std::runtime_error);
+}
+
+TEST_CASE("Test yaml documents", "[Parse][Yaml][Batch]") {
+    std::string source = 
+        "# audit log\n"
+        "%YAML 1.2\n"
+        "---\n"
+        "user: alice\n"
+        "note: \"multi line\n"
+        "--- not a marker\"\n"
+        "---\n"
+        "text: |\n"
+        "  it's a block\n"
+        "  with a quote: \"\n"
+        "list: [a, 'b\n"
+        "  ---', c]\n"
+        "...\n"
+        "# between documents\n"
+        "bare: document\n"
+        "--- scalar\n"
+        "---\n"
+        "broken: [\n";
+
+    for(size_t threads : {size_t{1}, size_t{4}}) {
+        auto results = YamlTransportSimple.ParseDocuments(source, threads);
+
+        REQUIRE(results.size() == 5);
+        REQUIRE(results[0].Succeeded());
+        REQUIRE(results[0].data.GetMap().at("note").GetData() == "multi line --- not a marker");
+        REQUIRE(results[1].data.GetMap().at("text").GetData() == "it's a block\nwith a quote: \"\n");
+        REQUIRE(results[1].data.GetMap().at("list").GetSequence()[1].GetData() == "b ---");
+        REQUIRE(results[2].data.GetMap().at("bare").GetData() == "document");
+        REQUIRE(results[3].data.GetData() == "scalar");
+        REQUIRE_FALSE(results[4].Succeeded());
+        REQUIRE_THROWS_AS(std::rethrow_exception(results[4].error), std::runtime_error);
+
+        //locations are in the whole stream
+        REQUIRE(results[0].data.GetKeyLocation("user")->LineOffset == 4);
+        REQUIRE(results[1].data.GetMap().at("list").GetLocation().LineOffset == 11);
+        REQUIRE(results[1].data.GetMap().at("list").GetLocation().CharOffset == 7);
+        REQUIRE(results[2].data.GetKeyLocation("bare")->LineOffset == 15);
+        REQUIRE(results[3].data.GetLocation().LineOffset == 16);
+    }
+
+    //resource name and byte offsets
+    Source<std::string_view> named(source);
+    named.SetResourceName("audit.yaml");
+
+    YamlTransport<RuntimeYamlSettings<GlobalLocation>> globaltransport;
+    auto global = globaltransport.ParseDocuments(named, 2);
+    REQUIRE(global[3].data.GetLocation().ResourceName == "audit.yaml");
+    REQUIRE(global[3].data.GetLocation().LineOffset == 16);
+
+    YamlTransport<RuntimeYamlSettings<ByteLocation>> bytetransport;
+    REQUIRE(bytetransport.ParseDocuments(source)[3].data.GetLocation().ByteOffset == source.find("scalar"));
+
+    //same documents as a sequential parse
+    auto sequential = std::vector<size_t>{};
+    std::string valid = source.substr(0, source.rfind("---\nbroken"));
+    YamlEventReader reader(valid);
+
+    while(reader.Next()) {
+        if(reader.GetType() == YamlEventType::DocumentStart)
+            sequential.push_back(reader.GetContext().location.LineOffset);
+    }
+
+    REQUIRE(sequential == std::vector<size_t>{3, 7, 15, 16});
+
+    std::vector<std::string> items;
+    for(int i = 0; i < 200; i++)
+        items.push_back("---\nindex: " + std::to_string(i) + "\n");
+
+    std::string stream;
+    for(auto &item : items)
+        stream += item;
+
+    auto seen = std::vector<int>(items.size());
+    YamlTransportSimple.ParseDocuments(stream, [&](size_t index, auto &&result) {
+        REQUIRE(result.Succeeded());
+        REQUIRE(result.data.GetMap().at("index").GetData() == std::to_string(index));
+        REQUIRE(result.data.GetLocation().LineOffset == index * 2 + 2);
+        seen[index]++;
+    }, 4);
+
+    REQUIRE(seen == std::vector<int>(items.size(), 1));
+}
+
+TEST_CASE("Test yaml emit", "[Emit][Yaml]") {
+    std::string source = 
+        "name: cpp-serializer\n"
+        "server:\n"
+        "  host: localhost\n"
+        "  ports:\n"
+        "    - 80\n"
+        "    - 443\n"
+        "users:\n"
+        "  - name: alice\n"
+        "    roles: [admin]\n"
+        "  - - nested\n"
+        "    - []\n"
+        "empty: {}\n";
+
+    auto data = YamlTransportSimple.Parse(source);
+
+    std::string target;
+    YamlTransportSimple.Emit(data, target);
+
+    REQUIRE(target ==
+        "name: cpp-serializer\n"
+        "server:\n"
+        "  host: localhost\n"
+        "  ports:\n"
+        "    - 80\n"
+        "    - 443\n"
+        "users:\n"
+        "  - name: alice\n"
+        "    roles:\n"
+        "      - admin\n"
+        "  - - nested\n"
+        "    - []\n"
+        "empty: {}\n"
+    );
+
+    REQUIRE(YamlTransportSimple.Parse(target) == data);
+
+    using internal::ChooseYamlScalarStyle;
+    REQUIRE(ChooseYamlScalarStyle("plain text with a:colon and#hash") == YamlScalarStyle::Plain);
+    REQUIRE(ChooseYamlScalarStyle("http://example.com/long/path/to/resource") == YamlScalarStyle::Plain);
+    REQUIRE(ChooseYamlScalarStyle("") == YamlScalarStyle::SingleQuoted);
+    REQUIRE(ChooseYamlScalarStyle("- item") == YamlScalarStyle::SingleQuoted);
+    REQUIRE(ChooseYamlScalarStyle("a long value that ends with key:") == YamlScalarStyle::SingleQuoted);
+    REQUIRE(ChooseYamlScalarStyle("a long value with a # comment") == YamlScalarStyle::SingleQuoted);
+    REQUIRE(ChooseYamlScalarStyle("trailing ") == YamlScalarStyle::SingleQuoted);
+    REQUIRE(ChooseYamlScalarStyle("--- marker") == YamlScalarStyle::SingleQuoted);
+    REQUIRE(ChooseYamlScalarStyle("a long value with a\nline break") == YamlScalarStyle::DoubleQuoted);
+
+    //scalars that need quotes survive a round trip
+    auto values = std::vector<std::string>{
+        "", " padded ", "it's: quoted", "#comment", "[flow]", "line\nbreak\t\"q\"\\", std::string("nul\0byte", 8), "- x", "...",
+        "âccented text that is longer than a word"
+    };
+
+    YamlTransport<>::DataType sequence;
+
+    auto &items = sequence.EmplaceSequence();
+    for(auto &value : values)
+        items.emplace_back().SetData(value);
+
+    std::stringstream stream;
+    YamlTransportSimple.Emit(sequence, stream);
+
+    auto text = stream.str();
+    auto parsed = YamlTransportSimple.Parse(text);
+
+    REQUIRE(parsed.GetSequence().size() == values.size());
+    for(size_t i = 0; i < values.size(); i++)
+        REQUIRE(parsed.GetSequence()[i].GetData() == values[i]);
+
+    //deep nesting goes beyond the indentation buffer
+    YamlTransport<>::DataType deep;
+    auto *current = &deep;
+    for(int i = 0; i < 100; i++)
+        current = &current->EmplaceMap()["k"];
+    current->SetData("leaf");
+
+    target.clear();
+    YamlTransportSimple.Emit(deep, target);
+    REQUIRE(YamlTransportSimple.Parse(target) == deep);
+}
+
+TEST_CASE("Test yaml index", "[Parse][Yaml]") {
+    std::uint64_t carry = 0;
+
+    //each backslash escapes the next character, escaped backslashes do not
+    REQUIRE(internal::FindEscaped(0b0001, carry) == 0b0010);
+    REQUIRE(internal::FindEscaped(0b0011, carry) == 0b0010);
+    REQUIRE(internal::FindEscaped(0b0111, carry) == 0b1010);
+    REQUIRE(carry == 0);
+
+    //run that crosses the block boundary
+    REQUIRE(internal::FindEscaped(std::uint64_t{1} << 63, carry) == 0);
+    REQUIRE(carry == 1);
+    REQUIRE(internal::FindEscaped(0, carry) == 1);
+
+    //escaped quotes are removed from the index, quotes after escaped backslashes are not
+    std::string source = std::string(62, ' ') + "\\\"\\\\\"\n";
+
+    internal::YamlIndex index;
+    index.Build(source);
+
+    REQUIRE(index.Positions == std::vector<size_t>{66, 67, 68});
+}
+
+struct YamlTestEndpoint {
+    std::string host;
+    int port = 0;
+
+    static constexpr auto Fields = FieldTable{
+        CPPSER_FIELD(YamlTestEndpoint, host),
+        CPPSER_FIELD(YamlTestEndpoint, port)
+    };
+};
+
+struct YamlTestConfig {
+    std::string name;
+    bool enabled = false;
+    double ratio = 0;
+    unsigned mask = 0;
+    std::optional<int> retries = 5;
+    std::vector<YamlTestEndpoint> endpoints;
+    std::map<std::string, std::vector<std::string>> groups;
+    YamlTestEndpoint primary;
+};
+
+template<>
+inline constexpr auto CPP_SERIALIZER_NAMESPACE::StructFields<YamlTestConfig> = FieldTable{
+    CPPSER_FIELD(YamlTestConfig, name),
+    CPPSER_FIELD(YamlTestConfig, enabled),
+    CPPSER_FIELD(YamlTestConfig, ratio),
+    CPPSER_FIELD(YamlTestConfig, mask),
+    CPPSER_FIELD(YamlTestConfig, retries),
+    CPPSER_FIELD(YamlTestConfig, endpoints),
+    CPPSER_FIELD(YamlTestConfig, groups),
+    Field{"primary-endpoint", &YamlTestConfig::primary}
+};
+
+TEST_CASE("Test field table", "[helpers][Fields]") {
+    constexpr auto &table = StructFields<YamlTestConfig>;
+
+    static_assert(table.Find("primary-endpoint") == 7);
+    static_assert(table.Find("primary") == table.Size);
+
+    for(size_t i = 0; i < table.Size; i++)
+        REQUIRE(table.Find(table.GetName(i)) == i);
+
+    REQUIRE(table.Find("") == table.Size);
+    REQUIRE(table.Find("nam") == table.Size);
+
+    static_assert(FieldDescribedConcept<YamlTestEndpoint>);
+    static_assert(!FieldDescribedConcept<std::string>);
+}
+
+TEST_CASE("Test yaml load", "[Parse][Yaml][Fields]") {
+    std::string source =
+        "name: service\n"
+        "enabled: true\n"
+        "ratio: 0.25\n"
+        "mask: 0xff\n"
+        "retries: ~\n"
+        "endpoints:\n"
+        "  - host: a.example\n"
+        "    port: 80\n"
+        "    weight: 3\n"
+        "  - {host: b.example, port: +443}\n"
+        "groups:\n"
+        "  admins: [alice, bob]\n"
+        "  users: []\n"
+        "primary-endpoint:\n"
+        "  host: \"c.example\"\n"
+        "timeout:\n"
+        "  connect: 5\n";
+
+    YamlTestConfig config;
+    auto unknown = YamlTransportSimple.Load(source, config);
+
+    REQUIRE(config.name == "service");
+    REQUIRE(config.enabled);
+    REQUIRE(std::abs(config.ratio - 0.25) < 1e-12);
+    REQUIRE(config.mask == 255);
+    REQUIRE_FALSE(config.retries.has_value());
+    REQUIRE(config.endpoints.size() == 2);
+    REQUIRE(config.endpoints[0].host == "a.example");
+    REQUIRE(config.endpoints[0].port == 80);
+    REQUIRE(config.endpoints[1].port == 443);
+    REQUIRE(config.groups.at("admins") == std::vector<std::string>{"alice", "bob"});
+    REQUIRE(config.groups.at("users").empty());
+    REQUIRE(config.primary.host == "c.example");
+    REQUIRE(config.primary.port == 0);
+
+    REQUIRE(unknown.size() == 2);
+    REQUIRE(unknown[0].Key == "weight");
+    REQUIRE(unknown[0].Location.LineOffset == 9);
+    REQUIRE(unknown[0].Location.CharOffset == 5);
+    REQUIRE(unknown[1].Key == "timeout");
+    REQUIRE(unknown[1].Location.LineOffset == 16);
+
+    //locations contain the resource name
+    Source<std::string_view> named(source);
+    named.SetResourceName("config.yaml");
+
+    YamlTransport<RuntimeYamlSettings<GlobalLocation>> global;
+    auto globalunknown = global.Load(named, config);
+    REQUIRE(globalunknown.size() == 2);
+    REQUIRE(globalunknown[1].Location.ResourceName == "config.yaml");
+
+    std::string invalid = "port: eighty\n";
+    YamlTestEndpoint endpoint;
+    REQUIRE_THROWS_AS(YamlTransportSimple.Load(invalid, endpoint), std::runtime_error);
+
+    std::string quoted = "port: '12'\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Load(quoted, endpoint), std::runtime_error);
+
+    std::string large = "port: 99999999999\n";
+    REQUIRE_THROWS_WITH(YamlTransportSimple.Load(large, endpoint), "Number '99999999999' is out of range on line 1, character 7");
+
+    std::string mismatch = "endpoints: a.example\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Load(mismatch, config), std::runtime_error);
+
+    std::string duplicate = "host: a\nhost: b\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Load(duplicate, endpoint), std::runtime_error);
+
+    RuntimeYamlTransport transport;
+    transport.SetDuplicateKeys(true);
+    transport.Load(duplicate, endpoint);
+    REQUIRE(endpoint.host == "b");
+}
+
+TEST_CASE("Test yaml anchors", "[Parse][Yaml]") {
+    std::string source =
+        "defaults: &defaults\n"
+        "  adapter: postgres\n"
+        "  host: localhost\n"
+        "extra: &extra {pool: 5, host: extra.local}\n"
+        "development:\n"
+        "  <<: [*defaults, *extra]\n"
+        "  database: dev\n"
+        "  host: db.local\n"
+        "list: &list [a, b]\n"
+        "copy: *list\n"
+        "name: &name value\n"
+        "again: *name\n";
+
+    auto data = YamlTransportSimple.Parse(source);
+    auto &map = data.GetMap();
+
+    auto &development = map.at("development").GetMap();
+    REQUIRE(development.size() == 4);
+    REQUIRE(development.at("host").GetData() == "db.local");
+    REQUIRE(development.at("adapter").GetData() == "postgres");
+    REQUIRE(development.at("pool").GetData() == "5");
+    REQUIRE(map.at("development").GetKeyLocation("adapter")->LineOffset == 2);
+
+    //aliases share the anchored node
+    REQUIRE(map.at("copy").IsShared());
+    REQUIRE(&map.at("copy").Resolve() == &map.at("list").Resolve());
+    REQUIRE(map.at("copy").GetSequence()[1].GetData() == "b");
+    REQUIRE(map.at("copy").GetLocation().LineOffset == 10);
+    REQUIRE(map.at("again").GetData() == "value");
+
+    //modification detaches the alias
+    map.at("copy").GetSequence().emplace_back().SetData("c"s);
+    REQUIRE(map.at("copy").GetSequence().size() == 3);
+    REQUIRE(map.at("list").GetSequence().size() == 2);
+    REQUIRE(map.at("copy").GetSequence()[0].IsShared());
+
+    //emitted document has the aliases expanded
+    std::string emitted;
+    YamlTransportSimple.Emit(data, emitted);
+    REQUIRE(YamlTransportSimple.Parse(emitted) == data);
+
+    std::string unknown = "a: *missing\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(unknown), std::runtime_error);
+
+    std::string recursive = "a: &a [*a]\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(recursive), std::runtime_error);
+
+    std::string key = "&a key: value\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(key), std::runtime_error);
+
+    std::string merge = "a: &a x\nb:\n  <<: *a\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(merge), std::runtime_error);
+
+    //quoted << is an ordinary key and it stays quoted when emitted
+    std::string literal = "a:\n  '<<': x\n";
+    auto literaldata = YamlTransportSimple.Parse(literal);
+    REQUIRE(literaldata.GetMap().at("a").GetMap().at("<<").GetData() == "x");
+
+    std::string literalemitted;
+    YamlTransportSimple.Emit(literaldata, literalemitted);
+    REQUIRE(literalemitted == literal);
+    REQUIRE(YamlTransportSimple.Parse(literalemitted) == literaldata);
+}
+
+TEST_CASE("Test yaml tape", "[Parse][Yaml][Tape]") {
+    std::string source =
+        "defaults: &defaults\n"
+        "  adapter: postgres\n"
+        "  host: localhost\n"
+        "extra: &extra {pool: 5, host: extra.local}\n"
+        "development:\n"
+        "  <<: [*defaults, *extra]\n"
+        "  database: dev\n"
+        "  host: db.local\n"
+        "inline:\n"
+        "  <<: {a: 1, b: 2}\n"
+        "  b: 3\n"
+        "list: &list [a, b]\n"
+        "copy: *list\n";
+
+    auto tape = YamlTransportSimple.ParseTape(source);
+    auto root = tape.Root();
+    REQUIRE(root.size() == 6);
+
+    auto development = *root.Find("development");
+    REQUIRE(development.size() == 4);
+    REQUIRE(development.Find("host")->GetData() == "db.local");
+    REQUIRE(development.Find("adapter")->GetData() == "postgres");
+    REQUIRE(development.Find("adapter")->GetLocation().LineOffset == 2);
+    REQUIRE(development.Find("pool")->GetData() == "5");
+    REQUIRE_FALSE(development.KeyExists("<<"));
+
+    auto inlined = *root.Find("inline");
+    REQUIRE(inlined.size() == 2);
+    REQUIRE(inlined.Find("a")->GetData() == "1");
+    REQUIRE(inlined.Find("b")->GetData() == "3");
+
+    //aliases are copied, the copy has the location of the alias
+    auto copy = *root.Find("copy");
+    REQUIRE(copy.size() == 2);
+    REQUIRE(copy[1].GetData() == "b");
+    REQUIRE(copy.GetLocation().LineOffset == 13);
+    REQUIRE(copy[0].GetLocation().LineOffset == 12);
+
+    std::string keys;
+    for(int i = 99; i >= 0; i--)
+        keys += "key" + std::to_string(i) + ": " + std::to_string(i) + "\n";
+
+    auto keytape = YamlTransportSimple.ParseTape(keys);
+    auto map = keytape.Root();
+    for(int i = 0; i < 100; i++)
+        REQUIRE(map.Find("key" + std::to_string(i))->GetData() == std::to_string(i));
+
+    REQUIRE_FALSE(map.KeyExists("key100"));
+    REQUIRE(map[0].GetKey() == "key99");
+
+    std::string empty;
+    auto emptytape = YamlTransportSimple.ParseTape(empty);
+    REQUIRE(emptytape.Root().GetData().empty());
+
+    std::string duplicate = "a: 1\nb: 2\na: 3\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.ParseTape(duplicate), std::runtime_error);
+
+    RuntimeYamlTransport transport;
+    transport.SetDuplicateKeys(true);
+    auto duplicatetape = transport.ParseTape(duplicate);
+    REQUIRE(duplicatetape.Root().Find("a")->GetData() == "3");
+
+    std::string merge = "a: &a x\nb:\n  <<: *a\n";
+    REQUIRE_THROWS_AS(YamlTransportSimple.ParseTape(merge), std::runtime_error);
+
+    std::string laughs = "a: &a [x, y, z]\nb: &b [*a, *a, *a]\nc: [*b, *b, *b]\n";
+    YamlTransport<> budgeted;
+    budgeted.SetAliasNodeBudget(10);
+    REQUIRE_THROWS_AS(budgeted.ParseTape(laughs), std::runtime_error);
+}
+
+TEST_CASE("Test yaml alias budget", "[Parse][Yaml]") {
+    //each level refers to the previous one ten times, the last expands to 10^9 nodes
+    std::string laughs = "a: &l0 [lol, lol, lol, lol, lol, lol, lol, lol, lol, lol]\n";
+    for(int i = 1; i < 10; i++) {
+        auto ref = "*l" + std::to_string(i - 1);
+        laughs += "l" + std::to_string(i) + ": &l" + std::to_string(i) + " [";
+
+        for(int j = 0; j < 10; j++)
+            laughs += (j ? ", " : "") + ref;
+
+        laughs += "]\n";
+    }
+
+    REQUIRE_THROWS_AS(YamlTransportSimple.Parse(laughs), std::runtime_error);
+
+    //values of unknown keys are skipped without expanding their aliases
+    YamlTestConfig config;
+    REQUIRE(YamlTransportSimple.Load(laughs, config).size() == 10);
+
+    std::string small = "a: &a [x, y, z]\nb: *a\nc: *a\n";
+
+    YamlTransport<> transport;
+    transport.SetAliasNodeBudget(8);
+    REQUIRE_NOTHROW(transport.Parse(small));
+
+    transport.SetAliasNodeBudget(7);
+    REQUIRE_THROWS_AS(transport.Parse(small), std::runtime_error);
+
+    std::string groups = "groups: {a: &a [x, y, z], b: *a, c: *a}\n";
+    REQUIRE_THROWS_AS(transport.Load(groups, config), std::runtime_error);
+
+    transport.SetAliasNodeBudget(0);
+    transport.SetAliasByteBudget(5);
+    REQUIRE_THROWS_AS(transport.Parse(small), std::runtime_error);
+
+    transport.SetAliasByteBudget(6);
+    REQUIRE_NOTHROW(transport.Load(groups, config));
+    REQUIRE(config.groups.at("c").size() == 3);
+}
+
+TEST_CASE("Test yaml load aliases", "[Parse][Yaml][Fields]") {
+    std::string source =
+        "base: &base {host: a.example, port: 80, weight: 3}\n"
+        "endpoints:\n"
+        "  - *base\n"
+        "  - <<: *base\n"
+        "    port: 8080\n"
+        "groups:\n"
+        "  admins: &admins [alice]\n"
+        "  owners: *admins\n"
+        "primary-endpoint:\n"
+        "  port: 1\n"
+        "  <<: *base\n";
+
+    YamlTestConfig config;
+    auto unknown = YamlTransportSimple.Load(source, config);
+
+    REQUIRE(config.endpoints.size() == 2);
+    REQUIRE(config.endpoints[0].host == "a.example");
+    REQUIRE(config.endpoints[0].port == 80);
+    REQUIRE(config.endpoints[1].host == "a.example");
+    REQUIRE(config.endpoints[1].port == 8080);
+    REQUIRE(config.groups.at("owners") == std::vector<std::string>{"alice"});
+    REQUIRE(config.primary.host == "a.example");
+    REQUIRE(config.primary.port == 1);
+
+    //keys of replayed nodes are reported once
+    REQUIRE(unknown.size() == 2);
+    REQUIRE(unknown[0].Key == "base");
+    REQUIRE(unknown[1].Key == "weight");
+    REQUIRE(unknown[1].Location.LineOffset == 1);
+    REQUIRE(unknown[1].Location.CharOffset == 41);
+
+    //events report aliases without resolving them
+    YamlEventReader reader(source);
+    auto anchors = std::vector<std::string>{};
+    auto aliases = size_t{0};
+
+    while(reader.Next()) {
+        if(!reader.GetAnchor().empty())
+            anchors.emplace_back(reader.GetAnchor());
+
+        if(reader.GetType() == YamlEventType::Alias) {
+            aliases++;
+            REQUIRE(reader.GetContext().path.entries.back().type == Path::Sequence);
+            break;
+        }
+    }
+
+    REQUIRE(anchors == std::vector<std::string>{"base"});
+    REQUIRE(aliases == 1);
+}
+
 TEST_CASE("Test stream writer", "[Stream][Target]") {
     std::stringstream target;
     RuntimeTextTransport::DataType data;